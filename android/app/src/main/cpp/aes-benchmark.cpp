@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "aes-benchmark.h"
+#include "native-log.h"
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double mb_per_second(size_t bytes, double ms) {
+    return ms > 0 ? bytes / (1024.0 * 1024.0) / (ms / 1000.0) : 0;
+}
+
+std::string benchmark_aes(size_t bytes) {
+    const int rounds = 3;
+    const size_t len = std::max<size_t>(16, bytes / 16 * 16);
+
+    // Compressed streams look random, so random data is representative.
+    std::vector<uint8_t> plain(len), cipher(len), out(len);
+    unsigned seed = 12345;
+    for (size_t i = 0; i < len; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        plain[i] = (uint8_t)(seed >> 24);
+    }
+    uint8_t key[32];
+    for (int i = 0; i < 32; ++i) key[i] = (uint8_t)(i * 7 + 1);
+    const uint8_t iv0[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+    fz_aes enc, dec;
+    fz_aes_setkey_enc(&enc, key, 256);
+    fz_aes_setkey_dec(&dec, key, 256);
+
+    uint8_t iv[16];
+    double msEncrypt = 0, msDecrypt = 0;
+    bool matches = true;
+    for (int r = 0; r < rounds; ++r) {
+        memcpy(iv, iv0, 16);
+        auto start = std::chrono::steady_clock::now();
+        fz_aes_crypt_cbc(&enc, FZ_AES_ENCRYPT, len, iv, plain.data(), cipher.data());
+        msEncrypt += elapsed_ms(start);
+
+        memcpy(iv, iv0, 16);
+        start = std::chrono::steady_clock::now();
+        fz_aes_crypt_cbc(&dec, FZ_AES_DECRYPT, len, iv, cipher.data(), out.data());
+        msDecrypt += elapsed_ms(start);
+        matches = matches && out == plain;
+    }
+
+    double encrypt = mb_per_second(len, msEncrypt / rounds);
+    double decrypt = mb_per_second(len, msDecrypt / rounds);
+    LOGI("AES benchmark %zu bytes encrypt %.1f decrypt %.1f MB/s%s",
+         len, encrypt, decrypt, matches ? "" : " MISMATCH");
+
+    char json[192];
+    snprintf(json, sizeof(json),
+             "{\"backend\":\"mupdf\",\"bytes\":%zu,\"encryptMBps\":%.1f,\"decryptMBps\":%.1f,\"matches\":%s}",
+             len, encrypt, decrypt, matches ? "true" : "false");
+    return json;
+}
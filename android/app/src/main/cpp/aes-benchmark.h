@@ -0,0 +1,12 @@
+#ifndef BLUEPDF_AES_BENCHMARK_H
+#define BLUEPDF_AES_BENCHMARK_H
+
+#include <cstddef>
+#include <string>
+
+// MB/s of AES-256-CBC encryption and decryption over bytes of synthetic
+// data, through MuPDF's fz_aes_crypt_cbc: the code its security handler
+// runs when saving and reading encrypted PDFs. Returns JSON.
+std::string benchmark_aes(size_t bytes);
+
+#endif
@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "doc-open.h"
+#include "native-log.h"
+
+// Bytes hashed at each end of the file for the fingerprint. Size and
+// mtime already tell most files apart; the hash catches same-size rewrites.
+static const size_t FINGERPRINT_SAMPLE = 4096;
+
+// Most repair indexes kept, by count and by total size. Every repaired
+// file version gets its own index, so the least recently used ones go.
+static const size_t REPAIR_INDEX_MAX_FILES = 64;
+static const long long REPAIR_INDEX_MAX_BYTES = 16LL * 1024 * 1024;
+
+static std::mutex g_indexDirMutex;
+static std::string g_indexDir;
+
+// Delete the least recently used indexes in dir until it is within
+// REPAIR_INDEX_MAX_FILES and REPAIR_INDEX_MAX_BYTES. Opens that use an
+// index touch its mtime, so that is the last use.
+static void prune_repair_indexes(const std::string& dir) {
+    struct Entry {
+        std::string path;
+        time_t mtime;
+        long long bytes;
+    };
+    static std::mutex pruneMutex;
+    std::lock_guard<std::mutex> lock(pruneMutex);
+
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    std::vector<Entry> entries;
+    long long total = 0;
+    while (struct dirent* e = readdir(d)) {
+        // Skip indexes still being written (.tmp).
+        size_t len = strlen(e->d_name);
+        if (len < 5 || strcmp(e->d_name + len - 5, ".xref") != 0) continue;
+        std::string path = dir + "/" + e->d_name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        entries.push_back({ path, st.st_mtime, (long long)st.st_size });
+        total += st.st_size;
+    }
+    closedir(d);
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.mtime < b.mtime; });
+    size_t count = entries.size();
+    for (const Entry& e : entries) {
+        if (count <= REPAIR_INDEX_MAX_FILES && total <= REPAIR_INDEX_MAX_BYTES) break;
+        if (remove(e.path.c_str()) == 0) {
+            --count;
+            total -= e.bytes;
+        }
+    }
+}
+
+void set_repair_index_dir(const std::string& dir) {
+    std::string path = dir + "/xref-index";
+    mkdir(path.c_str(), 0700);
+    prune_repair_indexes(path);
+    std::lock_guard<std::mutex> lock(g_indexDirMutex);
+    g_indexDir = path;
+}
+
+static std::string repair_index_dir() {
+    std::lock_guard<std::mutex> lock(g_indexDirMutex);
+    return g_indexDir;
+}
+
+static uint64_t fnv1a(uint64_t hash, const unsigned char* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Path of the repair index for the file behind fd, or "" when indexes are
+// disabled or the file cannot be read.
+static std::string repair_index_path(int fd) {
+    std::string dir = repair_index_dir();
+    if (dir.empty()) return "";
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) return "";
+
+    uint64_t hash = 14695981039346656037ULL;
+    hash = fnv1a(hash, (const unsigned char*)&st.st_size, sizeof(st.st_size));
+    hash = fnv1a(hash, (const unsigned char*)&st.st_mtime, sizeof(st.st_mtime));
+
+    unsigned char sample[FINGERPRINT_SAMPLE];
+    ssize_t n = pread(fd, sample, sizeof(sample), 0);
+    if (n > 0) hash = fnv1a(hash, sample, (size_t)n);
+    off_t tailStart = st.st_size > (off_t)sizeof(sample) ? st.st_size - (off_t)sizeof(sample) : 0;
+    n = pread(fd, sample, sizeof(sample), tailStart);
+    if (n > 0) hash = fnv1a(hash, sample, (size_t)n);
+
+    char name[40];
+    snprintf(name, sizeof(name), "/%016llx.xref", (unsigned long long)hash);
+    return dir + name;
+}
+
+// Trailer keys that describe the old xref rather than the document.
+static bool is_xref_key(fz_context* ctx, pdf_obj* key) {
+    static pdf_obj* const keys[] = {
+        PDF_NAME(Size), PDF_NAME(Prev), PDF_NAME(XRefStm), PDF_NAME(Type), PDF_NAME(W),
+        PDF_NAME(Index), PDF_NAME(Length), PDF_NAME(Filter), PDF_NAME(DecodeParms),
+    };
+    for (pdf_obj* k : keys)
+        if (pdf_name_eq(ctx, key, k)) return true;
+    return false;
+}
+
+static void put_be(unsigned char* p, uint64_t v, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i, v >>= 8) p[i] = (unsigned char)v;
+}
+
+// Serialize the repaired xref as an uncompressed xref stream that starts
+// right after the last byte of the original file. Throws when an entry has
+// no place in the original file (objects created by the repair itself).
+// Entries pointing past the end of the file belong to an earlier index.
+static fz_buffer* build_repair_index(fz_context* ctx, pdf_document* doc, int64_t fileSize) {
+    // Entry: type (1 byte), offset or object stream (8), generation or index (2).
+    static const int ENTRY_BYTES = 11;
+    int len = pdf_xref_len(ctx, doc);
+    int size = len + 1;
+    int64_t xrefOffset = fileSize + 1;  // after the leading newline
+
+    unsigned char* entries = (unsigned char*)fz_malloc(ctx, (size_t)size * ENTRY_BYTES);
+    fz_buffer* buf = nullptr;
+    fz_output* out = nullptr;
+
+    fz_var(buf);
+    fz_var(out);
+    fz_try(ctx) {
+        for (int i = 0; i < len; ++i) {
+            pdf_xref_entry* e = pdf_get_xref_entry_no_null(ctx, doc, i);
+            unsigned char* p = entries + (size_t)i * ENTRY_BYTES;
+            if (e->type == 'n' && e->ofs >= fileSize) {
+                p[0] = 0;
+                put_be(p + 1, 0, 8);
+                put_be(p + 9, 0, 2);
+            } else if (e->type == 'n' && e->ofs > 0 && !e->stm_buf) {
+                p[0] = 1;
+                put_be(p + 1, (uint64_t)e->ofs, 8);
+                put_be(p + 9, e->gen, 2);
+            } else if (e->type == 'o') {
+                p[0] = 2;
+                put_be(p + 1, (uint64_t)e->ofs, 8);
+                put_be(p + 9, e->gen, 2);
+            } else if (e->type == 'n') {
+                fz_throw(ctx, FZ_ERROR_ARGUMENT, "object %d has no file offset", i);
+            } else {
+                p[0] = 0;
+                put_be(p + 1, 0, 8);
+                put_be(p + 9, i == 0 ? 65535 : 0, 2);
+            }
+        }
+        unsigned char* self = entries + (size_t)len * ENTRY_BYTES;
+        self[0] = 1;
+        put_be(self + 1, (uint64_t)xrefOffset, 8);
+        put_be(self + 9, 0, 2);
+
+        buf = fz_new_buffer(ctx, (size_t)size * ENTRY_BYTES + 1024);
+        out = fz_new_output_with_buffer(ctx, buf);
+        char line[128];
+        snprintf(line, sizeof(line), "\n%d 0 obj\n<</Type/XRef/Size %d/W[1 8 2]/Length %d",
+                 len, size, size * ENTRY_BYTES);
+        fz_write_string(ctx, out, line);
+
+        pdf_obj* trailer = pdf_trailer(ctx, doc);
+        int n = pdf_dict_len(ctx, trailer);
+        for (int i = 0; i < n; ++i) {
+            pdf_obj* key = pdf_dict_get_key(ctx, trailer, i);
+            if (is_xref_key(ctx, key)) continue;
+            pdf_print_obj(ctx, out, key, 1, 1);
+            fz_write_byte(ctx, out, ' ');
+            pdf_print_obj(ctx, out, pdf_dict_get_val(ctx, trailer, i), 1, 1);
+        }
+
+        fz_write_string(ctx, out, ">>\nstream\n");
+        fz_write_data(ctx, out, entries, (size_t)size * ENTRY_BYTES);
+        snprintf(line, sizeof(line), "\nendstream\nendobj\nstartxref\n%lld\n%%%%EOF\n", (long long)xrefOffset);
+        fz_write_string(ctx, out, line);
+        fz_close_output(ctx, out);
+    } fz_always(ctx) {
+        fz_drop_output(ctx, out);
+        fz_free(ctx, entries);
+    } fz_catch(ctx) {
+        fz_drop_buffer(ctx, buf);
+        fz_rethrow(ctx);
+    }
+    return buf;
+}
+
+static void save_repair_index(fz_context* ctx, pdf_document* doc, int64_t fileSize, const std::string& indexPath) {
+    fz_buffer* index = nullptr;
+    std::string tmpPath = indexPath + ".tmp";
+
+    fz_var(index);
+    fz_try(ctx) {
+        index = build_repair_index(ctx, doc, fileSize);
+        fz_save_buffer(ctx, index, tmpPath.c_str());
+        if (rename(tmpPath.c_str(), indexPath.c_str()) != 0)
+            fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot rename repair index: %s", strerror(errno));
+        LOGI("Saved repair index (%zu bytes) to %s", index->len, indexPath.c_str());
+        prune_repair_indexes(repair_index_dir());
+    } fz_always(ctx) {
+        fz_drop_buffer(ctx, index);
+    } fz_catch(ctx) {
+        remove(tmpPath.c_str());
+        LOGI("Repair index not saved: %s", fz_caught_message(ctx));
+    }
+}
+
+pdf_document* open_pdf_document(fz_context* ctx, const char* path, InputAccess access) {
+    int fd = open_source_fd(path);
+    if (fd < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot open %s: %s", path, strerror(errno));
+
+    std::string indexPath = repair_index_path(fd);
+    struct stat st;
+    int64_t fileSize = fstat(fd, &st) == 0 ? (int64_t)st.st_size : -1;
+
+    fz_buffer* index = nullptr;
+    fz_stream* stm = nullptr;
+    pdf_document* doc = nullptr;
+    bool usedIndex = false;
+
+    fz_var(fd);
+    fz_var(index);
+    fz_var(stm);
+    fz_var(doc);
+    fz_var(usedIndex);
+    fz_try(ctx) {
+        if (!indexPath.empty() && ::access(indexPath.c_str(), R_OK) == 0) {
+            fz_try(ctx) {
+                index = fz_read_file(ctx, indexPath.c_str());
+            } fz_catch(ctx) {
+                index = nullptr;
+            }
+        }
+        // The stream owns the descriptor from here on, even if it throws.
+        int streamFd = fd;
+        fd = -1;
+        if (index) {
+            stm = open_input_stream(ctx, streamFd, true, access, index->data, index->len);
+            usedIndex = true;
+        } else {
+            stm = open_input_stream(ctx, streamFd, true, access);
+        }
+        doc = pdf_open_document_with_stream(ctx, stm);
+
+        if (pdf_was_repaired(ctx, doc) && !indexPath.empty() && fileSize > 0) {
+            if (usedIndex) {
+                // Stale or unusable; rebuild it from this repair.
+                LOGI("Repair index for %s did not help", path);
+                remove(indexPath.c_str());
+            }
+            save_repair_index(ctx, doc, fileSize, indexPath);
+        } else if (usedIndex) {
+            LOGI("Opened %s with its repair index", path);
+            // Mark it recently used so pruning keeps it.
+            utimensat(AT_FDCWD, indexPath.c_str(), nullptr, 0);
+        }
+    } fz_always(ctx) {
+        fz_drop_stream(ctx, stm);
+        fz_drop_buffer(ctx, index);
+    } fz_catch(ctx) {
+        if (fd >= 0) close(fd);
+        pdf_drop_document(ctx, doc);
+        fz_rethrow(ctx);
+    }
+    return doc;
+}
+
+static bool has_pdf_header(const char* path) {
+    int fd = open_source_fd(path);
+    if (fd < 0) return false;
+    char head[1024];
+    ssize_t n = pread(fd, head, sizeof(head), 0);
+    close(fd);
+    return n > 0 && memmem(head, (size_t)n, "%PDF-", 5) != nullptr;
+}
+
+fz_document* open_document(fz_context* ctx, const char* path, InputAccess access) {
+    if (has_pdf_header(path))
+        return (fz_document*)open_pdf_document(ctx, path, access);
+    if (strncmp(path, "fd:", 3) != 0)
+        return fz_open_document(ctx, path);
+
+    // No file name to go by; MuPDF recognizes images by their content.
+    int fd = open_source_fd(path);
+    if (fd < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot open %s: %s", path, strerror(errno));
+    fz_stream* stm = open_input_stream(ctx, fd, true, access);
+    fz_document* doc = nullptr;
+
+    fz_var(doc);
+    fz_try(ctx) {
+        doc = fz_open_document_with_stream(ctx, path, stm);
+    } fz_always(ctx) {
+        fz_drop_stream(ctx, stm);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+    return doc;
+}
+
+void authenticate_document(fz_context* ctx, fz_document* doc, const char* password) {
+    if (!fz_needs_password(ctx, doc)) return;
+    bool empty = !password || !*password;
+    if (!empty && fz_authenticate_password(ctx, doc, password)) return;
+    fz_throw(ctx, FZ_ERROR_ARGUMENT, "%s", empty ? "password required" : "incorrect password");
+}
@@ -0,0 +1,38 @@
+#ifndef BLUEPDF_DOC_OPEN_H
+#define BLUEPDF_DOC_OPEN_H
+
+#include <string>
+
+#include "input-stream.h"
+
+extern "C" {
+    #include "mupdf/fitz.h"
+    #include "mupdf/pdf.h"
+}
+
+// Directory for per-file repair indexes; opens skip the index until set.
+// The least recently used indexes are pruned beyond a fixed count and size.
+void set_repair_index_dir(const std::string& dir);
+
+// Open a PDF. When MuPDF had to rebuild a damaged xref, the rebuilt object
+// offsets are saved as a repair index keyed by the file's fingerprint
+// (size, mtime and a hash of its first and last bytes). Later opens of the
+// same file append that index as a fresh xref stream behind the damaged
+// one, so MuPDF finds a valid xref instead of scanning the whole file.
+// access picks how the file is read (see InputAccess).
+pdf_document* open_pdf_document(fz_context* ctx, const char* path,
+                                InputAccess access = InputAccess::BUFFERED);
+
+// open_pdf_document() for PDF files, fz_open_document() for anything else.
+// Both accept the sources open_source_fd() does.
+fz_document* open_document(fz_context* ctx, const char* path,
+                           InputAccess access = InputAccess::BUFFERED);
+
+// Unlock an encrypted document with password; objects are then decrypted
+// in memory as they are read, with no decrypted copy written anywhere.
+// Unencrypted documents, and those an empty user password opens, ignore
+// it; null counts as empty. Throws FZ_ERROR_ARGUMENT "password required"
+// or "incorrect password" when doc stays locked.
+void authenticate_document(fz_context* ctx, fz_document* doc, const char* password);
+
+#endif
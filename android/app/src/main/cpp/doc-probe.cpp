@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "doc-probe.h"
+#include "doc-open.h"
+#include "trailer-reader.h"
+#include "native-log.h"
+
+// Page sizes closer than this (in points) are reported as one run.
+static const float PAGE_SIZE_TOLERANCE = 0.5f;
+
+// Runs are built straight into the probe: a local vector would leak when
+// a lookup throws past it.
+static void probe_pages(fz_context* ctx, pdf_document* doc, DocProbe& probe) {
+    int count = pdf_count_pages(ctx, doc);
+    std::vector<PageSizeRun>& runs = probe.pageSizes;
+
+    for (int i = 0; i < count; ++i) {
+        pdf_obj* pageObj = pdf_lookup_page_obj(ctx, doc, i);
+        fz_rect box;
+        fz_matrix ctm;
+        pdf_page_obj_transform(ctx, pageObj, &box, &ctm);
+        fz_rect bounds = fz_transform_rect(box, ctm);
+        float w = bounds.x1 - bounds.x0;
+        float h = bounds.y1 - bounds.y0;
+
+        if (!runs.empty() && fabsf(runs.back().width - w) < PAGE_SIZE_TOLERANCE &&
+            fabsf(runs.back().height - h) < PAGE_SIZE_TOLERANCE)
+            runs.back().count++;
+        else
+            runs.push_back({ w, h, 1 });
+    }
+
+    probe.pageCount = count;
+}
+
+DocProbe probe_document(fz_context* ctx, const std::string& path, bool pageSizes, const std::string& password) {
+    DocProbe probe;
+    probe.path = path;
+
+    struct stat st;
+    int fd = open_source_fd(path.c_str());
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        probe.error = "file not found";
+        return probe;
+    }
+    close(fd);
+    probe.fileSize = (long long)st.st_size;
+
+    TrailerInfo info;
+    if (!pageSizes && read_trailer_info(path.c_str(), &info) &&
+        (info.pageCount > 0 || (info.encrypted && password.empty()))) {
+        probe.version = info.version;
+        probe.linearized = info.linearized;
+        probe.encrypted = info.encrypted;
+        probe.pageCount = info.pageCount;
+        return probe;
+    }
+
+    pdf_document* doc = nullptr;
+
+    fz_var(doc);
+    fz_try(ctx) {
+        doc = open_pdf_document(ctx, path.c_str(), InputAccess::RANDOM);
+        probe.version = pdf_version(ctx, doc);
+        probe.linearized = pdf_doc_was_linearized(ctx, doc) != 0;
+        probe.encrypted = pdf_needs_password(ctx, doc) != 0;
+        if (probe.encrypted && !password.empty())
+            authenticate_document(ctx, &doc->super, password.c_str());
+
+        // The page tree of an encrypted file may sit in encrypted object
+        // streams; a failure there still leaves a useful probe.
+        fz_try(ctx) {
+            probe_pages(ctx, doc, probe);
+        } fz_catch(ctx) {
+            probe.pageSizes.clear();
+            if (!probe.encrypted)
+                LOGI("Probe: page tree of %s unreadable: %s", path.c_str(), fz_caught_message(ctx));
+        }
+
+        // Page tree lookups can trigger a repair as well.
+        probe.repaired = pdf_was_repaired(ctx, doc) != 0;
+    } fz_always(ctx) {
+        pdf_drop_document(ctx, doc);
+    } fz_catch(ctx) {
+        probe.error = fz_caught_message(ctx);
+    }
+    return probe;
+}
+
+std::vector<DocProbe> probe_documents(fz_context* ctx, const std::vector<std::string>& paths, int maxThreads,
+                                     bool pageSizes) {
+    std::vector<DocProbe> probes(paths.size());
+    std::atomic<size_t> next(0);
+
+    auto worker = [&](fz_context* local) {
+        for (size_t i = next++; i < paths.size(); i = next++)
+            probes[i] = probe_document(local, paths[i], pageSizes);
+    };
+
+    // Probing is mostly small reads and parsing, so a few threads are
+    // enough to keep storage busy.
+    int threads = (int)std::min<size_t>(paths.size(), (size_t)std::max(1, maxThreads));
+    std::vector<std::thread> pool;
+    std::vector<fz_context*> clones;
+    for (int t = 1; t < threads; ++t) {
+        fz_context* clone = fz_clone_context(ctx);
+        if (!clone) break;
+        clones.push_back(clone);
+        pool.emplace_back(worker, clone);
+    }
+    worker(ctx);
+
+    for (std::thread& th : pool) th.join();
+    for (fz_context* clone : clones) fz_drop_context(clone);
+    return probes;
+}
+
+void append_json_string(std::string& out, const std::string& s) {
+    out += '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+std::string doc_probes_json(const std::vector<DocProbe>& probes) {
+    std::string json = "[";
+    char buf[160];
+    for (size_t i = 0; i < probes.size(); ++i) {
+        const DocProbe& p = probes[i];
+        if (i) json += ',';
+        json += "{\"path\":";
+        append_json_string(json, p.path);
+        if (!p.error.empty()) {
+            json += ",\"error\":";
+            append_json_string(json, p.error);
+        }
+        snprintf(buf, sizeof(buf),
+                 ",\"fileSize\":%lld,\"encrypted\":%s,\"pageCount\":%d,\"version\":\"%d.%d\","
+                 "\"linearized\":%s,\"repaired\":%s,\"pageSizes\":[",
+                 p.fileSize, p.encrypted ? "true" : "false", p.pageCount, p.version / 10, p.version % 10,
+                 p.linearized ? "true" : "false", p.repaired ? "true" : "false");
+        json += buf;
+        for (size_t r = 0; r < p.pageSizes.size(); ++r) {
+            snprintf(buf, sizeof(buf), "%s[%.1f,%.1f,%d]", r ? "," : "",
+                     p.pageSizes[r].width, p.pageSizes[r].height, p.pageSizes[r].count);
+            json += buf;
+        }
+        json += "]}";
+    }
+    return json + "]";
+}
@@ -0,0 +1,53 @@
+#ifndef BLUEPDF_DOC_PROBE_H
+#define BLUEPDF_DOC_PROBE_H
+
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+    #include "mupdf/pdf.h"
+}
+
+// Consecutive pages sharing one displayed size, in points.
+struct PageSizeRun {
+    float width;
+    float height;
+    int count;
+};
+
+// What the app needs to know about a picked file before running a tool.
+struct DocProbe {
+    std::string path;
+    std::string error;                 // empty when the file could be read
+    long long fileSize = -1;
+    bool encrypted = false;            // a password is required to read it
+    int pageCount = -1;                // -1 when the page tree is unreadable
+    std::vector<PageSizeRun> pageSizes;
+    int version = 0;                   // 17 for PDF-1.7
+    bool linearized = false;
+    bool repaired = false;             // the xref was broken and rebuilt
+};
+
+// Probe one file. Only the xref, trailer and page tree dictionaries are
+// read; no page content is parsed. Never throws.
+// Without pageSizes the trailer-only reader answers first and MuPDF opens
+// the file only when that fails; pageSizes stays empty and repaired false.
+// A password unlocks an encrypted file so its page tree can be read; a
+// wrong one is reported as the probe's error.
+DocProbe probe_document(fz_context* ctx, const std::string& path, bool pageSizes = true,
+                        const std::string& password = "");
+
+// Probe many files on up to maxThreads worker threads, each with a clone
+// of ctx (which must come from new_threaded_context()). Results keep the
+// order of paths.
+std::vector<DocProbe> probe_documents(fz_context* ctx, const std::vector<std::string>& paths, int maxThreads,
+                                     bool pageSizes = true);
+
+// Append s to out as a quoted, escaped JSON string.
+void append_json_string(std::string& out, const std::string& s);
+
+// JSON array with one object per probe, sizes as [width, height, count] runs.
+std::string doc_probes_json(const std::vector<DocProbe>& probes);
+
+#endif
@@ -0,0 +1,563 @@
+#include <cmath>
+#include <cstring>
+
+#include "doc-tools.h"
+#include "doc-open.h"
+#include "output-stream.h"
+#include "pdf-linearizer.h"
+#include "render-engine.h"
+#include "native-log.h"
+
+// progress->cookie counts pages. MuPDF counts its own progress in a cookie
+// handed to fz_run_page(), so pages are run without one and abort is
+// checked between pages instead.
+
+// A4 size in points (72 DPI)
+#define A4_WIDTH 595.0f
+#define A4_HEIGHT 842.0f
+
+// Resolution images are placed at on A4 pages
+#define A4_IMAGE_DPI 150.0f
+
+static void check_abort(fz_context* ctx, ToolProgress* progress) {
+    if (progress && progress->cookie.abort)
+        fz_throw(ctx, FZ_ERROR_ABORT, "cancelled");
+}
+
+static void set_phase(ToolProgress* progress, ToolPhase phase) {
+    if (progress) progress->set_phase(phase);
+}
+
+static void add_progress(ToolProgress* progress, int pages) {
+    if (progress) progress->add_pages(pages);
+}
+
+static void add_progress_max(ToolProgress* progress, int pages) {
+    if (progress) progress->cookie.progress_max += (size_t)pages;
+}
+
+// Whether a tool writes its PDF to memory first for finish_pdf_output().
+static bool stages_output(const PdfOutputOptions& layout) {
+    return layout.linearize || layout.subsetFonts;
+}
+
+// Tools keep no C++ objects across fz_try: their fz_catch rethrows, and
+// the longjmp would skip the destructors. Option strings live in fixed
+// buffers and results in fz_malloc'd strings until take_result().
+#define WRITER_OPTIONS_SIZE 128
+
+// Document writer options: base plus what layout asks for. A staged file
+// is written again by finish_pdf_output(), which packs it then.
+static void writer_options(char options[WRITER_OPTIONS_SIZE], const char* base, const PdfOutputOptions& layout) {
+    bool pack = layout.objectStreams && !stages_output(layout);
+    snprintf(options, WRITER_OPTIONS_SIZE, "%s%s%s", base, pack && *base ? "," : "",
+             pack ? "compress=yes,objstms=yes" : "");
+}
+
+// A tool's fz_malloc'd result as a std::string, once no fz_try frame is
+// left to longjmp past it.
+static std::string take_result(fz_context* ctx, char* result) {
+    std::string path = result ? result : "";
+    fz_free(ctx, result);
+    return path;
+}
+
+// Where a tool writes its PDF: the destination itself, or when
+// stages_output() a new buffer in *staging for finish_pdf_output().
+static fz_output* open_pdf_output(fz_context* ctx, const std::string& output, const PdfOutputOptions& layout,
+                                  fz_buffer** memory, fz_buffer** staging, OutputMode mode,
+                                  ToolProgress* progress) {
+    if (!stages_output(layout)) return open_destination(ctx, output.c_str(), memory, mode, progress);
+    *staging = fz_new_buffer(ctx, 1024 * 1024);
+    return fz_new_output_with_buffer(ctx, *staging);
+}
+
+// Once the output from open_pdf_output() is closed, write what was staged
+// to the destination: with its fonts cut down to the glyphs its pages use
+// when layout.subsetFonts, then linearized or saved again with unused
+// objects dropped. password unlocks it when the tool encrypted it, and an
+// encrypted file stays so. Returns the bytes written, or -1 when nothing
+// was staged.
+static long long finish_pdf_output(fz_context* ctx, const std::string& output, fz_buffer* staging,
+                                   fz_buffer** memory, const char* password,
+                                   const PdfOutputOptions& layout, ToolProgress* progress) {
+    if (!staging) return -1;
+    fz_stream* stm = nullptr;
+    pdf_document* doc = nullptr;
+    fz_output* dest = nullptr;
+    long long written = 0;
+    pdf_write_options opts = pdf_default_write_options;
+
+    fz_var(stm);
+    fz_var(doc);
+    fz_var(dest);
+    fz_try(ctx) {
+        stm = fz_open_buffer(ctx, staging);
+        doc = pdf_open_document_with_stream(ctx, stm);
+        authenticate_document(ctx, &doc->super, password);
+        if (layout.subsetFonts) {
+            // MuPDF's subsetter is experimental. Should it fail part way,
+            // start again from the staged copy and keep the full fonts.
+            fz_try(ctx) {
+                pdf_subset_fonts(ctx, doc, 0, nullptr);
+            } fz_catch(ctx) {
+                LOGI("Font subsetting failed, keeping full fonts: %s", fz_caught_message(ctx));
+                pdf_drop_document(ctx, doc);
+                doc = nullptr;
+                doc = pdf_open_document_with_stream(ctx, stm);
+                authenticate_document(ctx, &doc->super, password);
+            }
+        }
+        dest = open_destination(ctx, output.c_str(), memory, OutputMode::ASYNC, progress);
+        if (layout.linearize) {
+            write_linearized(ctx, doc, dest);
+        } else {
+            // Garbage collection drops the full font files subsetting replaced.
+            opts.do_garbage = 1;
+            opts.do_compress = 1;
+            opts.do_compress_fonts = 1;
+            opts.do_use_objstms = layout.objectStreams;
+            opts.do_encrypt = PDF_ENCRYPT_KEEP;
+            pdf_write_document(ctx, doc, dest, &opts);
+        }
+        written = (long long)fz_tell_output(ctx, dest);
+        fz_close_output(ctx, dest);
+    } fz_always(ctx) {
+        fz_drop_output(ctx, dest);
+        pdf_drop_document(ctx, doc);
+        fz_drop_stream(ctx, stm);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+    if (layout.subsetFonts)
+        LOGI("Subset fonts: %zu -> %lld bytes", fz_buffer_storage(ctx, staging, nullptr), written);
+    return written;
+}
+
+static void add_image_page(fz_context* ctx, fz_document_writer* writer, fz_image* img, bool a4) {
+    fz_rect page_rect;
+    fz_matrix m;
+
+    if (a4) {
+        page_rect = fz_make_rect(0, 0, A4_WIDTH, A4_HEIGHT);
+
+        // Convert image size in pixels to points (1 inch = 72 points)
+        float img_w_pt = (img->w / A4_IMAGE_DPI) * 72.0f;
+        float img_h_pt = (img->h / A4_IMAGE_DPI) * 72.0f;
+
+        // Fit image into A4 while maintaining aspect ratio
+        float scale = fminf(A4_WIDTH / img_w_pt, A4_HEIGHT / img_h_pt);
+        float final_w = img_w_pt * scale;
+        float final_h = img_h_pt * scale;
+
+        m = fz_translate((A4_WIDTH - final_w) / 2.0f, (A4_HEIGHT - final_h) / 2.0f);
+        m = fz_concat(fz_scale(final_w, final_h), m);
+    } else {
+        page_rect = fz_make_rect(0, 0, (float)img->w, (float)img->h);
+        m = fz_scale((float)img->w, (float)img->h);
+    }
+
+    fz_device* dev = fz_begin_page(ctx, writer, page_rect);
+    fz_fill_image(ctx, dev, img, m, 1.0f, fz_default_color_params);
+    fz_end_page(ctx, writer);
+}
+
+std::string images_to_pdf(fz_context* ctx, const std::vector<std::string>& images,
+                          const std::string& output, bool a4, const PdfOutputOptions& layout,
+                          ToolProgress* progress) {
+    fz_document_writer* writer = nullptr;
+    fz_buffer* memory = nullptr;
+    fz_buffer* staging = nullptr;
+    fz_image* img = nullptr;
+    char pdf_options[WRITER_OPTIONS_SIZE];
+    char* result = nullptr;
+
+    writer_options(pdf_options, "", layout);
+    add_progress_max(progress, (int)images.size());
+
+    fz_var(writer);
+    fz_var(memory);
+    fz_var(staging);
+    fz_var(img);
+    fz_var(result);
+    fz_try(ctx) {
+        // The writer owns the output from here on.
+        writer = fz_new_pdf_writer_with_output(
+            ctx, open_pdf_output(ctx, output, layout, &memory, &staging, OutputMode::DIRECT, progress),
+            pdf_options);
+        set_phase(progress, ToolPhase::PAGES);
+
+        for (size_t i = 0; i < images.size(); ++i) {
+            check_abort(ctx, progress);
+
+            fz_try(ctx) {
+                img = fz_new_image_from_file(ctx, images[i].c_str());
+                add_image_page(ctx, writer, img, a4);
+            } fz_always(ctx) {
+                fz_drop_image(ctx, img);
+                img = nullptr;
+            } fz_catch(ctx) {
+                LOGI("Failed on image %s", images[i].c_str());
+            }
+            add_progress(progress, 1);
+        }
+
+        set_phase(progress, ToolPhase::WRITE);
+        fz_close_document_writer(ctx, writer);
+        finish_pdf_output(ctx, output, staging, &memory, "", layout, progress);
+        result = finish_destination(ctx, output.c_str(), memory);
+    } fz_always(ctx) {
+        fz_drop_document_writer(ctx, writer);
+        fz_drop_buffer(ctx, staging);
+        fz_drop_buffer(ctx, memory);
+    } fz_catch(ctx) {
+        fz_free(ctx, result);
+        fz_rethrow(ctx);
+    }
+
+    return take_result(ctx, result);
+}
+
+std::string merge_documents(fz_context* ctx, const std::vector<std::string>& inputs,
+                            const std::string& output, const std::string& password,
+                            const PdfOutputOptions& layout, ToolProgress* progress) {
+    fz_document_writer* writer = nullptr;
+    fz_buffer* memory = nullptr;
+    fz_buffer* staging = nullptr;
+    fz_document* doc = nullptr;
+    fz_page* page = nullptr;
+    char pdf_options[WRITER_OPTIONS_SIZE];
+    char* result = nullptr;
+
+    writer_options(pdf_options, "compress-images=no,compress-fonts=no", layout);
+    fz_var(writer);
+    fz_var(memory);
+    fz_var(staging);
+    fz_var(doc);
+    fz_var(page);
+    fz_var(result);
+    fz_try(ctx) {
+        writer = fz_new_pdf_writer_with_output(
+            ctx, open_pdf_output(ctx, output, layout, &memory, &staging, OutputMode::ASYNC, progress),
+            pdf_options);
+
+        LOGI("Merging %d PDF files", (int)inputs.size());
+
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            check_abort(ctx, progress);
+            set_phase(progress, ToolPhase::OPEN);
+            doc = open_document(ctx, inputs[i].c_str(), InputAccess::SEQUENTIAL);
+            authenticate_document(ctx, doc, password.c_str());
+
+            int pageCount = fz_count_pages(ctx, doc);
+            LOGI("PDF %d has %d pages", (int)i, pageCount);
+            // Later inputs are not opened yet, so the total grows as we go.
+            add_progress_max(progress, pageCount);
+            set_phase(progress, ToolPhase::PAGES);
+
+            for (int j = 0; j < pageCount; j++) {
+                check_abort(ctx, progress);
+                page = fz_load_page(ctx, doc, j);
+                fz_rect bounds = fz_bound_page(ctx, page);
+
+                if (fz_is_empty_rect(bounds)) {
+                    LOGI("Page %d in doc %d has empty bounds; skipping", j, (int)i);
+                } else {
+                    fz_device* dev = fz_begin_page(ctx, writer, bounds);
+                    fz_run_page(ctx, page, dev, fz_identity, nullptr);
+                    fz_end_page(ctx, writer);
+                }
+
+                fz_drop_page(ctx, page);
+                page = nullptr;
+                add_progress(progress, 1);
+            }
+
+            fz_drop_document(ctx, doc);
+            doc = nullptr;
+        }
+
+        set_phase(progress, ToolPhase::WRITE);
+        fz_close_document_writer(ctx, writer);
+        finish_pdf_output(ctx, output, staging, &memory, "", layout, progress);
+        result = finish_destination(ctx, output.c_str(), memory);
+    } fz_always(ctx) {
+        fz_drop_page(ctx, page);
+        fz_drop_document(ctx, doc);
+        fz_drop_document_writer(ctx, writer);
+        fz_drop_buffer(ctx, staging);
+        fz_drop_buffer(ctx, memory);
+    } fz_catch(ctx) {
+        fz_free(ctx, result);
+        fz_rethrow(ctx);
+    }
+
+    return take_result(ctx, result);
+}
+
+std::string split_document(fz_context* ctx, const std::string& input, const std::vector<int>& pages,
+                           const std::string& output, const std::string& password,
+                           const PdfOutputOptions& layout, ToolProgress* progress) {
+    fz_document* doc = nullptr;
+    fz_document_writer* writer = nullptr;
+    fz_buffer* memory = nullptr;
+    fz_buffer* staging = nullptr;
+    fz_page* page = nullptr;
+    char pdf_options[WRITER_OPTIONS_SIZE];
+    char* result = nullptr;
+
+    writer_options(pdf_options, "", layout);
+    add_progress_max(progress, (int)pages.size());
+
+    fz_var(doc);
+    fz_var(writer);
+    fz_var(memory);
+    fz_var(staging);
+    fz_var(page);
+    fz_var(result);
+    fz_try(ctx) {
+        doc = open_document(ctx, input.c_str());
+        authenticate_document(ctx, doc, password.c_str());
+        int totalPages = fz_count_pages(ctx, doc);
+
+        // The writer owns the output from here on.
+        writer = fz_new_pdf_writer_with_output(
+            ctx, open_pdf_output(ctx, output, layout, &memory, &staging, OutputMode::DIRECT, progress),
+            pdf_options);
+        set_phase(progress, ToolPhase::PAGES);
+
+        for (size_t i = 0; i < pages.size(); ++i) {
+            check_abort(ctx, progress);
+            int pageNumber = pages[i];
+            if (pageNumber >= 1 && pageNumber <= totalPages) {
+                page = fz_load_page(ctx, doc, pageNumber - 1);
+                fz_rect bounds = fz_bound_page(ctx, page);
+
+                fz_device* dev = fz_begin_page(ctx, writer, bounds);
+                fz_run_page(ctx, page, dev, fz_identity, nullptr);
+                fz_end_page(ctx, writer);
+
+                fz_drop_page(ctx, page);
+                page = nullptr;
+            }
+            add_progress(progress, 1);
+        }
+
+        set_phase(progress, ToolPhase::WRITE);
+        fz_close_document_writer(ctx, writer);
+        finish_pdf_output(ctx, output, staging, &memory, "", layout, progress);
+        result = finish_destination(ctx, output.c_str(), memory);
+    } fz_always(ctx) {
+        fz_drop_page(ctx, page);
+        fz_drop_document_writer(ctx, writer);
+        fz_drop_document(ctx, doc);
+        fz_drop_buffer(ctx, staging);
+        fz_drop_buffer(ctx, memory);
+    } fz_catch(ctx) {
+        fz_free(ctx, result);
+        fz_rethrow(ctx);
+    }
+
+    return take_result(ctx, result);
+}
+
+std::string encrypt_document(fz_context* ctx, const std::string& input, const std::string& password,
+                             const std::string& output, EncryptMode mode, const std::string& currentPassword,
+                             const PdfOutputOptions& layout, ToolProgress* progress) {
+    pdf_document* doc = nullptr;
+    fz_output* dest = nullptr;
+    fz_buffer* memory = nullptr;
+    fz_buffer* staging = nullptr;
+    pdf_write_options opts = pdf_default_write_options;
+    char* result = nullptr;
+
+    add_progress_max(progress, 1);
+
+    fz_var(doc);
+    fz_var(dest);
+    fz_var(memory);
+    fz_var(staging);
+    fz_var(result);
+    fz_try(ctx) {
+        // Open the input PDF
+        doc = open_pdf_document(ctx, input.c_str(), InputAccess::SEQUENTIAL);
+        authenticate_document(ctx, &doc->super, currentPassword.c_str());
+
+        // Set up encryption options
+        opts.do_encrypt = PDF_ENCRYPT_AES_256;  // Use AES 256-bit encryption
+        strncpy(opts.opwd_utf8, password.c_str(), sizeof(opts.opwd_utf8) - 1);
+        opts.opwd_utf8[sizeof(opts.opwd_utf8) - 1] = '\0';
+
+        strncpy(opts.upwd_utf8, password.c_str(), sizeof(opts.upwd_utf8) - 1);
+        opts.upwd_utf8[sizeof(opts.upwd_utf8) - 1] = '\0';
+
+        // Set permissions (allow all operations by default)
+        opts.permissions = PDF_PERM_PRINT | PDF_PERM_MODIFY | PDF_PERM_COPY |
+                          PDF_PERM_ANNOTATE | PDF_PERM_FORM | PDF_PERM_ACCESSIBILITY |
+                          PDF_PERM_ASSEMBLE | PDF_PERM_PRINT_HQ;
+
+        // Additional write options
+        opts.do_incremental = 0;        // Full rewrite
+        opts.do_ascii = 0;              // Binary output
+        opts.do_decompress = 0;         // Don't decompress
+        opts.do_linear = 0;             // MuPDF cannot; see finish_pdf_output()
+        opts.do_use_objstms = layout.objectStreams && !layout.linearize;
+        opts.do_pretty = 0;             // Don't pretty print
+
+        if (mode == EncryptMode::CLEAN) {
+            opts.do_compress = 1;           // Compress streams
+            opts.do_compress_images = 1;    // Compress images
+            opts.do_compress_fonts = 1;     // Compress fonts
+            opts.do_garbage = 1;            // Remove unused objects
+            opts.do_clean = 1;              // Clean up document
+            opts.do_sanitize = 1;           // Sanitize document
+        } else {
+            // Streams keep their raw bytes and filters; content streams are
+            // never interpreted, so each one is read, encrypted and written.
+            opts.do_compress = 0;
+            opts.do_compress_images = 0;
+            opts.do_compress_fonts = 0;
+            opts.do_garbage = 0;
+            opts.do_clean = 0;
+            opts.do_sanitize = 0;
+        }
+
+        // Save the encrypted PDF
+        check_abort(ctx, progress);
+        set_phase(progress, ToolPhase::WRITE);
+        dest = open_pdf_output(ctx, output, layout, &memory, &staging, OutputMode::ASYNC, progress);
+        pdf_write_document(ctx, doc, dest, &opts);
+        fz_close_output(ctx, dest);
+        finish_pdf_output(ctx, output, staging, &memory, password.c_str(), layout, progress);
+        result = finish_destination(ctx, output.c_str(), memory);
+        add_progress(progress, 1);
+    } fz_always(ctx) {
+        fz_drop_output(ctx, dest);
+        fz_drop_buffer(ctx, staging);
+        fz_drop_buffer(ctx, memory);
+        pdf_drop_document(ctx, doc);
+    } fz_catch(ctx) {
+        fz_free(ctx, result);
+        fz_rethrow(ctx);
+    }
+
+    return take_result(ctx, result);
+}
+
+std::string optimize_document(fz_context* ctx, const std::string& input, const std::string& output,
+                              const OptimizePreset& preset, const std::string& password,
+                              const PdfOutputOptions& layout, ToolProgress* progress) {
+    pdf_document* doc = nullptr;
+    fz_output* dest = nullptr;
+    fz_buffer* memory = nullptr;
+    fz_buffer* staging = nullptr;
+    pdf_write_options opts = pdf_default_write_options;
+    char quality[8];
+    pdf_image_rewriter_options rewrite = optimize_rewriter_options(preset, quality);
+    ImageSizes before, after;
+    char* result = nullptr;
+
+    add_progress_max(progress, 1);
+
+    fz_var(doc);
+    fz_var(dest);
+    fz_var(memory);
+    fz_var(staging);
+    fz_var(result);
+    fz_try(ctx) {
+        doc = open_pdf_document(ctx, input.c_str(), InputAccess::SEQUENTIAL);
+        authenticate_document(ctx, &doc->super, password.c_str());
+        before = measure_images(ctx, doc);
+
+        check_abort(ctx, progress);
+        set_phase(progress, ToolPhase::PAGES);
+        pdf_rewrite_images(ctx, doc, &rewrite);
+        after = measure_images(ctx, doc);
+        add_progress(progress, 1);
+
+        // Replaced images stay in the xref until garbage collection drops
+        // them. Image streams are already encoded; everything else is
+        // deflated, small objects in object streams.
+        opts.do_garbage = 1;
+        opts.do_compress = 1;
+        opts.do_compress_images = 0;
+        opts.do_compress_fonts = 1;
+        opts.do_use_objstms = !layout.linearize;
+
+        check_abort(ctx, progress);
+        set_phase(progress, ToolPhase::WRITE);
+        dest = open_pdf_output(ctx, output, layout, &memory, &staging, OutputMode::ASYNC, progress);
+        pdf_write_document(ctx, doc, dest, &opts);
+        long long written = (long long)fz_tell_output(ctx, dest);
+        fz_close_output(ctx, dest);
+        if (staging) written = finish_pdf_output(ctx, output, staging, &memory, password.c_str(), layout, progress);
+        result = finish_destination(ctx, output.c_str(), memory);
+
+        LOGI("Optimized %s with %s: %lld bytes", input.c_str(), preset.name, written);
+        if (progress) progress->summary = optimize_summary_json(preset, before, after, written);
+    } fz_always(ctx) {
+        fz_drop_output(ctx, dest);
+        fz_drop_buffer(ctx, staging);
+        fz_drop_buffer(ctx, memory);
+        pdf_drop_document(ctx, doc);
+    } fz_catch(ctx) {
+        fz_free(ctx, result);
+        fz_rethrow(ctx);
+    }
+
+    return take_result(ctx, result);
+}
+
+std::string render_document_page(fz_context* ctx, const std::string& input, int pageNumber,
+                                 const RenderProfile& profile, const PageEncoding& encoding,
+                                 const std::string& dir, const std::string& password, ToolProgress* progress) {
+    RenderEngine& engine = RenderEngine::instance();
+    fz_document* doc = nullptr;
+    fz_page* page = nullptr;
+    fz_pixmap* pix = nullptr;
+    char name[64];
+    char* result = nullptr;
+
+    apply_render_profile(ctx, profile);
+    {
+        std::string pageName = render_profile_page_name(profile, pageNumber + 1,
+                                                        page_encoding_extension(encoding));
+        fz_strlcpy(name, pageName.c_str(), sizeof name);
+    }
+
+    fz_var(doc);
+    fz_var(page);
+    fz_var(pix);
+    fz_var(result);
+    fz_try(ctx) {
+        doc = open_document(ctx, input.c_str(), InputAccess::RANDOM);
+        authenticate_document(ctx, doc, password.c_str());
+        if (pageNumber < 0 || pageNumber >= fz_count_pages(ctx, doc))
+            fz_throw(ctx, FZ_ERROR_ARGUMENT, "page %d out of range", pageNumber);
+
+        check_abort(ctx, progress);
+        set_phase(progress, ToolPhase::PAGES);
+        page = fz_load_page(ctx, doc, pageNumber);
+        // With the cookie a cancel stops the render mid-page. MuPDF counts
+        // its own progress in it, so the page counts are set once rendered.
+        pix = engine.render_page(ctx, page, profile, progress ? &progress->cookie : nullptr);
+        if (progress) {
+            progress->cookie.progress = 0;
+            progress->cookie.progress_max = 1;
+        }
+        add_progress(progress, 1);
+
+        set_phase(progress, ToolPhase::WRITE);
+        result = fz_asprintf(ctx, "%s/%s", dir.c_str(), name);
+        save_page_image(ctx, pix, result, encoding);
+    } fz_always(ctx) {
+        if (pix) engine.release_pixmap(ctx, pix);
+        fz_drop_page(ctx, page);
+        fz_drop_document(ctx, doc);
+    } fz_catch(ctx) {
+        fz_free(ctx, result);
+        fz_rethrow(ctx);
+    }
+
+    return take_result(ctx, result);
+}
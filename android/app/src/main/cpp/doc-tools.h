@@ -0,0 +1,104 @@
+#ifndef BLUEPDF_DOC_TOOLS_H
+#define BLUEPDF_DOC_TOOLS_H
+
+#include <string>
+#include <vector>
+
+#include "image-optimizer.h"
+#include "page-encoder.h"
+#include "render-profile.h"
+#include "tool-progress.h"
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+// The document tools the job scheduler runs. Each runs on the caller's
+// context, throws on failure and returns what the tool reports: the
+// output destination, or "mem:<id>" for MEMORY_DESTINATION (see
+// finish_destination()).
+//
+// password unlocks encrypted inputs (see authenticate_document()); one
+// password serves every input of a merge.
+//
+// With progress, each tool reports its phase, pages and bytes written and
+// stops at the next page once progress->cookie.abort is set (see
+// tool-progress.h).
+
+// How a tool lays out the PDF it writes. objectStreams packs every object
+// but streams into compressed object streams, indexed by a compressed
+// cross-reference stream (PDF 1.5), so files with many small objects get
+// smaller and a reader has one short xref to parse instead of a text table
+// of 20 bytes per object. Streams are deflated as well.
+//
+// linearize writes a linearized file instead (see write_linearized()), so
+// a viewer reading it over a slow connection shows page 1 before the rest
+// arrives. The tool writes to memory first and the copy is linearized
+// into output, which takes about as long again and memory for the whole
+// file. Linearized files use a plain xref table, so linearize wins over
+// objectStreams.
+//
+// subsetFonts keeps only the glyphs the written pages use of each embedded
+// font, so a page or two taken from a file with full CJK fonts comes to
+// kilobytes rather than megabytes and parses faster. It stages the file
+// in memory as linearize does. Fonts MuPDF cannot subset stay whole.
+struct PdfOutputOptions {
+    bool objectStreams = false;
+    bool linearize = false;
+    bool subsetFonts = false;
+};
+
+// One page per image. a4 centres each image on an A4 page at 150 DPI;
+// otherwise pages take the image size. Unreadable images are skipped.
+std::string images_to_pdf(fz_context* ctx, const std::vector<std::string>& images,
+                          const std::string& output, bool a4,
+                          const PdfOutputOptions& layout = PdfOutputOptions(),
+                          ToolProgress* progress = nullptr);
+
+
+// All pages of every input, in order. Pages with empty bounds are skipped.
+std::string merge_documents(fz_context* ctx, const std::vector<std::string>& inputs,
+                            const std::string& output, const std::string& password = "",
+                            const PdfOutputOptions& layout = PdfOutputOptions(),
+                            ToolProgress* progress = nullptr);
+
+// The listed 1-based pages of input, in list order; others are ignored.
+std::string split_document(fz_context* ctx, const std::string& input, const std::vector<int>& pages,
+                           const std::string& output, const std::string& password = "",
+                           const PdfOutputOptions& layout = PdfOutputOptions(),
+                           ToolProgress* progress = nullptr);
+
+// How encrypt_document() rewrites the input. FAST copies every object and
+// stream as it is, only encrypting it, so the save is bound by I/O. CLEAN
+// also drops unused objects and parses, cleans and sanitizes every content
+// stream, which costs far more than the encryption on large scans.
+enum class EncryptMode { FAST, CLEAN };
+
+// AES-256 copy of input with password as both user and owner password.
+// An encrypted input is unlocked with currentPassword and re-encrypted.
+// The save itself cannot be interrupted; abort is honoured until it starts.
+std::string encrypt_document(fz_context* ctx, const std::string& input, const std::string& password,
+                             const std::string& output, EncryptMode mode = EncryptMode::FAST,
+                             const std::string& currentPassword = "",
+                             const PdfOutputOptions& layout = PdfOutputOptions(),
+                             ToolProgress* progress = nullptr);
+
+// Copy of input with its images subsampled and recompressed as preset
+// says, unused objects dropped and the rest packed into object streams
+// unless layout asks for a linearized file. progress->summary gets the
+// image bytes by class before and after (see optimize_summary_json()).
+// MuPDF rewrites all images in one pass on the calling thread, so abort
+// is honoured before and after it.
+std::string optimize_document(fz_context* ctx, const std::string& input, const std::string& output,
+                              const OptimizePreset& preset, const std::string& password = "",
+                              const PdfOutputOptions& layout = PdfOutputOptions(),
+                              ToolProgress* progress = nullptr);
+
+// Render page pageNumber (0-based) with profile into dir, named by
+// render_profile_page_name(). Returns the image path.
+std::string render_document_page(fz_context* ctx, const std::string& input, int pageNumber,
+                                 const RenderProfile& profile, const PageEncoding& encoding,
+                                 const std::string& dir, const std::string& password = "",
+                                 ToolProgress* progress = nullptr);
+
+#endif
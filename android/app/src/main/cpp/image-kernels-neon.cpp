@@ -0,0 +1,77 @@
+#include "image-kernels.h"
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+#if defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+// NEON backend. Each kernel handles full vectors and leaves the remainder
+// (and unsupported component counts) to the scalar reference.
+
+static void neon_downscale_2x(const uint8_t* src, ptrdiff_t srcStride, int srcW, int srcH, int n,
+                              uint8_t* dst, ptrdiff_t dstStride) {
+    const ImageKernels& scalar = scalar_image_kernels();
+    if (n != 1 && n != 3 && n != 4) {
+        scalar.downscale_2x(src, srcStride, srcW, srcH, n, dst, dstStride);
+        return;
+    }
+    int dw = srcW / 2, dh = srcH / 2;
+    for (int y = 0; y < dh; ++y) {
+        const uint8_t* r0 = src + 2 * y * srcStride;
+        const uint8_t* r1 = r0 + srcStride;
+        uint8_t* d = dst + y * dstStride;
+        int x = 0;
+        // 16 source pixels -> 8 destination pixels per iteration.
+        if (n == 4) {
+            for (; x + 8 <= dw; x += 8) {
+                uint8x16x4_t a = vld4q_u8(r0 + x * 8);
+                uint8x16x4_t b = vld4q_u8(r1 + x * 8);
+                uint8x8x4_t out;
+                for (int c = 0; c < 4; ++c)
+                    out.val[c] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(a.val[c]), b.val[c]), 2);
+                vst4_u8(d + x * 4, out);
+            }
+        } else if (n == 3) {
+            for (; x + 8 <= dw; x += 8) {
+                uint8x16x3_t a = vld3q_u8(r0 + x * 6);
+                uint8x16x3_t b = vld3q_u8(r1 + x * 6);
+                uint8x8x3_t out;
+                for (int c = 0; c < 3; ++c)
+                    out.val[c] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(a.val[c]), b.val[c]), 2);
+                vst3_u8(d + x * 3, out);
+            }
+        } else {
+            for (; x + 8 <= dw; x += 8) {
+                uint16x8_t sum = vpadalq_u8(vpaddlq_u8(vld1q_u8(r0 + x * 2)), vld1q_u8(r1 + x * 2));
+                vst1_u8(d + x, vrshrn_n_u16(sum, 2));
+            }
+        }
+        if (x < dw)
+            scalar.downscale_2x(r0 + x * 2 * n, srcStride, (dw - x) * 2, 2, n, d + x * n, dstStride);
+    }
+}
+
+static const ImageKernels NEON_KERNELS = {
+    "neon",
+    neon_downscale_2x,
+};
+
+const ImageKernels* neon_image_kernels() {
+#if defined(__arm__)
+    // armeabi-v7a builds may still land on a core without NEON.
+    if (!(getauxval(AT_HWCAP) & HWCAP_NEON))
+        return nullptr;
+#endif
+    return &NEON_KERNELS;
+}
+
+#else
+
+const ImageKernels* neon_image_kernels() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "image-kernels.h"
+
+#if defined(__SSE2__)
+
+#include <immintrin.h>
+
+// SSE2 backend (the x86_64 baseline). Three-component downscaling gains
+// little from SSE shuffles without SSSE3, so it runs the scalar reference.
+// Downscaling is bound by loads of two source rows, which the SSE2 loop
+// already keeps up with, so there is no AVX2 variant.
+
+static void sse2_downscale_2x(const uint8_t* src, ptrdiff_t srcStride, int srcW, int srcH, int n,
+                              uint8_t* dst, ptrdiff_t dstStride) {
+    const ImageKernels& scalar = scalar_image_kernels();
+    if (n != 1 && n != 4) {
+        scalar.downscale_2x(src, srcStride, srcW, srcH, n, dst, dstStride);
+        return;
+    }
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    const __m128i ones = _mm_set1_epi16(1);
+    int dw = srcW / 2, dh = srcH / 2;
+    for (int y = 0; y < dh; ++y) {
+        const uint8_t* r0 = src + 2 * y * srcStride;
+        const uint8_t* r1 = r0 + srcStride;
+        uint8_t* d = dst + y * dstStride;
+        int x = 0;
+        if (n == 4) {
+            // 4 source pixels -> 2 destination pixels.
+            for (; x + 2 <= dw; x += 2) {
+                __m128i a = _mm_loadu_si128((const __m128i*)(r0 + x * 8));
+                __m128i b = _mm_loadu_si128((const __m128i*)(r1 + x * 8));
+                __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+                _mm_storel_epi64((__m128i*)(d + x * 4), _mm_packus_epi16(sum, sum));
+            }
+        } else {
+            // 16 source pixels -> 8 destination pixels.
+            for (; x + 8 <= dw; x += 8) {
+                __m128i a = _mm_loadu_si128((const __m128i*)(r0 + x * 2));
+                __m128i b = _mm_loadu_si128((const __m128i*)(r1 + x * 2));
+                __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                __m128i sum = _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+                _mm_storel_epi64((__m128i*)(d + x), _mm_packus_epi16(sum, sum));
+            }
+        }
+        if (x < dw)
+            scalar.downscale_2x(r0 + x * 2 * n, srcStride, (dw - x) * 2, 2, n, d + x * n, dstStride);
+    }
+}
+
+static const ImageKernels SSE2_KERNELS = {
+    "sse2",
+    sse2_downscale_2x,
+};
+
+const ImageKernels* sse2_image_kernels() {
+    return &SSE2_KERNELS;
+}
+
+#else
+
+const ImageKernels* sse2_image_kernels() {
+    return nullptr;
+}
+
+#endif
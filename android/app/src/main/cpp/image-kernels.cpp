@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "image-kernels.h"
+#include "native-log.h"
+
+// --- SCALAR REFERENCE ---
+
+static void scalar_downscale_2x(const uint8_t* src, ptrdiff_t srcStride, int srcW, int srcH, int n,
+                                uint8_t* dst, ptrdiff_t dstStride) {
+    int dw = srcW / 2, dh = srcH / 2;
+    for (int y = 0; y < dh; ++y) {
+        const uint8_t* r0 = src + 2 * y * srcStride;
+        const uint8_t* r1 = r0 + srcStride;
+        uint8_t* d = dst + y * dstStride;
+        for (int x = 0; x < dw; ++x) {
+            for (int c = 0; c < n; ++c) {
+                int i = 2 * x * n + c;
+                d[x * n + c] = (uint8_t)((r0[i] + r0[i + n] + r1[i] + r1[i + n] + 2) >> 2);
+            }
+        }
+    }
+}
+
+static const ImageKernels SCALAR_KERNELS = {
+    "scalar",
+    scalar_downscale_2x,
+};
+
+const ImageKernels& scalar_image_kernels() {
+    return SCALAR_KERNELS;
+}
+
+const ImageKernels& image_kernels() {
+    static const ImageKernels* selected = []() {
+        const ImageKernels* k = neon_image_kernels();
+        if (!k) k = sse2_image_kernels();
+        if (!k) k = &SCALAR_KERNELS;
+        LOGI("Image kernels: %s", k->name);
+        return k;
+    }();
+    return *selected;
+}
+
+// --- BENCHMARK ---
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs fn `rounds` times; returns the average time.
+template <typename Fn>
+static double time_kernel(int rounds, Fn fn) {
+    double total = 0;
+    for (int r = 0; r < rounds; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        total += elapsed_ms(start);
+    }
+    return total / rounds;
+}
+
+std::string benchmark_image_kernels(int width, int height) {
+    const int rounds = 5;
+    const size_t pixels = (size_t)width * height;
+
+    // Page-like test data: mostly paper white with noisy "ink".
+    std::vector<uint8_t> rgba(pixels * 4);
+    unsigned seed = 12345;
+    for (size_t i = 0; i < rgba.size(); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        rgba[i] = (seed >> 16) & 0x40 ? 0xFF : (uint8_t)(seed >> 24);
+    }
+    std::vector<uint8_t> rgb(pixels * 3);
+    for (size_t i = 0; i < pixels; ++i)
+        memcpy(&rgb[i * 3], &rgba[i * 4], 3);
+
+    const ImageKernels* backends[] = { &SCALAR_KERNELS, sse2_image_kernels(), neon_image_kernels() };
+    struct Reference { std::vector<uint8_t> down3, down4; } ref;
+
+    std::string json = "[";
+    bool first = true;
+    for (const ImageKernels* k : backends) {
+        if (!k) continue;
+        bool isScalar = k == &SCALAR_KERNELS;
+        std::vector<uint8_t> down3, down4;
+
+        double msDown3 = time_kernel(rounds, [&]() {
+            down3.resize((size_t)(width / 2) * (height / 2) * 3);
+            k->downscale_2x(rgb.data(), width * 3, width, height, 3, down3.data(), (width / 2) * 3);
+        });
+        double msDown4 = time_kernel(rounds, [&]() {
+            down4.resize((size_t)(width / 2) * (height / 2) * 4);
+            k->downscale_2x(rgba.data(), width * 4, width, height, 4, down4.data(), (width / 2) * 4);
+        });
+
+        bool matches = true;
+        if (isScalar)
+            ref = { down3, down4 };
+        else
+            matches = down3 == ref.down3 && down4 == ref.down4;
+
+        char entry[192];
+        snprintf(entry, sizeof(entry),
+                 "%s{\"backend\":\"%s\",\"downscale2xRgbMs\":%.3f,\"downscale2xRgbaMs\":%.3f,"
+                 "\"matchesScalar\":%s}",
+                 first ? "" : ",", k->name, msDown3, msDown4, matches ? "true" : "false");
+        json += entry;
+        first = false;
+        LOGI("Kernel benchmark %dx%d %-6s down3 %.2f down4 %.2f ms%s",
+             width, height, k->name, msDown3, msDown4, matches ? "" : " MISMATCH");
+    }
+    return json + "]";
+}
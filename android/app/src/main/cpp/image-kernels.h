@@ -0,0 +1,34 @@
+#ifndef BLUEPDF_IMAGE_KERNELS_H
+#define BLUEPDF_IMAGE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 8-bit image kernels used on fz_pixmap samples. Every backend produces
+// bit-identical results to the scalar reference implementation.
+struct ImageKernels {
+    const char* name;
+
+    // 2x2 box average of an n-component image into a (srcW/2)x(srcH/2)
+    // destination, rounded to nearest.
+    void (*downscale_2x)(const uint8_t* src, ptrdiff_t srcStride, int srcW, int srcH, int n,
+                         uint8_t* dst, ptrdiff_t dstStride);
+};
+
+// Portable reference implementation.
+const ImageKernels& scalar_image_kernels();
+
+// Best backend for this CPU (NEON on arm64 and NEON-capable armv7,
+// SSE2 on x86_64), chosen once at first use.
+const ImageKernels& image_kernels();
+
+// Backends compiled for the current architecture; null when unavailable.
+const ImageKernels* neon_image_kernels();
+const ImageKernels* sse2_image_kernels();
+
+// Time every kernel of every available backend against the scalar
+// reference on synthetic data and verify identical output. Returns JSON.
+std::string benchmark_image_kernels(int width, int height);
+
+#endif
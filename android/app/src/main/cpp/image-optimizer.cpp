@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+#include "image-optimizer.h"
+#include "doc-probe.h"
+#include "native-log.h"
+
+const OptimizePreset OPTIMIZE_PRESET_LIGHT = {
+    "light", 300, 200, 300, 200, 600, 300,
+    FZ_RECOMPRESS_SAME, FZ_RECOMPRESS_SAME, FZ_RECOMPRESS_SAME, 85 };
+const OptimizePreset OPTIMIZE_PRESET_BALANCED = {
+    "balanced", 225, 150, 225, 150, 450, 300,
+    FZ_RECOMPRESS_JPEG, FZ_RECOMPRESS_JPEG, FZ_RECOMPRESS_FAX, 70 };
+const OptimizePreset OPTIMIZE_PRESET_STRONG = {
+    "strong", 150, 100, 150, 100, 300, 200,
+    FZ_RECOMPRESS_JPEG, FZ_RECOMPRESS_JPEG, FZ_RECOMPRESS_FAX, 50 };
+const OptimizePreset OPTIMIZE_PRESET_COMPACT = {
+    "compact", 225, 150, 225, 150, 450, 300,
+    FZ_RECOMPRESS_J2K, FZ_RECOMPRESS_J2K, FZ_RECOMPRESS_FAX, 40 };
+
+static const char* image_class_name(int c) {
+    switch (c) {
+        case IMAGE_COLOR:   return "color";
+        case IMAGE_GRAY:    return "gray";
+        case IMAGE_BITONAL: return "bitonal";
+    }
+    return "unknown";
+}
+
+const OptimizePreset& optimize_preset_by_name(const char* name, const OptimizePreset& fallback) {
+    if (!name) return fallback;
+    if (strcmp(name, OPTIMIZE_PRESET_LIGHT.name) == 0) return OPTIMIZE_PRESET_LIGHT;
+    if (strcmp(name, OPTIMIZE_PRESET_BALANCED.name) == 0) return OPTIMIZE_PRESET_BALANCED;
+    if (strcmp(name, OPTIMIZE_PRESET_STRONG.name) == 0) return OPTIMIZE_PRESET_STRONG;
+    if (strcmp(name, OPTIMIZE_PRESET_COMPACT.name) == 0) return OPTIMIZE_PRESET_COMPACT;
+    return fallback;
+}
+
+pdf_image_rewriter_options optimize_rewriter_options(const OptimizePreset& preset, char quality[8]) {
+    pdf_image_rewriter_options opts;
+    memset(&opts, 0, sizeof(opts));
+    snprintf(quality, 8, "%d", preset.quality);
+
+    // Averaging is cheaper than bicubic and at least as good when shrinking.
+    opts.color_lossless_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+    opts.color_lossy_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+    opts.color_lossless_image_subsample_threshold = preset.colorThresholdDpi;
+    opts.color_lossless_image_subsample_to = preset.colorTargetDpi;
+    opts.color_lossy_image_subsample_threshold = preset.colorThresholdDpi;
+    opts.color_lossy_image_subsample_to = preset.colorTargetDpi;
+    opts.color_lossless_image_recompress_method = preset.losslessMethod;
+    opts.color_lossy_image_recompress_method = preset.lossyMethod;
+    opts.color_lossless_image_recompress_quality = quality;
+    opts.color_lossy_image_recompress_quality = quality;
+
+    opts.gray_lossless_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+    opts.gray_lossy_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+    opts.gray_lossless_image_subsample_threshold = preset.grayThresholdDpi;
+    opts.gray_lossless_image_subsample_to = preset.grayTargetDpi;
+    opts.gray_lossy_image_subsample_threshold = preset.grayThresholdDpi;
+    opts.gray_lossy_image_subsample_to = preset.grayTargetDpi;
+    opts.gray_lossless_image_recompress_method = preset.losslessMethod;
+    opts.gray_lossy_image_recompress_method = preset.lossyMethod;
+    opts.gray_lossless_image_recompress_quality = quality;
+    opts.gray_lossy_image_recompress_quality = quality;
+
+    opts.bitonal_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+    opts.bitonal_image_subsample_threshold = preset.bitonalThresholdDpi;
+    opts.bitonal_image_subsample_to = preset.bitonalTargetDpi;
+    opts.bitonal_image_recompress_method = preset.bitonalMethod;
+    opts.bitonal_image_recompress_quality = quality;
+    return opts;
+}
+
+static ImageClass classify_image(fz_context* ctx, pdf_obj* image) {
+    if (pdf_dict_get_bool(ctx, image, PDF_NAME(ImageMask)) ||
+        pdf_dict_get_int(ctx, image, PDF_NAME(BitsPerComponent)) == 1)
+        return IMAGE_BITONAL;
+
+    // JPX images may leave the colorspace to the codestream.
+    pdf_obj* csobj = pdf_dict_get(ctx, image, PDF_NAME(ColorSpace));
+    if (!csobj) return IMAGE_COLOR;
+
+    fz_colorspace* cs = pdf_load_colorspace(ctx, csobj);
+    fz_colorspace* base = fz_colorspace_is_indexed(ctx, cs) ? fz_base_colorspace(ctx, cs) : cs;
+    int n = fz_colorspace_n(ctx, base);
+    fz_drop_colorspace(ctx, cs);
+    return n == 1 ? IMAGE_GRAY : IMAGE_COLOR;
+}
+
+static void add_image(fz_context* ctx, pdf_obj* image, ImageClass c, std::set<int>& seen, ImageSizes& sizes) {
+    sizes.count[c]++;
+    sizes.bytes[c] += pdf_dict_get_int64(ctx, image, PDF_NAME(Length));
+
+    // Soft masks are gray images of their own, rewritten like the rest.
+    pdf_obj* smask = pdf_dict_get(ctx, image, PDF_NAME(SMask));
+    if (pdf_is_indirect(ctx, smask) && seen.insert(pdf_to_num(ctx, smask)).second)
+        add_image(ctx, smask, IMAGE_GRAY, seen, sizes);
+}
+
+static void measure_resources(fz_context* ctx, pdf_obj* resources, std::set<int>& seen, ImageSizes& sizes) {
+    pdf_obj* xobjects = pdf_dict_get(ctx, resources, PDF_NAME(XObject));
+    int n = pdf_dict_len(ctx, xobjects);
+
+    for (int i = 0; i < n; ++i) {
+        pdf_obj* xobj = pdf_dict_get_val(ctx, xobjects, i);
+        // XObjects are streams and so always indirect; the object number
+        // also stops form XObjects that draw themselves.
+        if (!pdf_is_indirect(ctx, xobj) || !seen.insert(pdf_to_num(ctx, xobj)).second)
+            continue;
+
+        fz_try(ctx) {
+            pdf_obj* subtype = pdf_dict_get(ctx, xobj, PDF_NAME(Subtype));
+            if (pdf_name_eq(ctx, subtype, PDF_NAME(Image)))
+                add_image(ctx, xobj, classify_image(ctx, xobj), seen, sizes);
+            else if (pdf_name_eq(ctx, subtype, PDF_NAME(Form)))
+                measure_resources(ctx, pdf_dict_get(ctx, xobj, PDF_NAME(Resources)), seen, sizes);
+        } fz_catch(ctx) {
+            LOGI("Optimize: skipping XObject %d: %s", pdf_to_num(ctx, xobj), fz_caught_message(ctx));
+        }
+    }
+}
+
+ImageSizes measure_images(fz_context* ctx, pdf_document* doc) {
+    ImageSizes sizes;
+    std::set<int> seen;
+    int pages = pdf_count_pages(ctx, doc);
+
+    for (int i = 0; i < pages; ++i) {
+        fz_try(ctx) {
+            pdf_obj* page = pdf_lookup_page_obj(ctx, doc, i);
+            measure_resources(ctx, pdf_dict_get_inheritable(ctx, page, PDF_NAME(Resources)), seen, sizes);
+        } fz_catch(ctx) {
+            LOGI("Optimize: skipping resources of page %d: %s", i + 1, fz_caught_message(ctx));
+        }
+    }
+    return sizes;
+}
+
+std::string optimize_summary_json(const OptimizePreset& preset, const ImageSizes& before,
+                                  const ImageSizes& after, long long outputBytes) {
+    char buf[160];
+    std::string json = "{\"preset\":";
+    append_json_string(json, preset.name);
+    snprintf(buf, sizeof(buf), ",\"outputBytes\":%lld", outputBytes);
+    json += buf;
+
+    for (int c = 0; c < IMAGE_CLASS_COUNT; ++c) {
+        snprintf(buf, sizeof(buf), ",\"%s\":{\"count\":%d,\"before\":%lld,\"after\":%lld}",
+                 image_class_name(c), before.count[c], before.bytes[c], after.bytes[c]);
+        json += buf;
+    }
+    return json + "}";
+}
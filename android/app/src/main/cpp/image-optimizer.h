@@ -0,0 +1,59 @@
+#ifndef BLUEPDF_IMAGE_OPTIMIZER_H
+#define BLUEPDF_IMAGE_OPTIMIZER_H
+
+#include <string>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+    #include "mupdf/pdf.h"
+}
+
+// How optimize_document() rewrites the images of a PDF. Images above
+// threshold DPI (as placed on the page) are subsampled to target DPI;
+// 0 leaves them at their resolution. "light" only trims print-resolution
+// scans, "balanced" suits reading on screen, "strong" trades visible
+// quality for size and "compact" uses JPEG 2000 instead of JPEG.
+struct OptimizePreset {
+    const char* name;
+    int colorThresholdDpi, colorTargetDpi;      // color images
+    int grayThresholdDpi, grayTargetDpi;        // one component images
+    int bitonalThresholdDpi, bitonalTargetDpi;  // 1 bit images and masks
+    int lossyMethod;      // FZ_RECOMPRESS_* for DCT and JPX images
+    int losslessMethod;   // FZ_RECOMPRESS_* for Flate, LZW and raw images
+    int bitonalMethod;    // FZ_RECOMPRESS_* for bitonal images
+    int quality;          // JPEG or JPEG 2000 quality (0-100)
+};
+
+extern const OptimizePreset OPTIMIZE_PRESET_LIGHT;
+extern const OptimizePreset OPTIMIZE_PRESET_BALANCED;
+extern const OptimizePreset OPTIMIZE_PRESET_STRONG;
+extern const OptimizePreset OPTIMIZE_PRESET_COMPACT;
+
+// Look a preset up by name, falling back to the given default for null or
+// unknown names.
+const OptimizePreset& optimize_preset_by_name(const char* name, const OptimizePreset& fallback);
+
+// Rewriter options for preset. The quality strings point into quality,
+// which must outlive the options.
+pdf_image_rewriter_options optimize_rewriter_options(const OptimizePreset& preset, char quality[8]);
+
+// The classes images are rewritten by.
+enum ImageClass { IMAGE_COLOR, IMAGE_GRAY, IMAGE_BITONAL, IMAGE_CLASS_COUNT };
+
+// Image XObjects and their stored (compressed) bytes, by class.
+struct ImageSizes {
+    int count[IMAGE_CLASS_COUNT] = {};
+    long long bytes[IMAGE_CLASS_COUNT] = {};
+};
+
+// Sum the image XObjects the pages use, directly or through form
+// XObjects, counting shared images once. Inline images are part of the
+// content streams and not counted. Unreadable images are skipped.
+ImageSizes measure_images(fz_context* ctx, pdf_document* doc);
+
+// {"preset":..,"outputBytes":..,"color":{"count":..,"before":..,"after":..},
+//  "gray":{..},"bitonal":{..}} for the optimize job summary.
+std::string optimize_summary_json(const OptimizePreset& preset, const ImageSizes& before,
+                                  const ImageSizes& after, long long outputBytes);
+
+#endif
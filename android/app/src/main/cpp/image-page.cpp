@@ -0,0 +1,283 @@
+#include <cmath>
+#include <cstring>
+
+#include "image-kernels.h"
+#include "image-page.h"
+
+// Clips nested deeper than this are not worth following.
+#define PROBE_CLIP_DEPTH 16
+
+// Counting device: remembers the first opaque image and flags anything
+// else that would leave marks on the page. Invisible (OCR) text is fine.
+// Rectangular clip paths are tracked as a stack of their intersections;
+// any other clip rejects the page, since the fast path draws unclipped.
+struct ImageProbeDevice {
+    fz_device super;
+    fz_image* image;
+    fz_matrix ctm;
+    fz_rect imageClip;  // the clip in force when the image was drawn
+    fz_rect clips[PROBE_CLIP_DEPTH];
+    int depth;
+    int images;
+    int other;
+};
+
+static fz_rect probe_current_clip(ImageProbeDevice* probe) {
+    return probe->depth ? probe->clips[probe->depth - 1] : fz_infinite_rect;
+}
+
+static void probe_reject(fz_context* ctx, fz_device* dev) {
+    ((ImageProbeDevice*)dev)->other++;
+    // Nothing after this can make the page eligible again.
+    fz_throw(ctx, FZ_ERROR_ABORT, "not a single image page");
+}
+
+static void probe_fill_path(fz_context* ctx, fz_device* dev, const fz_path*, int, fz_matrix,
+                            fz_colorspace*, const float*, float, fz_color_params) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_stroke_path(fz_context* ctx, fz_device* dev, const fz_path*, const fz_stroke_state*,
+                              fz_matrix, fz_colorspace*, const float*, float, fz_color_params) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_clip_path(fz_context* ctx, fz_device* dev, const fz_path* path, int, fz_matrix ctm, fz_rect) {
+    ImageProbeDevice* probe = (ImageProbeDevice*)dev;
+    fz_rect bounds;
+    if (probe->depth == PROBE_CLIP_DEPTH || !fz_path_is_rect_with_bounds(ctx, path, ctm, &bounds))
+        probe_reject(ctx, dev);
+    probe->clips[probe->depth] = fz_intersect_rect(probe_current_clip(probe), bounds);
+    probe->depth++;
+}
+
+static void probe_clip_stroke_path(fz_context* ctx, fz_device* dev, const fz_path*, const fz_stroke_state*,
+                                   fz_matrix, fz_rect) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_clip_text(fz_context* ctx, fz_device* dev, const fz_text*, fz_matrix, fz_rect) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_clip_stroke_text(fz_context* ctx, fz_device* dev, const fz_text*, const fz_stroke_state*,
+                                   fz_matrix, fz_rect) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_clip_image_mask(fz_context* ctx, fz_device* dev, fz_image*, fz_matrix, fz_rect) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_pop_clip(fz_context* ctx, fz_device* dev) {
+    ImageProbeDevice* probe = (ImageProbeDevice*)dev;
+    if (probe->depth > 0) probe->depth--;
+}
+
+static void probe_fill_text(fz_context* ctx, fz_device* dev, const fz_text*, fz_matrix,
+                            fz_colorspace*, const float*, float, fz_color_params) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_stroke_text(fz_context* ctx, fz_device* dev, const fz_text*, const fz_stroke_state*,
+                              fz_matrix, fz_colorspace*, const float*, float, fz_color_params) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_fill_shade(fz_context* ctx, fz_device* dev, fz_shade*, fz_matrix, float, fz_color_params) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_fill_image(fz_context* ctx, fz_device* dev, fz_image* image, fz_matrix ctm,
+                             float alpha, fz_color_params) {
+    ImageProbeDevice* probe = (ImageProbeDevice*)dev;
+    bool axisAligned = ctm.b == 0 && ctm.c == 0 && ctm.a > 0 && ctm.d > 0;
+    bool opaque = alpha >= 1.0f && !image->mask && !image->imagemask && !image->use_colorkey;
+    if (probe->images++ || !axisAligned || !opaque || image->orientation > 1) {
+        probe_reject(ctx, dev);
+    }
+    probe->image = fz_keep_image(ctx, image);
+    probe->ctm = ctm;
+    probe->imageClip = probe_current_clip(probe);
+}
+
+static void probe_fill_image_mask(fz_context* ctx, fz_device* dev, fz_image*, fz_matrix,
+                                  fz_colorspace*, const float*, float, fz_color_params) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_begin_group(fz_context* ctx, fz_device* dev, fz_rect, fz_colorspace*, int, int, int, float) {
+    probe_reject(ctx, dev);
+}
+
+static void probe_begin_mask(fz_context* ctx, fz_device* dev, fz_rect, int, fz_colorspace*, const float*, fz_color_params) {
+    probe_reject(ctx, dev);
+}
+
+static int probe_begin_tile(fz_context* ctx, fz_device* dev, fz_rect, fz_rect, float, float, fz_matrix, int, int) {
+    probe_reject(ctx, dev);
+    return 0;
+}
+
+static void probe_drop_device(fz_context* ctx, fz_device* dev) {
+    fz_drop_image(ctx, ((ImageProbeDevice*)dev)->image);
+}
+
+// Only pages drawing exactly one Image XObject (and no forms, which could
+// hide anything) are worth running through the probe.
+static bool has_single_image_xobject(fz_context* ctx, pdf_page* page) {
+    pdf_obj* resources = pdf_page_resources(ctx, page);
+    pdf_obj* xobjects = pdf_dict_get(ctx, resources, PDF_NAME(XObject));
+    if (pdf_dict_len(ctx, xobjects) != 1) return false;
+    pdf_obj* xobj = pdf_dict_get_val(ctx, xobjects, 0);
+    return pdf_name_eq(ctx, pdf_dict_get(ctx, xobj, PDF_NAME(Subtype)), PDF_NAME(Image));
+}
+
+bool find_single_image_page(fz_context* ctx, fz_page* page, SingleImagePage* result) {
+    pdf_page* pdfPage = pdf_page_from_fz_page(ctx, page);
+    if (!pdfPage || !has_single_image_xobject(ctx, pdfPage)) return false;
+
+    ImageProbeDevice* probe = fz_new_derived_device(ctx, ImageProbeDevice);
+    probe->super.drop_device = probe_drop_device;
+    probe->super.fill_path = probe_fill_path;
+    probe->super.stroke_path = probe_stroke_path;
+    probe->super.clip_path = probe_clip_path;
+    probe->super.clip_stroke_path = probe_clip_stroke_path;
+    probe->super.clip_text = probe_clip_text;
+    probe->super.clip_stroke_text = probe_clip_stroke_text;
+    probe->super.clip_image_mask = probe_clip_image_mask;
+    probe->super.pop_clip = probe_pop_clip;
+    probe->super.fill_text = probe_fill_text;
+    probe->super.stroke_text = probe_stroke_text;
+    probe->super.fill_shade = probe_fill_shade;
+    probe->super.fill_image = probe_fill_image;
+    probe->super.fill_image_mask = probe_fill_image_mask;
+    probe->super.begin_group = probe_begin_group;
+    probe->super.begin_mask = probe_begin_mask;
+    probe->super.begin_tile = probe_begin_tile;
+
+    bool found = false;
+    fz_try(ctx) {
+        fz_run_page(ctx, page, &probe->super, fz_identity, nullptr);
+        fz_close_device(ctx, &probe->super);
+
+        if (probe->images == 1 && probe->other == 0) {
+            // A clip that cuts into the image would need the real renderer.
+            fz_rect imageRect = fz_transform_rect(fz_unit_rect, probe->ctm);
+            if (fz_contains_rect(probe->imageClip, imageRect)) {
+                result->image = fz_keep_image(ctx, probe->image);
+                result->ctm = probe->ctm;
+                found = true;
+            }
+        }
+    } fz_always(ctx) {
+        fz_drop_device(ctx, &probe->super);
+    } fz_catch(ctx) {
+        if (fz_caught(ctx) != FZ_ERROR_ABORT) fz_rethrow(ctx);
+        found = false;
+    }
+    return found;
+}
+
+void drop_single_image_page(fz_context* ctx, SingleImagePage* result) {
+    fz_drop_image(ctx, result->image);
+    result->image = nullptr;
+}
+
+// Box-filter halving with the SIMD kernels. Much cheaper than the general
+// resampler for the large power-of-two reductions typical of scans.
+static fz_pixmap* halve_pixmap(fz_context* ctx, fz_pixmap* src) {
+    fz_pixmap* half = fz_new_pixmap(ctx, src->colorspace, src->w / 2, src->h / 2, src->seps, src->alpha);
+    image_kernels().downscale_2x(src->samples, src->stride, src->w, src->h, src->n, half->samples, half->stride);
+    return half;
+}
+
+void draw_single_image_page(fz_context* ctx, const SingleImagePage& sip, float scale, fz_pixmap* dest) {
+    fz_matrix m = fz_concat(sip.ctm, fz_scale(scale, scale));
+    fz_irect target = fz_round_rect(fz_transform_rect(fz_unit_rect, m));
+    int dstW = target.x1 - target.x0;
+    int dstH = target.y1 - target.y0;
+
+    fz_clear_pixmap_with_value(ctx, dest, 0xFF);
+    if (dstW <= 0 || dstH <= 0) return;
+
+    fz_pixmap* decoded = nullptr;
+    fz_pixmap* reduced = nullptr;
+    fz_pixmap* scaled = nullptr;
+    fz_pixmap* rgb = nullptr;
+
+    fz_var(decoded);
+    fz_var(reduced);
+    fz_var(scaled);
+    fz_var(rgb);
+    fz_try(ctx) {
+        // Passing the final matrix lets MuPDF reduce the decode (JPEG DCT
+        // scaling, JPX resolution levels, or subsampling) to the smallest
+        // size that still covers the target.
+        fz_matrix decodeCtm = m;
+        int w = dstW, h = dstH;
+        decoded = fz_get_pixmap_from_image(ctx, sip.image, nullptr, &decodeCtm, &w, &h);
+
+        fz_pixmap* src = decoded;
+        while (src->w >= 2 * dstW && src->h >= 2 * dstH) {
+            fz_pixmap* half = halve_pixmap(ctx, src);
+            fz_drop_pixmap(ctx, reduced);
+            reduced = half;
+            src = reduced;
+        }
+
+        if (fz_pixmap_width(ctx, src) != dstW || fz_pixmap_height(ctx, src) != dstH) {
+            scaled = fz_scale_pixmap(ctx, src, 0, 0, (float)dstW, (float)dstH, nullptr);
+            if (!scaled) fz_throw(ctx, FZ_ERROR_GENERIC, "cannot scale page image");
+            src = scaled;
+        }
+
+        if (fz_pixmap_width(ctx, src) != dstW || fz_pixmap_height(ctx, src) != dstH)
+            fz_throw(ctx, FZ_ERROR_GENERIC, "page image scaled to unexpected size");
+
+        if (fz_pixmap_colorspace(ctx, src) != fz_device_rgb(ctx) || fz_pixmap_alpha(ctx, src)) {
+            rgb = fz_convert_pixmap(ctx, src, fz_device_rgb(ctx), nullptr, nullptr, fz_default_color_params, 0);
+            src = rgb;
+        }
+
+        // Copy the image into the page pixmap, clipped to the page.
+        fz_irect destBox = fz_pixmap_bbox(ctx, dest);
+        fz_irect area = fz_intersect_irect(target, destBox);
+        if (!fz_is_empty_irect(area)) {
+            int n = fz_pixmap_components(ctx, dest);
+            size_t rowBytes = (size_t)(area.x1 - area.x0) * n;
+            const unsigned char* srcSamples = fz_pixmap_samples(ctx, src);
+            unsigned char* dstSamples = fz_pixmap_samples(ctx, dest);
+            ptrdiff_t srcStride = fz_pixmap_stride(ctx, src);
+            ptrdiff_t dstStride = fz_pixmap_stride(ctx, dest);
+
+            for (int y = area.y0; y < area.y1; ++y) {
+                const unsigned char* s = srcSamples + (y - target.y0) * srcStride + (area.x0 - target.x0) * n;
+                unsigned char* d = dstSamples + (y - destBox.y0) * dstStride + (area.x0 - destBox.x0) * n;
+                memcpy(d, s, rowBytes);
+            }
+        }
+    } fz_always(ctx) {
+        fz_drop_pixmap(ctx, rgb);
+        fz_drop_pixmap(ctx, scaled);
+        fz_drop_pixmap(ctx, reduced);
+        fz_drop_pixmap(ctx, decoded);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+fz_image* load_page_thumbnail(fz_context* ctx, fz_page* page, int minWidth) {
+    pdf_page* pdfPage = pdf_page_from_fz_page(ctx, page);
+    if (!pdfPage) return nullptr;
+
+    pdf_obj* thumb = pdf_dict_get(ctx, pdfPage->obj, PDF_NAME(Thumb));
+    if (!pdf_is_stream(ctx, thumb)) return nullptr;
+
+    fz_image* image = pdf_load_image(ctx, pdfPage->doc, thumb);
+    if (image->w < minWidth) {
+        fz_drop_image(ctx, image);
+        return nullptr;
+    }
+    return image;
+}
@@ -0,0 +1,32 @@
+#ifndef BLUEPDF_IMAGE_PAGE_H
+#define BLUEPDF_IMAGE_PAGE_H
+
+extern "C" {
+    #include "mupdf/fitz.h"
+    #include "mupdf/pdf.h"
+}
+
+// A page whose only visible content is one opaque, axis-aligned image,
+// which is what scanners and imageToPdfNative produce.
+struct SingleImagePage {
+    fz_image* image;   // owned; drop with drop_single_image_page()
+    fz_matrix ctm;     // image placement in page space (unit square -> page)
+};
+
+// Detect a single-image page. A cheap resource dictionary check rules out
+// pages with fonts or several XObjects before the (tiny) content stream is
+// run through a counting device; images are never decoded here.
+// Returns false and leaves result untouched for any other page.
+bool find_single_image_page(fz_context* ctx, fz_page* page, SingleImagePage* result);
+void drop_single_image_page(fz_context* ctx, SingleImagePage* result);
+
+// Decode the page image straight to its on-page size at the given scale,
+// letting MuPDF pick a subsampled or DCT-scaled decode, and place it on a
+// white RGB pixmap covering the page. dest must already have the page bbox.
+void draw_single_image_page(fz_context* ctx, const SingleImagePage& sip, float scale, fz_pixmap* dest);
+
+// The page's embedded /Thumb image, if present and at least minWidth wide.
+// Returns null otherwise.
+fz_image* load_page_thumbnail(fz_context* ctx, fz_page* page, int minWidth);
+
+#endif
@@ -0,0 +1,374 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+    #include "mupdf/pdf.h"
+}
+
+#include "input-stream.h"
+#include "native-log.h"
+
+static const size_t FD_STREAM_BUFFER = 64 * 1024;
+
+bool parse_fd_source(const char* source, int* fd) {
+    if (strncmp(source, "fd:", 3) != 0) return false;
+    char* end = nullptr;
+    errno = 0;
+    long n = strtol(source + 3, &end, 10);
+    if (end == source + 3 || *end != '\0' || errno != 0 || n < 0 || n > INT32_MAX)
+        *fd = -1;
+    else
+        *fd = (int)n;
+    return true;
+}
+
+int open_source_fd(const char* source) {
+    int fd;
+    if (parse_fd_source(source, &fd)) {
+        if (fd < 0) {
+            errno = EBADF;
+            return -1;
+        }
+        // The duplicate shares the file offset, but every read here is
+        // pread or mmap, so the caller's descriptor is left as it was.
+        return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    }
+    return open(source, O_RDONLY | O_CLOEXEC);
+}
+
+struct FdStream {
+    int fd;
+    bool ownFd;
+    int64_t fileSize;
+    unsigned char* tail;
+    size_t tailLen;
+    unsigned char buffer[FD_STREAM_BUFFER];
+};
+
+static int next_fd(fz_context* ctx, fz_stream* stm, size_t max) {
+    FdStream* state = (FdStream*)stm->state;
+    int64_t pos = stm->pos;
+    size_t n = 0;
+
+    if (pos < state->fileSize) {
+        size_t want = (size_t)fz_mini((int64_t)FD_STREAM_BUFFER, state->fileSize - pos);
+        ssize_t got;
+        do {
+            got = pread(state->fd, state->buffer, want, (off_t)pos);
+        } while (got < 0 && errno == EINTR);
+        if (got < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "pread failed: %s", strerror(errno));
+        n = (size_t)got;
+    } else if (pos < state->fileSize + (int64_t)state->tailLen) {
+        n = (size_t)fz_mini((int64_t)FD_STREAM_BUFFER, state->fileSize + (int64_t)state->tailLen - pos);
+        memcpy(state->buffer, state->tail + (pos - state->fileSize), n);
+    }
+
+    stm->rp = state->buffer;
+    stm->wp = state->buffer + n;
+    stm->pos += (int64_t)n;
+    if (n == 0) return EOF;
+    return *stm->rp++;
+}
+
+static void seek_fd(fz_context* ctx, fz_stream* stm, int64_t offset, int whence) {
+    FdStream* state = (FdStream*)stm->state;
+    int64_t total = state->fileSize + (int64_t)state->tailLen;
+    int64_t pos;
+    switch (whence) {
+        case SEEK_END: pos = total + offset; break;
+        case SEEK_CUR: pos = stm->pos - (stm->wp - stm->rp) + offset; break;
+        default: pos = offset; break;
+    }
+    if (pos < 0 || pos > total) fz_throw(ctx, FZ_ERROR_ARGUMENT, "cannot seek to %lld", (long long)pos);
+
+    stm->pos = pos;
+    stm->rp = stm->wp = state->buffer;
+}
+
+static void drop_fd(fz_context* ctx, void* opaque) {
+    FdStream* state = (FdStream*)opaque;
+    if (state->ownFd) close(state->fd);
+    fz_free(ctx, state->tail);
+    fz_free(ctx, state);
+}
+
+fz_stream* open_fd_stream(fz_context* ctx, int fd, bool ownFd, const unsigned char* tail, size_t tailLen) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        if (ownFd) close(fd);
+        fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot stat descriptor: %s", strerror(errno));
+    }
+
+    FdStream* state = nullptr;
+    fz_var(state);
+    fz_try(ctx) {
+        state = fz_malloc_struct(ctx, FdStream);
+        state->fd = fd;
+        state->ownFd = ownFd;
+        state->fileSize = (int64_t)st.st_size;
+        if (tailLen) {
+            state->tail = (unsigned char*)fz_malloc(ctx, tailLen);
+            memcpy(state->tail, tail, tailLen);
+            state->tailLen = tailLen;
+        }
+    } fz_catch(ctx) {
+        if (state) fz_free(ctx, state->tail);
+        fz_free(ctx, state);
+        if (ownFd) close(fd);
+        fz_rethrow(ctx);
+    }
+
+    fz_stream* stm = fz_new_stream(ctx, state, next_fd, drop_fd);
+    stm->seek = seek_fd;
+    return stm;
+}
+
+// --- MEMORY MAPPED ---
+
+// Most of the mapping handed to MuPDF at once. Touching a page the file
+// no longer covers raises SIGBUS, so each window is checked against the
+// file's current size first; a source truncated while open then fails
+// with an error instead of killing the process.
+static const int64_t MMAP_WINDOW_BYTES = 1024 * 1024;
+
+struct MmapStream {
+    int fd;
+    bool ownFd;
+    const unsigned char* map;
+    int64_t fileSize;
+    unsigned char* tail;
+    size_t tailLen;
+};
+
+// Hands out the next window of the mapping (or the rest of the tail) in
+// one go; MuPDF reads straight from the page cache.
+static int next_mmap(fz_context* ctx, fz_stream* stm, size_t max) {
+    MmapStream* state = (MmapStream*)stm->state;
+    int64_t pos = stm->pos;
+
+    if (pos < state->fileSize) {
+        int64_t end = fz_mini(state->fileSize, pos + MMAP_WINDOW_BYTES);
+        struct stat st;
+        if (fstat(state->fd, &st) != 0)
+            fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot stat mapped file: %s", strerror(errno));
+        if ((int64_t)st.st_size < end)
+            fz_throw(ctx, FZ_ERROR_SYSTEM, "file shrank to %lld bytes while open", (long long)st.st_size);
+        stm->rp = (unsigned char*)state->map + pos;
+        stm->wp = (unsigned char*)state->map + end;
+        stm->pos = end;
+    } else if (pos < state->fileSize + (int64_t)state->tailLen) {
+        stm->rp = state->tail + (pos - state->fileSize);
+        stm->wp = state->tail + state->tailLen;
+        stm->pos = state->fileSize + (int64_t)state->tailLen;
+    } else {
+        return EOF;
+    }
+    return *stm->rp++;
+}
+
+static void seek_mmap(fz_context* ctx, fz_stream* stm, int64_t offset, int whence) {
+    MmapStream* state = (MmapStream*)stm->state;
+    int64_t total = state->fileSize + (int64_t)state->tailLen;
+    int64_t pos;
+    switch (whence) {
+        case SEEK_END: pos = total + offset; break;
+        case SEEK_CUR: pos = stm->pos - (stm->wp - stm->rp) + offset; break;
+        default: pos = offset; break;
+    }
+    if (pos < 0 || pos > total) fz_throw(ctx, FZ_ERROR_ARGUMENT, "cannot seek to %lld", (long long)pos);
+
+    stm->pos = pos;
+    stm->rp = stm->wp = nullptr;
+}
+
+static void drop_mmap(fz_context* ctx, void* opaque) {
+    MmapStream* state = (MmapStream*)opaque;
+    munmap((void*)state->map, (size_t)state->fileSize);
+    if (state->ownFd) close(state->fd);
+    fz_free(ctx, state->tail);
+    fz_free(ctx, state);
+}
+
+// Returns null when the file cannot be mapped; fd stays open and owned by
+// the caller then. Otherwise the stream keeps fd to check the file's size
+// and, with ownFd, closes it when dropped.
+static fz_stream* open_mmap_stream(fz_context* ctx, int fd, bool ownFd, int advice,
+                                   const unsigned char* tail, size_t tailLen) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) return nullptr;
+
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        LOGI("mmap of %lld bytes failed: %s", (long long)st.st_size, strerror(errno));
+        return nullptr;
+    }
+    madvise(map, (size_t)st.st_size, advice);
+
+    MmapStream* state = nullptr;
+    fz_var(state);
+    fz_try(ctx) {
+        state = fz_malloc_struct(ctx, MmapStream);
+        state->fd = fd;
+        state->ownFd = ownFd;
+        state->map = (const unsigned char*)map;
+        state->fileSize = (int64_t)st.st_size;
+        if (tailLen) {
+            state->tail = (unsigned char*)fz_malloc(ctx, tailLen);
+            memcpy(state->tail, tail, tailLen);
+            state->tailLen = tailLen;
+        }
+    } fz_catch(ctx) {
+        if (state) fz_free(ctx, state->tail);
+        fz_free(ctx, state);
+        munmap(map, (size_t)st.st_size);
+        fz_rethrow(ctx);
+    }
+
+    fz_stream* stm = fz_new_stream(ctx, state, next_mmap, drop_mmap);
+    stm->seek = seek_mmap;
+    return stm;
+}
+
+InputAccess input_access_by_name(const char* name, InputAccess fallback) {
+    if (!name || !*name) return fallback;
+    if (strcmp(name, "buffered") == 0) return InputAccess::BUFFERED;
+    if (strcmp(name, "sequential") == 0) return InputAccess::SEQUENTIAL;
+    if (strcmp(name, "random") == 0) return InputAccess::RANDOM;
+    return fallback;
+}
+
+const char* input_access_name(InputAccess access) {
+    switch (access) {
+        case InputAccess::SEQUENTIAL: return "sequential";
+        case InputAccess::RANDOM: return "random";
+        default: return "buffered";
+    }
+}
+
+fz_stream* open_input_stream(fz_context* ctx, int fd, bool ownFd, InputAccess access,
+                             const unsigned char* tail, size_t tailLen) {
+    if (access != InputAccess::BUFFERED) {
+        fz_stream* stm = nullptr;
+        fz_try(ctx) {
+            stm = open_mmap_stream(ctx, fd, ownFd, access == InputAccess::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM,
+                                   tail, tailLen);
+        } fz_catch(ctx) {
+            if (ownFd) close(fd);
+            fz_rethrow(ctx);
+        }
+        if (stm) return stm;
+    }
+    return open_fd_stream(ctx, fd, ownFd, tail, tailLen);
+}
+
+// --- BENCHMARK ---
+
+// Pages run through the bbox device per document pass.
+static const int BENCHMARK_PAGES = 20;
+static const int BENCHMARK_ROUNDS = 3;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// "stdio" is fz_open_file, the stream behind fz_open_document(path).
+static fz_stream* open_benchmark_stream(fz_context* ctx, const char* path, const char* mode) {
+    if (strcmp(mode, "stdio") == 0) return fz_open_file(ctx, path);
+    int fd = open_source_fd(path);
+    if (fd < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot open %s: %s", path, strerror(errno));
+    return open_input_stream(ctx, fd, true, input_access_by_name(mode, InputAccess::BUFFERED));
+}
+
+static size_t read_all(fz_context* ctx, fz_stream* stm) {
+    size_t total = 0;
+    unsigned char chunk[16 * 1024];
+    size_t n;
+    while ((n = fz_read(ctx, stm, chunk, sizeof(chunk))) > 0) total += n;
+    return total;
+}
+
+static void run_document(fz_context* ctx, fz_stream* stm) {
+    pdf_document* doc = nullptr;
+    fz_page* page = nullptr;
+    fz_device* dev = nullptr;
+
+    fz_var(doc);
+    fz_var(page);
+    fz_var(dev);
+    fz_try(ctx) {
+        doc = pdf_open_document_with_stream(ctx, stm);
+        int pages = fz_mini(pdf_count_pages(ctx, doc), BENCHMARK_PAGES);
+        for (int i = 0; i < pages; ++i) {
+            fz_rect bbox;
+            page = fz_load_page(ctx, (fz_document*)doc, i);
+            dev = fz_new_bbox_device(ctx, &bbox);
+            fz_run_page(ctx, page, dev, fz_identity, nullptr);
+            fz_close_device(ctx, dev);
+            fz_drop_device(ctx, dev);
+            dev = nullptr;
+            fz_drop_page(ctx, page);
+            page = nullptr;
+        }
+    } fz_always(ctx) {
+        fz_drop_device(ctx, dev);
+        fz_drop_page(ctx, page);
+        pdf_drop_document(ctx, doc);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+std::string benchmark_input_streams(fz_context* ctx, const char* path) {
+    static const char* const modes[] = { "stdio", "buffered", "sequential", "random" };
+    std::string json = "[";
+    char entry[256];
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+        double readMs = 0, openMs = 0;
+        size_t bytes = 0;
+        fz_stream* stm = nullptr;
+
+        fz_var(readMs);
+        fz_var(openMs);
+        fz_var(bytes);
+        fz_var(stm);
+        fz_try(ctx) {
+            for (int r = 0; r < BENCHMARK_ROUNDS; ++r) {
+                auto start = std::chrono::steady_clock::now();
+                stm = open_benchmark_stream(ctx, path, modes[m]);
+                bytes = read_all(ctx, stm);
+                fz_drop_stream(ctx, stm);
+                stm = nullptr;
+                readMs += elapsed_ms(start);
+
+                start = std::chrono::steady_clock::now();
+                stm = open_benchmark_stream(ctx, path, modes[m]);
+                run_document(ctx, stm);
+                fz_drop_stream(ctx, stm);
+                stm = nullptr;
+                openMs += elapsed_ms(start);
+            }
+        } fz_always(ctx) {
+            fz_drop_stream(ctx, stm);
+        } fz_catch(ctx) {
+            LOGI("Stream benchmark (%s) failed: %s", modes[m], fz_caught_message(ctx));
+            readMs = openMs = -1;
+        }
+
+        if (readMs > 0) readMs /= BENCHMARK_ROUNDS;
+        if (openMs > 0) openMs /= BENCHMARK_ROUNDS;
+        snprintf(entry, sizeof(entry), "%s{\"stream\":\"%s\",\"bytes\":%zu,\"readMs\":%.2f,\"openAndRunMs\":%.2f}",
+                 m ? "," : "", modes[m], bytes, readMs, openMs);
+        json += entry;
+        LOGI("Stream benchmark %-10s read %.2f ms, open+run %.2f ms", modes[m], readMs, openMs);
+    }
+    return json + "]";
+}
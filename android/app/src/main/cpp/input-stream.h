@@ -0,0 +1,53 @@
+#ifndef BLUEPDF_INPUT_STREAM_H
+#define BLUEPDF_INPUT_STREAM_H
+
+#include <cstddef>
+#include <string>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+// Open a document source for reading. A source is a filesystem path or
+// "fd:N", a descriptor the caller keeps open for the duration of the call
+// (a content URI opened through ContentResolver). Descriptors are
+// duplicated, so the result is always the caller's to close. Returns -1
+// with errno set on failure.
+int open_source_fd(const char* source);
+
+// True when source has the "fd:" form; fd is then the descriptor number,
+// or -1 when the number is malformed.
+bool parse_fd_source(const char* source, int* fd);
+
+// Seekable stream over an open file descriptor, read with pread(2) so the
+// descriptor's own offset is never touched. When tail is given, those
+// bytes (copied) appear appended after the end of the file. With ownFd
+// the descriptor is closed when the stream is dropped.
+fz_stream* open_fd_stream(fz_context* ctx, int fd, bool ownFd,
+                          const unsigned char* tail = nullptr, size_t tailLen = 0);
+
+// How a document's bytes are read.
+//  BUFFERED:   pread into a 64 KB buffer (copy per read).
+//  SEQUENTIAL: mmap with MADV_SEQUENTIAL; for merge and encrypt, which walk
+//              every object once and benefit from aggressive read-ahead.
+//  RANDOM:     mmap with MADV_RANDOM; for previews that touch a few pages.
+// Mapped streams hand MuPDF pointers into the page cache, so reads copy
+// nothing. They check the file's size before each window they hand out,
+// so a file truncated while open fails to read rather than faulting.
+enum class InputAccess { BUFFERED, SEQUENTIAL, RANDOM };
+
+InputAccess input_access_by_name(const char* name, InputAccess fallback);
+const char* input_access_name(InputAccess access);
+
+// Like open_fd_stream, reading with the given access. Falls back to
+// BUFFERED when the file cannot be mapped (32-bit address space, special
+// files).
+fz_stream* open_input_stream(fz_context* ctx, int fd, bool ownFd, InputAccess access,
+                             const unsigned char* tail = nullptr, size_t tailLen = 0);
+
+// Time the stdio stream MuPDF uses for fz_open_document(path) against each
+// InputAccess: a full sequential read of the file, and opening the
+// document and running its first pages through a bbox device. Returns JSON.
+std::string benchmark_input_streams(fz_context* ctx, const char* path);
+
+#endif
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "job-scheduler.h"
+#include "doc-probe.h"
+#include "input-stream.h"
+#include "native-log.h"
+#include "output-stream.h"
+#include "parallel-governor.h"
+#include "result-buffer.h"
+
+// Most jobs running at once. Each holds a document, a writer and possibly
+// a render pixmap, so this stays small; the governor may allow fewer.
+#define JOB_MAX_THREADS 2
+
+// Least time between two progress updates of one running job. Tools call
+// in after every page and flushed buffer; everything in between is a
+// clock read.
+#define JOB_PROGRESS_INTERVAL_MS 100
+
+static const char* job_state_name(JobState state) {
+    switch (state) {
+        case JobState::QUEUED:    return "queued";
+        case JobState::RUNNING:   return "running";
+        case JobState::DONE:      return "done";
+        case JobState::FAILED:    return "failed";
+        case JobState::CANCELLED: return "cancelled";
+    }
+    return "unknown";
+}
+
+static const char* tool_phase_name(int phase) {
+    switch ((ToolPhase)phase) {
+        case ToolPhase::OPEN:  return "open";
+        case ToolPhase::PAGES: return "pages";
+        case ToolPhase::WRITE: return "write";
+    }
+    return "unknown";
+}
+
+// Optimizing decodes whole images and holds them while they are subsampled
+// and encoded again, which costs about what a page render does.
+static WorkKind job_work_kind(const std::string& type) {
+    return type == "renderPage" || type == "optimize" ? WorkKind::RENDER : WorkKind::DOCUMENT;
+}
+
+static int remove_entry(const char* path, const struct stat*, int, struct FTW*) {
+    if (remove(path) != 0)
+        LOGI("Failed to remove %s: %s", path, strerror(errno));
+    return 0;
+}
+
+static void remove_tree(const std::string& dir) {
+    if (!dir.empty())
+        nftw(dir.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// A result written to memory belongs to its job until Dart takes it; one
+// still untaken when the job goes is freed with it.
+static void release_memory_result(const std::string& result) {
+    static const size_t prefix = strlen(MEMORY_DESTINATION);
+    if (result.compare(0, prefix, MEMORY_DESTINATION) == 0 && result.size() > prefix)
+        bluepdf_release_result(strtoll(result.c_str() + prefix, nullptr, 10));
+}
+
+static void close_fds(std::vector<int>& fds) {
+    for (int fd : fds) close(fd);
+    fds.clear();
+}
+
+JobScheduler& JobScheduler::instance() {
+    // Never destroyed: the pool threads outlive static destruction.
+    static JobScheduler* scheduler = new JobScheduler();
+    return *scheduler;
+}
+
+JobScheduler::JobScheduler() : limit_(JOB_MAX_THREADS) {
+}
+
+void JobScheduler::set_root(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (root_ == dir) return;
+
+    // Jobs of an earlier process are gone with it; so are their outputs.
+    remove_tree(dir);
+    if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        LOGI("Failed to create job directory %s: %s", dir.c_str(), strerror(errno));
+        return;
+    }
+    root_ = dir;
+}
+
+void JobScheduler::set_listener(JobListener listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    listener_ = std::move(listener);
+}
+
+bool JobScheduler::hold_fd_spec(std::string& spec, std::vector<int>& fds) {
+    int fd;
+    if (!parse_fd_source(spec.c_str(), &fd)) return true;
+    if (fd < 0) return false;
+
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0) return false;
+    fds.push_back(copy);
+    spec = "fd:" + std::to_string(copy);
+    return true;
+}
+
+long long JobScheduler::submit(const std::string& type, JobTask task, std::vector<int> fds) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (root_.empty()) {
+        close_fds(fds);
+        return -1;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->id = nextId_++;
+    job->type = type;
+    job->dir = root_ + "/" + std::to_string(job->id);
+    job->task = std::move(task);
+    job->fds = std::move(fds);
+    Job* running = job.get();
+    job->progress.report = [this, running]() { report_progress(*running); };
+
+    if (mkdir(job->dir.c_str(), 0700) != 0) {
+        LOGI("Failed to create %s: %s", job->dir.c_str(), strerror(errno));
+        close_fds(job->fds);
+        return -1;
+    }
+
+    jobs_[job->id] = job;
+    queue_.push_back(job);
+    start_workers_locked();
+    lock.unlock();
+
+    queued_.notify_one();
+    return job->id;
+}
+
+void JobScheduler::start_workers_locked() {
+    int wanted = std::min<int>(JOB_MAX_THREADS, workers_ + (int)queue_.size());
+    while (workers_ < wanted) {
+        try {
+            std::thread(&JobScheduler::worker_loop, this).detach();
+        } catch (const std::system_error& e) {
+            LOGI("Failed to start job worker: %s", e.what());
+            break;
+        }
+        ++workers_;
+    }
+}
+
+void JobScheduler::worker_loop() {
+    for (;;) {
+        std::shared_ptr<Job> job;
+        std::string status;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;) {
+                queued_.wait(lock, [this]() { return !queue_.empty() && running_ < limit_; });
+                ParallelPlan plan = ParallelGovernor::instance().plan(job_work_kind(queue_.front()->type),
+                                                                      JOB_MAX_THREADS);
+                if (running_ < plan.workers) {
+                    job = queue_.front();
+                    job->storeBytes = plan.storeBytes;
+                    break;
+                }
+                // Fewer jobs fit than are running; wait for one to finish.
+                limit_ = running_;
+            }
+            queue_.pop_front();
+            ++running_;
+            job->state = JobState::RUNNING;
+            status = status_json_locked(*job);
+        }
+        notify(job->id, status);
+        run(job);
+    }
+}
+
+void JobScheduler::run(const std::shared_ptr<Job>& job) {
+    fz_context* ctx = fz_new_context(nullptr, nullptr, job->storeBytes);
+    if (!ctx) {
+        job->error = "Failed to create context";
+        finish(job);
+        return;
+    }
+
+    std::string result;
+    std::string error;
+    int code = 0;
+
+    fz_try(ctx) {
+        fz_register_document_handlers(ctx);
+        result = job->task(ctx, job->dir, &job->progress);
+    } fz_catch(ctx) {
+        code = fz_caught(ctx);
+        error = fz_caught_message(ctx);
+    }
+    fz_drop_context(ctx);
+
+    if (code) {
+        if (code != FZ_ERROR_ABORT)
+            LOGI("Job %lld (%s) failed: %s", job->id, job->type.c_str(), error.c_str());
+        job->error = error.empty() ? "failed" : error;
+    } else {
+        job->result = result;
+    }
+    finish(job);
+}
+
+void JobScheduler::finish(const std::shared_ptr<Job>& job) {
+    std::string status;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!job->error.empty())
+            job->state = job->progress.cookie.abort ? JobState::CANCELLED : JobState::FAILED;
+        else
+            job->state = JobState::DONE;
+        job->task = nullptr;
+        job->progress.report = nullptr;
+        close_fds(job->fds);
+        status = status_json_locked(*job);
+
+        if (job->released) {
+            jobs_.erase(job->id);
+            remove_tree(job->dir);
+            release_memory_result(job->result);
+        }
+
+        // Let waiting workers plan again against the freed memory.
+        --running_;
+        limit_ = JOB_MAX_THREADS;
+    }
+    queued_.notify_all();
+    notify(job->id, status);
+}
+
+bool JobScheduler::cancel(long long id) {
+    std::string status;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = jobs_.find(id);
+        if (it == jobs_.end()) return false;
+        std::shared_ptr<Job> job = it->second;
+
+        if (job->state == JobState::RUNNING) {
+            job->progress.cookie.abort = 1;
+            return true;
+        }
+        if (job->state != JobState::QUEUED) return false;
+
+        for (auto q = queue_.begin(); q != queue_.end(); ++q) {
+            if (*q == job) {
+                queue_.erase(q);
+                break;
+            }
+        }
+        job->state = JobState::CANCELLED;
+        job->task = nullptr;
+        job->progress.report = nullptr;
+        close_fds(job->fds);
+        status = status_json_locked(*job);
+    }
+    notify(id, status);
+    return true;
+}
+
+std::string JobScheduler::status_json(long long id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return "";
+    return status_json_locked(*it->second);
+}
+
+void JobScheduler::release(long long id) {
+    cancel(id);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return;
+    std::shared_ptr<Job> job = it->second;
+
+    if (job->state == JobState::RUNNING) {
+        // finish() removes it once the task has stopped.
+        job->released = true;
+        return;
+    }
+    jobs_.erase(it);
+    remove_tree(job->dir);
+    release_memory_result(job->result);
+}
+
+std::string JobScheduler::status_json_locked(const Job& job) {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"id\":%lld,\"type\":", job.id);
+    std::string json = buf;
+    append_json_string(json, job.type);
+    snprintf(buf, sizeof(buf),
+             ",\"state\":\"%s\",\"phase\":\"%s\",\"progress\":%d,\"progressMax\":%d,\"bytes\":%lld,\"dir\":",
+             job_state_name(job.state), tool_phase_name(job.progress.phase), job.progress.cookie.progress,
+             (int)job.progress.cookie.progress_max, job.progress.bytes.load());
+    json += buf;
+    append_json_string(json, job.dir);
+    if (job.state == JobState::DONE) {
+        json += ",\"result\":";
+        append_json_string(json, job.result);
+        if (!job.progress.summary.empty())
+            json += ",\"summary\":" + job.progress.summary;
+    } else if (job.state == JobState::FAILED) {
+        json += ",\"error\":";
+        append_json_string(json, job.error);
+    }
+    return json + "}";
+}
+
+void JobScheduler::report_progress(Job& job) {
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now - job.lastReportMs < JOB_PROGRESS_INTERVAL_MS) return;
+    job.lastReportMs = now;
+
+    std::string status;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status = status_json_locked(job);
+    }
+    notify(job.id, status);
+}
+
+void JobScheduler::notify(long long id, const std::string& status) {
+    JobListener listener;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        listener = listener_;
+    }
+    if (listener) listener(id, status);
+}
@@ -0,0 +1,112 @@
+#ifndef BLUEPDF_JOB_SCHEDULER_H
+#define BLUEPDF_JOB_SCHEDULER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tool-progress.h"
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+enum class JobState { QUEUED, RUNNING, DONE, FAILED, CANCELLED };
+
+// The work of one job. It runs on a pool thread with a context of its
+// own and the job's private directory, reports progress and watches for
+// cancellation through progress, and returns the job's result or throws.
+using JobTask = std::function<std::string(fz_context* ctx, const std::string& dir, ToolProgress* progress)>;
+
+// Told about every state change after submission (a job starts out
+// queued) and, at most every JOB_PROGRESS_INTERVAL_MS, about progress
+// while a job runs, with the id and the job's status_json(). Called on
+// pool threads, or on the caller of cancel(), never with the scheduler
+// locked.
+using JobListener = std::function<void(long long id, const std::string& status)>;
+
+// Runs document tools in the background so no caller blocks on them.
+// Each job gets an id, its own output directory under the root (so two
+// jobs never write the same page_N.png or merged.pdf) and a progress
+// whose cookie cancel() trips. At most JOB_MAX_THREADS jobs run at once,
+// fewer when the ParallelGovernor says memory or heat allows fewer; the
+// rest wait in submission order.
+class JobScheduler {
+public:
+    static JobScheduler& instance();
+
+    // Directory holding one subdirectory per job. Leftovers of earlier
+    // runs are deleted. Nothing can be submitted until this is set.
+    void set_root(const std::string& dir);
+    void set_listener(JobListener listener);
+
+    // "fd:N" specs name descriptors that only stay open for the duration of
+    // the submitting call. Duplicate the descriptor into fds and point spec
+    // at the copy; submit() then hands the copies to the job, which closes
+    // them once it is over. Other specs are left alone. Returns false when
+    // the descriptor cannot be duplicated.
+    static bool hold_fd_spec(std::string& spec, std::vector<int>& fds);
+
+    // Queue task and return its id, or -1 when there is no root or the
+    // job directory cannot be created (fds are closed then too).
+    long long submit(const std::string& type, JobTask task, std::vector<int> fds = {});
+
+    // A queued job is dropped; a running one is aborted at its next check.
+    // Returns false for unknown or finished jobs.
+    bool cancel(long long id);
+
+    // {"id","type","state","phase","progress","progressMax","bytes","dir"}
+    // plus "result" (and the tool's "summary", if any) once done and
+    // "error" once failed. progress counts pages, bytes the output written
+    // so far. "" for unknown ids.
+    std::string status_json(long long id);
+
+    // Forget a finished job and delete its directory. Results written to
+    // an fd stay; a memory result Dart has not taken yet is freed. A live
+    // job is cancelled and released once it stops.
+    void release(long long id);
+
+private:
+    struct Job {
+        long long id;
+        std::string type;
+        std::string dir;
+        JobTask task;
+        std::vector<int> fds;
+        JobState state = JobState::QUEUED;
+        ToolProgress progress;
+        long long lastReportMs = 0;  // touched by the job's thread only
+        size_t storeBytes = 0;       // planned when the job starts
+        std::string result;
+        std::string error;
+        bool released = false;
+    };
+
+    JobScheduler();
+
+    void start_workers_locked();
+    void worker_loop();
+    void run(const std::shared_ptr<Job>& job);
+    void finish(const std::shared_ptr<Job>& job);
+    void report_progress(Job& job);
+    std::string status_json_locked(const Job& job);
+    void notify(long long id, const std::string& status);
+
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::deque<std::shared_ptr<Job>> queue_;
+    std::unordered_map<long long, std::shared_ptr<Job>> jobs_;
+    int workers_ = 0;
+    int running_ = 0;
+    int limit_;
+    std::string root_;
+    JobListener listener_;
+    long long nextId_ = 1;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include <mutex>
+
+#include "native-context.h"
+
+static std::mutex g_fzLocks[FZ_LOCK_MAX];
+
+static void lock_fz(void* user, int lock) {
+    g_fzLocks[lock].lock();
+}
+
+static void unlock_fz(void* user, int lock) {
+    g_fzLocks[lock].unlock();
+}
+
+static fz_locks_context g_lockContext = { nullptr, lock_fz, unlock_fz };
+
+fz_context* new_threaded_context(size_t maxStore) {
+    fz_context* ctx = fz_new_context(nullptr, &g_lockContext, maxStore);
+    if (!ctx) return nullptr;
+
+    fz_try(ctx) {
+        fz_register_document_handlers(ctx);
+    } fz_catch(ctx) {
+        fz_drop_context(ctx);
+        return nullptr;
+    }
+    return ctx;
+}
@@ -0,0 +1,16 @@
+#ifndef BLUEPDF_NATIVE_CONTEXT_H
+#define BLUEPDF_NATIVE_CONTEXT_H
+
+#include <cstddef>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+// A context backed by process-wide mutexes, so that fz_clone_context()
+// copies of it can be handed to worker threads. Plain fz_new_context()
+// contexts have no locking and must stay on one thread.
+// Document handlers are already registered. Returns null on failure.
+fz_context* new_threaded_context(size_t maxStore);
+
+#endif
@@ -1,361 +1,297 @@
 #include <jni.h>
 #include <string>
-#include <android/log.h>
 #include <vector>
 #include <cstring>
 #include <sys/stat.h>
 #include <algorithm>
+#include <thread>
+#include <mutex>
+#include <unistd.h>
 
 extern "C" {
     #include "mupdf/fitz.h"
     #include "mupdf/pdf.h"
 }
 
-#define LOG_TAG "MuPDFNative"
-#define LOGI(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-
-// A4 size in points (72 DPI)
-#define A4_WIDTH 595.0f
-#define A4_HEIGHT 842.0f
+#include "native-log.h"
+#include "render-profile.h"
+#include "render-engine.h"
+#include "image-kernels.h"
+#include "aes-benchmark.h"
+#include "image-page.h"
+#include "doc-probe.h"
+#include "doc-open.h"
+#include "native-context.h"
+#include "output-stream.h"
+#include "page-encoder.h"
+#include "doc-tools.h"
+#include "pdf-linearizer.h"
+#include "job-scheduler.h"
+#include "parallel-governor.h"
+
+// Pixel memory per band for high DPI page exports
+#define EXPORT_BAND_BYTES (8 * 1024 * 1024)
+
+static std::string string_from_java(JNIEnv* env, jstring value) {
+    const char* chars = env->GetStringUTFChars(value, nullptr);
+    std::string result(chars);
+    env->ReleaseStringUTFChars(value, chars);
+    return result;
+}
 
-// --- Initialize MuPDF ---
-fz_context* init_context() {
-    fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_UNLIMITED);
-    if (!ctx) {
-        LOGI("Failed to create context");
-        return nullptr;
+static std::vector<std::string> strings_from_java(JNIEnv* env, jobjectArray values) {
+    std::vector<std::string> result;
+    jsize len = env->GetArrayLength(values);
+    for (jsize i = 0; i < len; i++) {
+        jstring value = (jstring)env->GetObjectArrayElement(values, i);
+        result.push_back(string_from_java(env, value));
+        env->DeleteLocalRef(value);
     }
-    fz_register_document_handlers(ctx);
-    return ctx;
+    return result;
 }
 
-// --- IMAGE TO PDF ---
-extern "C"
-JNIEXPORT jstring JNICALL
-Java_com_bluepdf_blue_1pdf_MainActivity_imageToPdfNative(JNIEnv* env, jobject,
-                                                         jobjectArray imagePaths,
-                                                         jstring cacheDir,
-                                                         jstring pageSizeMode) {
-    fz_context* ctx = init_context();
-    if (!ctx) return env->NewStringUTF("");
-
-    const char* dir = env->GetStringUTFChars(cacheDir, nullptr);
-    const char* mode = env->GetStringUTFChars(pageSizeMode, nullptr);
-    std::string outputPath = std::string(dir) + "/output.pdf";
+// Convert a java.util.List<Integer>.
+static std::vector<int> ints_from_java_list(JNIEnv* env, jobject list) {
+    std::vector<int> result;
+    jclass listClass = env->GetObjectClass(list);
+    jmethodID sizeMethod = env->GetMethodID(listClass, "size", "()I");
+    jmethodID getMethod = env->GetMethodID(listClass, "get", "(I)Ljava/lang/Object;");
+    if (!sizeMethod || !getMethod) return result;
 
-    fz_document_writer* writer = nullptr;
+    jclass integerClass = env->FindClass("java/lang/Integer");
+    jmethodID intValueMethod = env->GetMethodID(integerClass, "intValue", "()I");
 
-    fz_try(ctx) {
-        writer = fz_new_document_writer(ctx, outputPath.c_str(), "pdf", nullptr);
-    } fz_catch(ctx) {
-        fz_drop_context(ctx);
-        env->ReleaseStringUTFChars(cacheDir, dir);
-        env->ReleaseStringUTFChars(pageSizeMode, mode);
-        return env->NewStringUTF("");
+    jint listSize = env->CallIntMethod(list, sizeMethod);
+    for (int i = 0; i < listSize; i++) {
+        jobject integerObj = env->CallObjectMethod(list, getMethod, i);
+        if (integerObj) {
+            result.push_back(env->CallIntMethod(integerObj, intValueMethod));
+            env->DeleteLocalRef(integerObj);
+        }
     }
+    return result;
+}
 
-    jsize len = env->GetArrayLength(imagePaths);
-    for (int i = 0; i < len; i++) {
-        jstring imgPath = (jstring)env->GetObjectArrayElement(imagePaths, i);
-        const char* path = env->GetStringUTFChars(imgPath, nullptr);
-
-        fz_try(ctx) {
-            fz_image* img = fz_new_image_from_file(ctx, path);
-            int img_w = img->w;
-            int img_h = img->h;
-
-            fz_rect page_rect;
-            fz_matrix m;
-
-            if (strcmp(mode, "A4") == 0) {
-                const float A4_W = 595.0f; // 8.27 inch * 72
-                const float A4_H = 842.0f; // 11.69 inch * 72
-                page_rect = fz_make_rect(0, 0, A4_W, A4_H);
-
-                // Desired DPI (can also be 150, 200, etc.)
-                const float dpi = 150.0f;
-
-                // Convert image size in pixels to points (1 inch = 72 points)
-                float img_w_pt = (img_w / dpi) * 72.0f;
-                float img_h_pt = (img_h / dpi) * 72.0f;
-
-                // Fit image into A4 while maintaining aspect ratio
-                float scale_x = A4_W / img_w_pt;
-                float scale_y = A4_H / img_h_pt;
-                float scale = fminf(scale_x, scale_y);
-
-                // Final scaled image size (optional)
-                float final_w = img_w_pt * scale;
-                float final_h = img_h_pt * scale;
-                
-                float offset_x = (A4_W - final_w) / 2.0f;
-                float offset_y = (A4_H - final_h) / 2.0f;
-
-                m = fz_translate(offset_x, offset_y);
-                m = fz_concat(fz_scale(final_w , final_h), m); 
-            } else {
-                page_rect = fz_make_rect(0, 0, (float)img_w, (float)img_h);
-                m = fz_scale((float)img_w, (float)img_h);
-            }
+static PageEncoding page_encoding_from_java(JNIEnv* env, jstring spec) {
+    if (spec == nullptr) return PAGE_ENCODING_PNG;
+    return parse_page_encoding(string_from_java(env, spec).c_str(), PAGE_ENCODING_PNG);
+}
 
-            fz_device* dev = fz_begin_page(ctx, writer, page_rect);
-            fz_fill_image(ctx, dev, img, m, 1.0f, fz_default_color_params);
-            fz_end_page(ctx, writer);
-            fz_drop_image(ctx, img);
-        } fz_catch(ctx) {
-            LOGI("Failed on image %s", path);
-        }
+static const RenderProfile& render_profile_from_java(JNIEnv* env, jstring name, const RenderProfile& fallback) {
+    if (name == nullptr) return fallback;
+    return render_profile_by_name(string_from_java(env, name).c_str(), fallback);
+}
 
-        env->ReleaseStringUTFChars(imgPath, path);
-    }
+// --- CACHE DIR ---
+// Where the native side keeps files that outlive a call (repair indexes).
+extern "C" JNIEXPORT void JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_setCacheDirNative(JNIEnv* env, jobject /* this */,
+                                                         jstring cacheDir) {
+    const char* dir = env->GetStringUTFChars(cacheDir, nullptr);
+    set_repair_index_dir(dir);
+    JobScheduler::instance().set_root(std::string(dir) + "/jobs");
+    env->ReleaseStringUTFChars(cacheDir, dir);
+}
 
-    fz_try(ctx) {
-        fz_close_document_writer(ctx, writer);
-        fz_drop_document_writer(ctx, writer);
-    } fz_catch(ctx) {
-        LOGI("Failed to finalize PDF");
+// --- PROBE PDFS ---
+// Encryption, page count and sizes, version, linearization and repair state
+// of many files at once, as a JSON array in the order of the input paths.
+// Without pageSizes, files are answered from their trailer where possible.
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_probePdfsNative(JNIEnv* env, jobject /* this */,
+                                                       jobjectArray pdfPaths,
+                                                       jboolean pageSizes) {
+    std::vector<std::string> paths;
+    jsize count = env->GetArrayLength(pdfPaths);
+    for (jsize i = 0; i < count; ++i) {
+        jstring jpath = (jstring)env->GetObjectArrayElement(pdfPaths, i);
+        const char* path = env->GetStringUTFChars(jpath, nullptr);
+        paths.emplace_back(path);
+        env->ReleaseStringUTFChars(jpath, path);
+        env->DeleteLocalRef(jpath);
     }
 
-    fz_drop_context(ctx);
-    env->ReleaseStringUTFChars(cacheDir, dir);
-    env->ReleaseStringUTFChars(pageSizeMode, mode);
+    ParallelPlan plan = ParallelGovernor::instance().plan(WorkKind::PROBE, (int)paths.size());
+    fz_context* ctx = new_threaded_context(plan.storeBytes);
+    if (!ctx) return env->NewStringUTF("");
+
+    std::vector<DocProbe> probes = probe_documents(ctx, paths, plan.workers, pageSizes == JNI_TRUE);
 
-    return env->NewStringUTF(outputPath.c_str());
+    fz_drop_context(ctx);
+    return env->NewStringUTF(doc_probes_json(probes).c_str());
 }
 
+// RENDER PDF PAGE (PROGRESSIVE)
+// Two passes for the same request: a coarse render bounded by budgetMs,
+// then a render with the named profile (quality unless the caller asks for
+// draft, as thumbnail-sized previews do). Each finished pass is reported
+// through MainActivity.onProgressiveRender(requestId, pass, path); the
+// files are the caller's to delete. The fine pass is skipped, or aborted
+// mid-page, once cancelRenderNative(requestId) is called.
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_renderPdfPageProgressiveNative(
+        JNIEnv *env, jobject thiz,
+        jlong requestId,
+        jstring inputPath,
+        jint pageNumber,
+        jstring cacheDir,
+        jint budgetMs,
+        jstring profileName) {
 
+    const char* input_cstr = env->GetStringUTFChars(inputPath, nullptr);
+    const char* cacheDir_cstr = env->GetStringUTFChars(cacheDir, nullptr);
+    std::string inputFile(input_cstr);
+    std::string cacheDirStr(cacheDir_cstr);
 
-// --- MERGE PDF --- WORKING
-extern "C" JNIEXPORT jstring JNICALL
-Java_com_bluepdf_blue_1pdf_MainActivity_mergePdfNative(JNIEnv* env, jobject /* this */,
-                                                       jobjectArray pdfPaths, jstring cacheDir) {
-    LOGI("Merge PDF called");
+    env->ReleaseStringUTFChars(inputPath, input_cstr);
+    env->ReleaseStringUTFChars(cacheDir, cacheDir_cstr);
 
-    fz_context* ctx = init_context();
-    if (!ctx) return env->NewStringUTF("");
+    jclass activityClass = env->GetObjectClass(thiz);
+    jmethodID onRender = env->GetMethodID(activityClass, "onProgressiveRender", "(JILjava/lang/String;)V");
+    if (!onRender) return JNI_FALSE;
 
-    const char* dir = env->GetStringUTFChars(cacheDir, nullptr);
-    std::string outputPath = std::string(dir) + "/merged.pdf";
+    fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
+    if (!ctx) return JNI_FALSE;
 
-    fz_document_writer* writer = nullptr;
+    fz_register_document_handlers(ctx);
 
-    fz_try(ctx) {
-        fz_register_document_handlers(ctx);  // Register PDF and other formats
-        const char* pdf_options = "compress-images=no,compress-fonts=no";
-        writer = fz_new_document_writer(ctx, outputPath.c_str(), "pdf", pdf_options);
-
-        jsize len = env->GetArrayLength(pdfPaths);
-        LOGI("Merging %d PDF files", (int)len);
-
-        for (jsize i = 0; i < len; i++) {
-            jstring jPath = (jstring) env->GetObjectArrayElement(pdfPaths, i);
-            const char* path = env->GetStringUTFChars(jPath, nullptr);
-
-            fz_document* doc = fz_open_document(ctx, path);
-            if (!doc) {
-                LOGI("Failed to open document: %s", path);
-                env->ReleaseStringUTFChars(jPath, path);
-                env->DeleteLocalRef(jPath);
-                continue;
-            }
+    RenderEngine& engine = RenderEngine::instance();
+    std::shared_ptr<RenderRequest> request = engine.begin_request(requestId);
+    const PageEncoding fastPng = parse_page_encoding("png-fast", PAGE_ENCODING_PNG);
+    const RenderProfile* passes[2] = { &RENDER_PROFILE_COARSE,
+                                       &render_profile_from_java(env, profileName, RENDER_PROFILE_QUALITY) };
 
-            int pageCount = fz_count_pages(ctx, doc);
-            LOGI("PDF %d has %d pages", (int)i, pageCount);
+    fz_document* doc = nullptr;
+    fz_page* page = nullptr;
+    fz_pixmap* pix = nullptr;
+    bool completed = false;
 
-            for (int j = 0; j < pageCount; j++) {
-                fz_page* page = fz_load_page(ctx, doc, j);
-                fz_rect bounds = fz_bound_page(ctx, page);
+    fz_var(doc);
+    fz_var(page);
+    fz_var(pix);
+    fz_try(ctx) {
+        doc = open_document(ctx, inputFile.c_str(), InputAccess::RANDOM);
+        page = fz_load_page(ctx, doc, pageNumber);
 
-                if (fz_is_empty_rect(bounds)) {
-                    LOGI("Page %d in doc %d has empty bounds; skipping", j, (int)i);
-                    fz_drop_page(ctx, page);
-                    continue;
-                }
+        for (int pass = 0; pass < 2 && !request->cancelled; ++pass) {
+            const RenderProfile& profile = *passes[pass];
+            apply_render_profile(ctx, profile);
 
-                fz_device* dev = fz_begin_page(ctx, writer, bounds);
-                fz_run_page(ctx, page, dev, fz_identity, nullptr);
-                fz_end_page(ctx, writer);
-                fz_drop_page(ctx, page);
+            if (pass == 0) {
+                pix = engine.render_page_with_budget(ctx, page, profile, *request, budgetMs);
+            } else {
+                // The coarse pass may have tripped the budget abort; start
+                // clean, then re-check so a racing cancel is not lost.
+                request->cookie.abort = 0;
+                if (request->cancelled) break;
+                pix = engine.render_page(ctx, page, profile, &request->cookie);
             }
-
-            fz_drop_document(ctx, doc);
-            env->ReleaseStringUTFChars(jPath, path);
+            if (request->cancelled) break;
+
+            // Named per request: another request for the same page, or one
+            // cancelled but still saving, never writes this file.
+            std::string outPath = cacheDirStr + "/render_" + std::to_string((long long)requestId) + "_" +
+                                  render_profile_page_name(profile, pageNumber + 1, "png");
+            save_page_image(ctx, pix, outPath.c_str(), pass == 0 ? fastPng : PAGE_ENCODING_PNG);
+            engine.release_pixmap(ctx, pix);
+            pix = nullptr;
+
+            jstring jPath = env->NewStringUTF(outPath.c_str());
+            env->CallVoidMethod(thiz, onRender, requestId, (jint)pass, jPath);
             env->DeleteLocalRef(jPath);
         }
-
-        fz_close_document_writer(ctx, writer);
-        fz_drop_document_writer(ctx, writer);
-
+        completed = !request->cancelled;
+    } fz_always(ctx) {
+        if (pix) engine.release_pixmap(ctx, pix);
+        if (page) fz_drop_page(ctx, page);
+        if (doc) fz_drop_document(ctx, doc);
     } fz_catch(ctx) {
-        LOGI("Error merging PDFs");
-        if (writer) fz_drop_document_writer(ctx, writer);
-        fz_drop_context(ctx);
-        env->ReleaseStringUTFChars(cacheDir, dir);
-        return env->NewStringUTF("");
+        if (!request->cancelled)
+            LOGI("Progressive render of page %d failed: %s", pageNumber, fz_caught_message(ctx));
+        completed = false;
     }
 
+    engine.end_request(requestId);
     fz_drop_context(ctx);
-    env->ReleaseStringUTFChars(cacheDir, dir);
-    return env->NewStringUTF(outputPath.c_str());
+    return completed ? JNI_TRUE : JNI_FALSE;
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_cancelRenderNative(JNIEnv *env, jobject /* this */, jlong requestId) {
+    RenderEngine::instance().cancel_request(requestId);
+}
 
-// --- ENCRYPT PDF ---
-extern "C" JNIEXPORT jstring JNICALL
-Java_com_bluepdf_blue_1pdf_MainActivity_encryptPdfNative(JNIEnv* env, jobject /* this */,
-                                                         jstring inputPath, jstring password,
-                                                         jstring cacheDir) {
-    fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
-    if (!ctx) return env->NewStringUTF("");
-
-    fz_register_document_handlers(ctx);
-
-    const char* dir = env->GetStringUTFChars(cacheDir, nullptr);
-    const char* input = env->GetStringUTFChars(inputPath, nullptr);
-    const char* pass = env->GetStringUTFChars(password, nullptr);
-    
-    std::string inputFile(input);
-    std::string outputPath = std::string(dir) + "/encrypted.pdf";
-    std::string userPassword(pass);
-    
-    // Release JNI strings
-    env->ReleaseStringUTFChars(cacheDir, dir);
-    env->ReleaseStringUTFChars(inputPath, input);
-    env->ReleaseStringUTFChars(password, pass);
+// EXPORT PAGE IMAGE (BANDED)
+// High DPI page export. Rendering goes through horizontal bands that are
+// streamed straight to the encoder, so memory stays bounded at any DPI.
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_exportPageImageNative(
+        JNIEnv *env, jobject thiz,
+        jstring inputPath,
+        jint pageNumber,
+        jint dpi,
+        jstring format,
+        jstring outputPath) {
 
-    pdf_document* doc = nullptr;
-    pdf_write_options opts = pdf_default_write_options;
-    
-    fz_try(ctx) {
-        // Open the input PDF
-        doc = pdf_open_document(ctx, inputFile.c_str());
-        
-        // Set up encryption options
-        opts.do_encrypt = PDF_ENCRYPT_AES_256;  // Use AES 256-bit encryption
-        strncpy(opts.opwd_utf8, userPassword.c_str(), sizeof(opts.opwd_utf8) - 1);
-        opts.opwd_utf8[sizeof(opts.opwd_utf8) - 1] = '\0';
-
-        strncpy(opts.upwd_utf8, userPassword.c_str(), sizeof(opts.upwd_utf8) - 1);
-        opts.upwd_utf8[sizeof(opts.upwd_utf8) - 1] = '\0';
-
-        
-        // Set permissions (allow all operations by default)
-        opts.permissions = PDF_PERM_PRINT | PDF_PERM_MODIFY | PDF_PERM_COPY | 
-                          PDF_PERM_ANNOTATE | PDF_PERM_FORM | PDF_PERM_ACCESSIBILITY |
-                          PDF_PERM_ASSEMBLE | PDF_PERM_PRINT_HQ;
-        
-        // Additional write options
-        opts.do_incremental = 0;        // Full rewrite
-        opts.do_ascii = 0;              // Binary output
-        opts.do_compress = 1;           // Compress streams
-        opts.do_compress_images = 1;    // Compress images
-        opts.do_compress_fonts = 1;     // Compress fonts
-        opts.do_decompress = 0;         // Don't decompress
-        opts.do_garbage = 1;            // Remove unused objects
-        opts.do_linear = 0;             // Don't linearize
-        opts.do_clean = 1;              // Clean up document
-        opts.do_sanitize = 1;           // Sanitize document
-        opts.do_pretty = 0;             // Don't pretty print
-        
-        // Save the encrypted PDF
-        pdf_save_document(ctx, doc, outputPath.c_str(), &opts);
-        
-    }
-    fz_always(ctx) {
-        if (doc) pdf_drop_document(ctx, doc);
-    }
-    fz_catch(ctx) {
-        fz_drop_context(ctx);
-        return env->NewStringUTF("");  // Return empty string on error
-    }
+    const char* input_cstr = env->GetStringUTFChars(inputPath, nullptr);
+    const char* format_cstr = env->GetStringUTFChars(format, nullptr);
+    const char* output_cstr = env->GetStringUTFChars(outputPath, nullptr);
+    std::string inputFile(input_cstr);
+    std::string formatStr(format_cstr);
+    std::string outPath(output_cstr);
 
-    fz_drop_context(ctx);
-    return env->NewStringUTF(outputPath.c_str());
-}
+    env->ReleaseStringUTFChars(inputPath, input_cstr);
+    env->ReleaseStringUTFChars(format, format_cstr);
+    env->ReleaseStringUTFChars(outputPath, output_cstr);
 
-// Helper function to check if PDF is encrypted
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_bluepdf_blue_1pdf_MainActivity_isPdfEncryptedNative(JNIEnv* env, jobject /* this */,
-                                                            jstring inputPath) {
     fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
-    if (!ctx) return JNI_FALSE;
+    if (!ctx) return env->NewStringUTF("");
 
     fz_register_document_handlers(ctx);
+    apply_render_profile(ctx, RENDER_PROFILE_EXPORT);
 
-    const char* input = env->GetStringUTFChars(inputPath, nullptr);
-    std::string inputFile(input);
-    env->ReleaseStringUTFChars(inputPath, input);
+    fz_document* doc = nullptr;
+    fz_page* page = nullptr;
 
-    pdf_document* doc = nullptr;
-    jboolean isEncrypted = JNI_FALSE;
-    
     fz_try(ctx) {
-        doc = pdf_open_document(ctx, inputFile.c_str());
-        isEncrypted = pdf_needs_password(ctx, doc) ? JNI_TRUE : JNI_FALSE;
-    }
-    fz_always(ctx) {
-        if (doc) pdf_drop_document(ctx, doc);
-    }
-    fz_catch(ctx) {
-        // If we can't open it, assume it might be encrypted or corrupted
-        isEncrypted = JNI_FALSE;
+        doc = open_document(ctx, inputFile.c_str(), InputAccess::RANDOM);
+        page = fz_load_page(ctx, doc, pageNumber);
+        RenderEngine::instance().export_page_banded(ctx, page, RENDER_PROFILE_EXPORT, dpi,
+                                                    formatStr.c_str(), outPath.c_str(), EXPORT_BAND_BYTES);
+    } fz_always(ctx) {
+        if (page) fz_drop_page(ctx, page);
+        if (doc) fz_drop_document(ctx, doc);
+    } fz_catch(ctx) {
+        LOGI("Banded export of page %d failed: %s", pageNumber, fz_caught_message(ctx));
+        outPath = "";
     }
 
     fz_drop_context(ctx);
-    return isEncrypted;
+    return env->NewStringUTF(outPath.c_str());
 }
 
-// --- SPLIT PDF ---
-// Option 1: Handle ArrayList<Integer> in C++
-extern "C" JNIEXPORT jstring JNICALL 
-Java_com_bluepdf_blue_1pdf_MainActivity_splitPdfNative(JNIEnv* env, jobject,
-                                                        jstring inputPath,
-                                                        jobject pagesList,  // Changed to jobject to handle List
-                                                        jstring cacheDir,
-                                                    jstring outputFilename) {
-    const char* input_cstr = env->GetStringUTFChars(inputPath, nullptr);
-    const char* cacheDir_cstr = env->GetStringUTFChars(cacheDir, nullptr);
+// EXTRACT PAGE IMAGE
+// For single-image (scanned) pages, write the page image at its native
+// resolution. JPEG streams are copied out untouched; other images are
+// decoded once and saved as PNG. Returns "" for any other kind of page.
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_extractPageImageNative(
+        JNIEnv *env, jobject thiz,
+        jstring inputPath,
+        jint pageNumber,
+        jstring outputBase) {
 
+    const char* input_cstr = env->GetStringUTFChars(inputPath, nullptr);
+    const char* output_cstr = env->GetStringUTFChars(outputBase, nullptr);
     std::string inputFile(input_cstr);
-    std::string cacheDirStr(cacheDir_cstr);
-    env->ReleaseStringUTFChars(inputPath, input_cstr);
-    env->ReleaseStringUTFChars(cacheDir, cacheDir_cstr);
-
-    std::string outputPath;
-    if (outputFilename != nullptr) {
-        const char* outputFilename_cstr = env->GetStringUTFChars(outputFilename, nullptr);
-        outputPath = cacheDirStr + "/" + outputFilename_cstr;
-        env->ReleaseStringUTFChars(outputFilename, outputFilename_cstr);
-    } else {
-        outputPath = cacheDirStr + "/split_output.pdf";
-    }
-
-
-    // Get List class and methods
-    jclass listClass = env->GetObjectClass(pagesList);
-    jmethodID sizeMethod = env->GetMethodID(listClass, "size", "()I");
-    jmethodID getMethod = env->GetMethodID(listClass, "get", "(I)Ljava/lang/Object;");
-    
-    if (!sizeMethod || !getMethod) {
-        return env->NewStringUTF("");
-    }
-
-    jint listSize = env->CallIntMethod(pagesList, sizeMethod);
-    if (listSize <= 0) return env->NewStringUTF("");
+    std::string outBase(output_cstr);
 
-    // Convert ArrayList<Integer> to vector<int>
-    std::vector<int> pages;
-    jclass integerClass = env->FindClass("java/lang/Integer");
-    jmethodID intValueMethod = env->GetMethodID(integerClass, "intValue", "()I");
-    
-    for (int i = 0; i < listSize; i++) {
-        jobject integerObj = env->CallObjectMethod(pagesList, getMethod, i);
-        if (integerObj) {
-            jint pageNum = env->CallIntMethod(integerObj, intValueMethod);
-            pages.push_back(pageNum);
-            env->DeleteLocalRef(integerObj);
-        }
-    }
+    env->ReleaseStringUTFChars(inputPath, input_cstr);
+    env->ReleaseStringUTFChars(outputBase, output_cstr);
 
     fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
     if (!ctx) return env->NewStringUTF("");
@@ -363,50 +299,51 @@ Java_com_bluepdf_blue_1pdf_MainActivity_splitPdfNative(JNIEnv* env, jobject,
     fz_register_document_handlers(ctx);
 
     fz_document* doc = nullptr;
-    fz_document_writer* writer = nullptr;
+    fz_page* page = nullptr;
+    fz_pixmap* pix = nullptr;
+    SingleImagePage sip = { nullptr, fz_identity };
+    std::string outPath;
 
     fz_try(ctx) {
-        doc = fz_open_document(ctx, inputFile.c_str());
-        int totalPages = fz_count_pages(ctx, doc);
-
-        // Create PDF writer with correct signature
-        writer = fz_new_document_writer(ctx, outputPath.c_str(), "pdf", nullptr);
-
-        for (size_t i = 0; i < pages.size(); ++i) {
-            int pageNumber = pages[i];
-            if (pageNumber < 1 || pageNumber > totalPages) continue;
-
-            fz_page* page = fz_load_page(ctx, doc, pageNumber - 1);
-            fz_rect bounds = fz_bound_page(ctx, page);
-
-            fz_device* dev = fz_begin_page(ctx, writer, bounds);
-            fz_run_page(ctx, page, dev, fz_identity, nullptr);
-            fz_end_page(ctx, writer);
+        doc = open_document(ctx, inputFile.c_str(), InputAccess::RANDOM);
+        page = fz_load_page(ctx, doc, pageNumber);
 
-            fz_drop_page(ctx, page);
+        if (find_single_image_page(ctx, page, &sip)) {
+            fz_compressed_buffer* cbuf = fz_compressed_image_buffer(ctx, sip.image);
+            if (cbuf && cbuf->params.type == FZ_IMAGE_JPEG && sip.image->n != 4) {
+                outPath = outBase + ".jpg";
+                fz_save_buffer(ctx, cbuf->buffer, outPath.c_str());
+            } else {
+                outPath = outBase + ".png";
+                pix = fz_get_pixmap_from_image(ctx, sip.image, nullptr, nullptr, nullptr, nullptr);
+                fz_save_pixmap_as_png(ctx, pix, outPath.c_str());
+            }
         }
-
-        fz_close_document_writer(ctx, writer);
-    }
-    fz_always(ctx) {
-        if (writer) fz_drop_document_writer(ctx, writer);
+    } fz_always(ctx) {
+        if (pix) fz_drop_pixmap(ctx, pix);
+        drop_single_image_page(ctx, &sip);
+        if (page) fz_drop_page(ctx, page);
         if (doc) fz_drop_document(ctx, doc);
-    }
-    fz_catch(ctx) {
-        fz_drop_context(ctx);
-        return env->NewStringUTF("");
+    } fz_catch(ctx) {
+        LOGI("Failed to extract image of page %d: %s", pageNumber, fz_caught_message(ctx));
+        outPath = "";
     }
 
     fz_drop_context(ctx);
-    return env->NewStringUTF(outputPath.c_str());
+    return env->NewStringUTF(outPath.c_str());
 }
 
-// REORDER PDF
+// BENCHMARK PAGE IMAGE ENCODINGS
+// Renders one page with the quality profile and compares encode time and
+// size of every cache encoding against the default PNG writer.
 extern "C"
-JNIEXPORT jobjectArray JNICALL
-Java_com_bluepdf_blue_1pdf_MainActivity_reorderPdfNative(JNIEnv* env, jobject thiz,
-                                                          jstring inputPath,
-                                                          jstring cacheDir) {
+JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_benchmarkPageEncodingNative(
+        JNIEnv *env, jobject thiz,
+        jstring inputPath,
+        jint pageNumber,
+        jstring cacheDir) {
+
     const char* input_cstr = env->GetStringUTFChars(inputPath, nullptr);
     const char* cacheDir_cstr = env->GetStringUTFChars(cacheDir, nullptr);
     std::string inputFile(input_cstr);
@@ -416,263 +353,416 @@ Java_com_bluepdf_blue_1pdf_MainActivity_reorderPdfNative(JNIEnv* env, jobject th
     env->ReleaseStringUTFChars(cacheDir, cacheDir_cstr);
 
     fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
-    if (!ctx) {
-        LOGI("Failed to create MuPDF context");
-        return env->NewObjectArray(0, env->FindClass("java/lang/String"), nullptr);
-    }
+    if (!ctx) return env->NewStringUTF("");
 
     fz_register_document_handlers(ctx);
-    fz_set_aa_level(ctx, 8); // anti-aliasing
-    fz_set_text_aa_level(ctx, 8); // text anti-aliasing
+    apply_render_profile(ctx, RENDER_PROFILE_QUALITY);
 
     fz_document* doc = nullptr;
+    fz_page* page = nullptr;
+    fz_pixmap* pix = nullptr;
+    std::string report;
+
     fz_try(ctx) {
-        doc = fz_open_document(ctx, inputFile.c_str());
+        doc = open_document(ctx, inputFile.c_str());
+        page = fz_load_page(ctx, doc, pageNumber);
+        pix = RenderEngine::instance().render_page(ctx, page, RENDER_PROFILE_QUALITY);
+        report = benchmark_page_encodings(ctx, pix, cacheDirStr);
+    } fz_always(ctx) {
+        if (pix) RenderEngine::instance().release_pixmap(ctx, pix);
+        if (page) fz_drop_page(ctx, page);
+        if (doc) fz_drop_document(ctx, doc);
     } fz_catch(ctx) {
-        LOGI("Failed to open document: %s", inputFile.c_str());
-        fz_drop_context(ctx);
-        return env->NewObjectArray(0, env->FindClass("java/lang/String"), nullptr);
+        LOGI("Encode benchmark failed: %s", fz_caught_message(ctx));
+        report = "";
     }
 
-    int totalPages = fz_count_pages(ctx, doc);
-    std::vector<std::string> imagePaths;
-    float scaleFactor = 2.0f;  // 2x scale for higher resolution
-
-    for (int i = 0; i < totalPages; ++i) {
-        fz_page* page = nullptr;
-        fz_pixmap* pix = nullptr;
-        fz_device* dev = nullptr;
-
-        fz_try(ctx) {
-            page = fz_load_page(ctx, doc, i);
-            fz_rect bounds = fz_bound_page(ctx, page);
-
-            if (fz_is_empty_rect(bounds) || (bounds.x1 - bounds.x0) < 10 || (bounds.y1 - bounds.y0) < 10) {
-                LOGI("Page %d has empty or very small bounds, skipping", i + 1);
-                continue;
-            }
-
-            fz_matrix ctm = fz_scale(scaleFactor, scaleFactor);
-            fz_irect bbox = fz_round_rect(fz_transform_rect(bounds, ctm));
-
-            pix = fz_new_pixmap_with_bbox(ctx, fz_device_rgb(ctx), bbox, nullptr, 0);
-            fz_clear_pixmap_with_value(ctx, pix, 0xFF);
+    fz_drop_context(ctx);
+    return env->NewStringUTF(report.c_str());
+}
 
-            fz_matrix transform = fz_identity;
-            dev = fz_new_draw_device(ctx, transform, pix);
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_benchmarkInputStreamsNative(
+        JNIEnv *env, jobject thiz,
+        jstring inputPath) {
 
-            fz_run_page(ctx, page, dev, ctm, nullptr);
-            fz_close_device(ctx, dev);
+    const char* input_cstr = env->GetStringUTFChars(inputPath, nullptr);
+    std::string inputFile(input_cstr);
+    env->ReleaseStringUTFChars(inputPath, input_cstr);
 
-            std::string outPath = cacheDirStr + "/page_" + std::to_string(i + 1) + ".png";
-            fz_save_pixmap_as_png(ctx, pix, outPath.c_str());
-            imagePaths.push_back(outPath);
+    fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
+    if (!ctx) return env->NewStringUTF("");
 
-        } fz_always(ctx) {
-            if (dev) fz_drop_device(ctx, dev);
-            if (pix) fz_drop_pixmap(ctx, pix);
-            if (page) fz_drop_page(ctx, page);
-        } fz_catch(ctx) {
-            LOGI("Error rendering page %d", i + 1);
-            continue;
-        }
-    }
+    fz_register_document_handlers(ctx);
+    std::string report = benchmark_input_streams(ctx, inputFile.c_str());
 
-    fz_drop_document(ctx, doc);
     fz_drop_context(ctx);
-
-    jclass stringClass = env->FindClass("java/lang/String");
-    jobjectArray result = env->NewObjectArray(static_cast<jsize>(imagePaths.size()), stringClass, nullptr);
-
-    for (size_t i = 0; i < imagePaths.size(); ++i) {
-        jstring path = env->NewStringUTF(imagePaths[i].c_str());
-        env->SetObjectArrayElement(result, static_cast<jsize>(i), path);
-        env->DeleteLocalRef(path);
-    }
-
-    return result;
+    return env->NewStringUTF(report.c_str());
 }
 
-
-// RENDER PDF PAGE
+// BENCHMARK OUTPUT WRITERS
+// Saves the document through the direct and the asynchronous output and
+// reports the time of each, fsync included.
 extern "C"
 JNIEXPORT jstring JNICALL
-Java_com_bluepdf_blue_1pdf_MainActivity_renderPdfPageNative(
+Java_com_bluepdf_blue_1pdf_MainActivity_benchmarkOutputWritersNative(
         JNIEnv *env, jobject thiz,
         jstring inputPath,
-        jint pageNumber,
         jstring cacheDir) {
 
     const char* input_cstr = env->GetStringUTFChars(inputPath, nullptr);
     const char* cacheDir_cstr = env->GetStringUTFChars(cacheDir, nullptr);
     std::string inputFile(input_cstr);
     std::string cacheDirStr(cacheDir_cstr);
-
     env->ReleaseStringUTFChars(inputPath, input_cstr);
     env->ReleaseStringUTFChars(cacheDir, cacheDir_cstr);
 
     fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
-    if (!ctx) {
-        LOGI("Failed to create MuPDF context");
-        return env->NewStringUTF("");
-    }
+    if (!ctx) return env->NewStringUTF("");
 
     fz_register_document_handlers(ctx);
-    fz_set_aa_level(ctx, 8);
-    fz_set_text_aa_level(ctx, 8);
+    std::string report = benchmark_output_modes(ctx, inputFile.c_str(), cacheDirStr);
 
-    fz_document* doc = nullptr;
-    fz_try(ctx) {
-        doc = fz_open_document(ctx, inputFile.c_str());
-    } fz_catch(ctx) {
-        LOGI("Failed to open document");
-        fz_drop_context(ctx);
-        return env->NewStringUTF("");
-    }
-
-    int totalPages = fz_count_pages(ctx, doc);
-    if (pageNumber < 0 || pageNumber >= totalPages) {
-        fz_drop_document(ctx, doc);
-        fz_drop_context(ctx);
-        return env->NewStringUTF("");
-    }
+    fz_drop_context(ctx);
+    return env->NewStringUTF(report.c_str());
+}
 
-    fz_page* page = nullptr;
-    fz_pixmap* pix = nullptr;
-    fz_device* dev = nullptr;
-    std::string outPath;
+// --- LINEARIZATION ---
+// Checks a file's linearization dictionary and hint tables against where
+// its objects really are.
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_verifyLinearizationNative(JNIEnv* env, jobject /* this */,
+                                                                  jstring inputPath) {
+    std::string inputFile = string_from_java(env, inputPath);
 
-    float scaleFactor = 1.0f;
+    fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
+    if (!ctx) return env->NewStringUTF("");
 
-    fz_try(ctx) {
-        page = fz_load_page(ctx, doc, pageNumber);
-        fz_rect bounds = fz_bound_page(ctx, page);
-        fz_matrix ctm = fz_scale(scaleFactor, scaleFactor);
-        fz_irect bbox = fz_round_rect(fz_transform_rect(bounds, ctm));
+    fz_register_document_handlers(ctx);
+    std::string report = verify_linearization(ctx, inputFile.c_str());
 
-        pix = fz_new_pixmap_with_bbox(ctx, fz_device_rgb(ctx), bbox, nullptr, 0);
-        fz_clear_pixmap_with_value(ctx, pix, 0xFF);
+    fz_drop_context(ctx);
+    return env->NewStringUTF(report.c_str());
+}
 
-        dev = fz_new_draw_device(ctx, fz_identity, pix);
-        fz_run_page(ctx, page, dev, ctm, nullptr);
-        fz_close_device(ctx, dev);
+// Time to page 1 over a simulated download at kilobytesPerSecond, for the
+// file as it is and for a linearized copy written into cacheDir.
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_benchmarkFirstPageNative(JNIEnv* env, jobject /* this */,
+                                                                 jstring inputPath, jstring cacheDir,
+                                                                 jint kilobytesPerSecond) {
+    std::string inputFile = string_from_java(env, inputPath);
+    std::string cacheDirStr = string_from_java(env, cacheDir);
 
-        outPath = cacheDirStr + "/page_" + std::to_string(pageNumber + 1) + ".png";
-        fz_save_pixmap_as_png(ctx, pix, outPath.c_str());
+    fz_context* ctx = fz_new_context(nullptr, nullptr, FZ_STORE_DEFAULT);
+    if (!ctx) return env->NewStringUTF("");
 
-    } fz_always(ctx) {
-        if (dev) fz_drop_device(ctx, dev);
-        if (pix) fz_drop_pixmap(ctx, pix);
-        if (page) fz_drop_page(ctx, page);
-    } fz_catch(ctx) {
-        LOGI("Error rendering page %d", pageNumber);
-        outPath = "";
-    }
+    fz_register_document_handlers(ctx);
+    std::string report = benchmark_first_page(ctx, inputFile.c_str(), cacheDirStr, kilobytesPerSecond * 1024);
 
-    fz_drop_document(ctx, doc);
     fz_drop_context(ctx);
+    return env->NewStringUTF(report.c_str());
+}
 
-    return env->NewStringUTF(outPath.c_str());
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_benchmarkImageKernelsNative(
+        JNIEnv *env, jobject thiz,
+        jint width,
+        jint height) {
+
+    if (width < 2 || height < 2) return env->NewStringUTF("");
+    std::string report = benchmark_image_kernels(width, height);
+    return env->NewStringUTF(report.c_str());
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_benchmarkAesNative(
+        JNIEnv *env, jobject thiz,
+        jint megabytes) {
+
+    if (megabytes < 1) return env->NewStringUTF("");
+    std::string report = benchmark_aes((size_t)megabytes * 1024 * 1024);
+    return env->NewStringUTF(report.c_str());
+}
+
+// RENDER ENGINE STATS
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_getRenderStatsNative(JNIEnv *env, jobject /* this */) {
+    std::string stats = "{\"pixmapPool\":" + RenderEngine::instance().pixmap_pool().stats_json() +
+                        ",\"parallel\":" + ParallelGovernor::instance().plans_json(0) + "}";
+    return env->NewStringUTF(stats.c_str());
+}
+
+// Thermal status from PowerManager, so parallel work backs off when hot.
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_setThermalStatusNative(JNIEnv *env, jobject /* this */, jint status) {
+    ParallelGovernor::instance().set_thermal_status(status);
+}
+
+// Release idle render buffers when Android reports memory pressure.
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_trimNativeMemoryNative(JNIEnv *env, jobject /* this */) {
+    RenderEngine::instance().pixmap_pool().trim();
 }
 
 // PDF PAGE COUNT
 extern "C"
 JNIEXPORT jint JNICALL
 Java_com_bluepdf_blue_1pdf_MainActivity_getPdfPageCountNative(JNIEnv *env, jobject /* this */,
-                                                              jstring pdfPath_) {
-    // Input validation
-    if (!pdfPath_) {
-        LOGI("Error: PDF path is null");
-        return -1;
-    }
+                                                              jstring pdfPath_, jstring password) {
+    if (!pdfPath_) return -1;
 
     const char *pdfPath = env->GetStringUTFChars(pdfPath_, 0);
-    if (!pdfPath) {
-        LOGI("Error: Failed to get UTF chars from PDF path");
-        return -1;
-    }
+    std::string pdfFile(pdfPath);
+    env->ReleaseStringUTFChars(pdfPath_, pdfPath);
+    std::string inputPassword = string_from_java(env, password);
 
-    LOGI("Attempting to get page count for PDF: %s", pdfPath);
+    fz_context *ctx = fz_new_context(NULL, NULL, FZ_STORE_DEFAULT);
+    if (!ctx) return -1;
 
-    // Create MuPDF context
-    fz_context *ctx = fz_new_context(NULL, NULL, FZ_STORE_UNLIMITED);
-    if (!ctx) {
-        LOGI("Error: Failed to create MuPDF context");
-        env->ReleaseStringUTFChars(pdfPath_, pdfPath);
-        return -1;
-    }
+    fz_register_document_handlers(ctx);
+    DocProbe probe = probe_document(ctx, pdfFile, false, inputPassword);
+    fz_drop_context(ctx);
 
-    LOGI("MuPDF context created successfully");
+    if (!probe.error.empty())
+        LOGI("Page count failed for %s: %s", pdfFile.c_str(), probe.error.c_str());
+    return probe.pageCount > 0 ? probe.pageCount : -1;
+}
+// --- JOBS ---
+// The tools above as background jobs: submitting returns a job id at once
+// and the work runs on the scheduler's pool (see job-scheduler.h). Sources
+// and destinations are held by the job, so the caller may close its
+// descriptors as soon as the submit returns. An empty output writes into
+// the job's own directory. Every state change is reported through
+// MainActivity.onJobUpdate(id, status) while a listener is set.
+
+static JavaVM* g_vm = nullptr;
+static std::mutex g_jobListenerMutex;
+static jobject g_jobListener = nullptr;
+
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
+    g_vm = vm;
+    return JNI_VERSION_1_6;
+}
 
-    jint pageCount = -1;
-    fz_document *doc = NULL;
+// Runs on pool threads, which are attached to the VM on their first update
+// and stay attached; they live as long as the process.
+static void post_job_update(long long id, const std::string& status) {
+    JNIEnv* env = nullptr;
+    if (g_vm->GetEnv((void**)&env, JNI_VERSION_1_6) != JNI_OK &&
+        g_vm->AttachCurrentThread(&env, nullptr) != JNI_OK)
+        return;
+
+    jobject listener = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_jobListenerMutex);
+        if (g_jobListener) listener = env->NewLocalRef(g_jobListener);
+    }
+    if (!listener) return;
+
+    jclass listenerClass = env->GetObjectClass(listener);
+    jmethodID onJobUpdate = env->GetMethodID(listenerClass, "onJobUpdate", "(JLjava/lang/String;)V");
+    if (onJobUpdate) {
+        jstring jStatus = env->NewStringUTF(status.c_str());
+        env->CallVoidMethod(listener, onJobUpdate, (jlong)id, jStatus);
+        env->DeleteLocalRef(jStatus);
+    }
+    if (env->ExceptionCheck()) {
+        LOGI("onJobUpdate threw for job %lld", id);
+        env->ExceptionClear();
+    }
+    env->DeleteLocalRef(listenerClass);
+    env->DeleteLocalRef(listener);
+}
 
-    fz_try(ctx) {
-        LOGI("Registering document handlers...");
-        fz_register_document_handlers(ctx);
-        LOGI("Document handlers registered successfully");
-
-        LOGI("Opening PDF document: %s", pdfPath);
-        doc = fz_open_document(ctx, pdfPath);
-        if (!doc) {
-            LOGI("Error: Failed to open PDF document - document is null");
-            fz_throw(ctx, FZ_ERROR_GENERIC, "Document is null after opening");
+// Take the job's own copies of any "fd:N" specs; on failure none are kept.
+static bool hold_job_fds(const std::vector<std::string*>& specs, std::vector<int>& fds) {
+    for (std::string* spec : specs) {
+        if (!JobScheduler::hold_fd_spec(*spec, fds)) {
+            for (int fd : fds) close(fd);
+            fds.clear();
+            return false;
         }
-        LOGI("PDF document opened successfully");
+    }
+    return true;
+}
 
-        LOGI("Counting pages...");
-        pageCount = fz_count_pages(ctx, doc);
-        LOGI("Page count retrieved successfully: %d pages", pageCount);
+// A recreated activity may start listening before the old one stops, so
+// only the current listener can stop listening.
+extern "C" JNIEXPORT void JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_setJobListenerNative(JNIEnv* env, jobject thiz, jboolean listen) {
+    std::lock_guard<std::mutex> lock(g_jobListenerMutex);
+    if (!listen && !env->IsSameObject(g_jobListener, thiz)) return;
+    if (g_jobListener) env->DeleteGlobalRef(g_jobListener);
+    g_jobListener = listen ? env->NewGlobalRef(thiz) : nullptr;
+    JobScheduler::instance().set_listener(post_job_update);
+}
 
-        // Validate page count
-        if (pageCount <= 0) {
-            LOGI("Warning: Invalid page count returned: %d", pageCount);
-            pageCount = -1;
-        }
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_submitImageToPdfJobNative(JNIEnv* env, jobject /* this */,
+                                                                  jobjectArray imagePaths,
+                                                                  jstring output,
+                                                                  jstring pageSizeMode,
+                                                                  jboolean linearize) {
+    std::vector<std::string> images = strings_from_java(env, imagePaths);
+    std::string outputPath = string_from_java(env, output);
+    bool a4 = string_from_java(env, pageSizeMode) == "A4";
+    PdfOutputOptions layout;
+    layout.linearize = linearize == JNI_TRUE;
+
+    std::vector<std::string*> specs = { &outputPath };
+    for (std::string& image : images) specs.push_back(&image);
+    std::vector<int> fds;
+    if (!hold_job_fds(specs, fds)) return -1;
+
+    return JobScheduler::instance().submit("imageToPdf",
+        [images, outputPath, a4, layout](fz_context* ctx, const std::string& dir, ToolProgress* progress) mutable {
+            if (outputPath.empty()) outputPath = dir + "/output.pdf";
+            return images_to_pdf(ctx, images, outputPath, a4, layout, progress);
+        }, std::move(fds));
+}
 
-    }
-    fz_catch(ctx) {
-        const char *error_msg = fz_caught_message(ctx);
-        int error_code = fz_caught(ctx);
-        LOGI("Error in MuPDF operation - Code: %d, Message: %s", error_code, error_msg ? error_msg : "Unknown error");
-        
-        // Log specific error types
-        switch (error_code) {
-            case FZ_ERROR_GENERIC:
-                LOGI("Error type: Generic error");
-                break;
-            case FZ_ERROR_SYNTAX:
-                LOGI("Error type: Syntax error in PDF");
-                break;
-            case FZ_ERROR_TRYLATER:
-                LOGI("Error type: Try later (resource busy)");
-                break;
-            case FZ_ERROR_ABORT:
-                LOGI("Error type: Operation aborted");
-                break;
-            default:
-                LOGI("Error type: Unknown error code %d", error_code);
-                break;
-        }
-        
-        pageCount = -1;
-    }
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_submitMergeJobNative(JNIEnv* env, jobject /* this */,
+                                                             jobjectArray pdfPaths, jstring output,
+                                                             jstring password, jboolean objectStreams,
+                                                             jboolean linearize, jboolean subsetFonts) {
+    std::vector<std::string> inputs = strings_from_java(env, pdfPaths);
+    std::string outputPath = string_from_java(env, output);
+    std::string inputPassword = string_from_java(env, password);
+    PdfOutputOptions layout;
+    layout.objectStreams = objectStreams == JNI_TRUE;
+    layout.linearize = linearize == JNI_TRUE;
+    layout.subsetFonts = subsetFonts == JNI_TRUE;
+
+    std::vector<std::string*> specs = { &outputPath };
+    for (std::string& input : inputs) specs.push_back(&input);
+    std::vector<int> fds;
+    if (!hold_job_fds(specs, fds)) return -1;
+
+    return JobScheduler::instance().submit("merge",
+        [inputs, outputPath, inputPassword, layout](fz_context* ctx, const std::string& dir,
+                                                    ToolProgress* progress) mutable {
+            if (outputPath.empty()) outputPath = dir + "/merged.pdf";
+            return merge_documents(ctx, inputs, outputPath, inputPassword, layout, progress);
+        }, std::move(fds));
+}
 
-    // Cleanup
-    if (doc) {
-        LOGI("Dropping document...");
-        fz_drop_document(ctx, doc);
-        LOGI("Document dropped successfully");
-    }
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_submitSplitJobNative(JNIEnv* env, jobject /* this */,
+                                                             jstring inputPath, jobject pagesList,
+                                                             jstring output, jstring password,
+                                                             jboolean objectStreams, jboolean linearize,
+                                                             jboolean subsetFonts) {
+    std::string inputFile = string_from_java(env, inputPath);
+    std::string outputPath = string_from_java(env, output);
+    std::string inputPassword = string_from_java(env, password);
+    std::vector<int> pages = ints_from_java_list(env, pagesList);
+    PdfOutputOptions layout;
+    layout.objectStreams = objectStreams == JNI_TRUE;
+    layout.linearize = linearize == JNI_TRUE;
+    layout.subsetFonts = subsetFonts == JNI_TRUE;
+    if (pages.empty()) return -1;
+
+    std::vector<int> fds;
+    if (!hold_job_fds({ &inputFile, &outputPath }, fds)) return -1;
+
+    return JobScheduler::instance().submit("split",
+        [inputFile, pages, outputPath, inputPassword, layout](fz_context* ctx, const std::string& dir,
+                                                              ToolProgress* progress) mutable {
+            if (outputPath.empty()) outputPath = dir + "/split_pdf.pdf";
+            return split_document(ctx, inputFile, pages, outputPath, inputPassword, layout, progress);
+        }, std::move(fds));
+}
 
-    LOGI("Dropping MuPDF context...");
-    fz_drop_context(ctx);
-    LOGI("MuPDF context dropped successfully");
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_submitEncryptJobNative(JNIEnv* env, jobject /* this */,
+                                                               jstring inputPath, jstring password,
+                                                               jstring output, jboolean clean,
+                                                               jstring currentPassword, jboolean linearize) {
+    std::string inputFile = string_from_java(env, inputPath);
+    std::string userPassword = string_from_java(env, password);
+    std::string outputPath = string_from_java(env, output);
+    std::string inputPassword = string_from_java(env, currentPassword);
+    EncryptMode mode = clean == JNI_TRUE ? EncryptMode::CLEAN : EncryptMode::FAST;
+    PdfOutputOptions layout;
+    layout.linearize = linearize == JNI_TRUE;
+
+    std::vector<int> fds;
+    if (!hold_job_fds({ &inputFile, &outputPath }, fds)) return -1;
+
+    return JobScheduler::instance().submit("encrypt",
+        [inputFile, userPassword, outputPath, mode, inputPassword, layout](fz_context* ctx, const std::string& dir,
+                                                                           ToolProgress* progress) mutable {
+            if (outputPath.empty()) outputPath = dir + "/encrypted.pdf";
+            return encrypt_document(ctx, inputFile, userPassword, outputPath, mode, inputPassword, layout, progress);
+        }, std::move(fds));
+}
 
-    // Release JNI string
-    env->ReleaseStringUTFChars(pdfPath_, pdfPath);
-    LOGI("JNI string resources released");
+// preset names an OptimizePreset; unknown names get "balanced".
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_submitOptimizeJobNative(JNIEnv* env, jobject /* this */,
+                                                                jstring inputPath, jstring output,
+                                                                jstring presetName, jstring password,
+                                                                jboolean linearize) {
+    std::string inputFile = string_from_java(env, inputPath);
+    std::string outputPath = string_from_java(env, output);
+    std::string inputPassword = string_from_java(env, password);
+    const OptimizePreset* preset = &optimize_preset_by_name(string_from_java(env, presetName).c_str(),
+                                                            OPTIMIZE_PRESET_BALANCED);
+    PdfOutputOptions layout;
+    layout.linearize = linearize == JNI_TRUE;
+
+    std::vector<int> fds;
+    if (!hold_job_fds({ &inputFile, &outputPath }, fds)) return -1;
+
+    return JobScheduler::instance().submit("optimize",
+        [inputFile, outputPath, preset, inputPassword, layout](fz_context* ctx, const std::string& dir,
+                                                               ToolProgress* progress) mutable {
+            if (outputPath.empty()) outputPath = dir + "/optimized.pdf";
+            return optimize_document(ctx, inputFile, outputPath, *preset, inputPassword, layout, progress);
+        }, std::move(fds));
+}
 
-    LOGI("Final result - Page count: %d", pageCount);
-    return pageCount;
-}
\ No newline at end of file
+// The page image is always written into the job's directory.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_submitRenderPageJobNative(JNIEnv* env, jobject /* this */,
+                                                                  jstring inputPath, jint pageNumber,
+                                                                  jstring profileName, jstring encodingSpec,
+                                                                  jstring password) {
+    std::string inputFile = string_from_java(env, inputPath);
+    std::string inputPassword = string_from_java(env, password);
+    const RenderProfile* profile = &render_profile_from_java(env, profileName, RENDER_PROFILE_QUALITY);
+    PageEncoding encoding = page_encoding_from_java(env, encodingSpec);
+
+    std::vector<int> fds;
+    if (!hold_job_fds({ &inputFile }, fds)) return -1;
+
+    return JobScheduler::instance().submit("renderPage",
+        [inputFile, pageNumber, profile, encoding, inputPassword](fz_context* ctx, const std::string& dir,
+                                                                  ToolProgress* progress) {
+            return render_document_page(ctx, inputFile, pageNumber, *profile, encoding, dir, inputPassword,
+                                        progress);
+        }, std::move(fds));
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_cancelJobNative(JNIEnv* env, jobject /* this */, jlong jobId) {
+    return JobScheduler::instance().cancel(jobId) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_getJobStatusNative(JNIEnv* env, jobject /* this */, jlong jobId) {
+    return env->NewStringUTF(JobScheduler::instance().status_json(jobId).c_str());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_bluepdf_blue_1pdf_MainActivity_releaseJobNative(JNIEnv* env, jobject /* this */, jlong jobId) {
+    JobScheduler::instance().release(jobId);
+}
@@ -0,0 +1,9 @@
+#ifndef BLUEPDF_NATIVE_LOG_H
+#define BLUEPDF_NATIVE_LOG_H
+
+#include <android/log.h>
+
+#define LOG_TAG "MuPDFNative"
+#define LOGI(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+#endif
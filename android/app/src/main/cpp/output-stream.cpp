@@ -0,0 +1,405 @@
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+extern "C" {
+    #include "mupdf/pdf.h"
+}
+
+#include "output-stream.h"
+#include "doc-open.h"
+#include "input-stream.h"
+#include "result-buffer.h"
+#include "native-log.h"
+
+static const int FD_OUTPUT_BUFFER = 64 * 1024;
+
+// Ring of the async output: one slot filling while the others wait for or
+// go through write(2).
+static const int ASYNC_SLOTS = 4;
+static const size_t ASYNC_SLOT_BYTES = 256 * 1024;
+
+int open_destination_fd(const char* destination) {
+    int fd;
+    if (parse_fd_source(destination, &fd)) {
+        if (fd < 0) {
+            errno = EBADF;
+            return -1;
+        }
+        int dup = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dup < 0) return -1;
+        // Providers that ignore "rwt" would otherwise keep a longer old
+        // file's tail. Pipes and sockets fail both calls harmlessly.
+        if (ftruncate(dup, 0) == 0) lseek(dup, 0, SEEK_SET);
+        return dup;
+    }
+    return open(destination, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+struct FdOutput {
+    int fd;
+    bool ownFd;
+    ToolProgress* progress;
+};
+
+static void write_fd(fz_context* ctx, void* opaque, const void* data, size_t n) {
+    FdOutput* state = (FdOutput*)opaque;
+    const char* p = (const char*)data;
+    while (n > 0) {
+        ssize_t written = write(state->fd, p, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            fz_throw(ctx, FZ_ERROR_SYSTEM, "write failed: %s", strerror(errno));
+        }
+        p += written;
+        n -= (size_t)written;
+    }
+    if (state->progress) state->progress->add_bytes((size_t)(p - (const char*)data));
+}
+
+static void seek_fd_output(fz_context* ctx, void* opaque, int64_t offset, int whence) {
+    FdOutput* state = (FdOutput*)opaque;
+    if (lseek(state->fd, (off_t)offset, whence) < 0)
+        fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot seek output: %s", strerror(errno));
+}
+
+static int64_t tell_fd_output(fz_context* ctx, void* opaque) {
+    FdOutput* state = (FdOutput*)opaque;
+    off_t pos = lseek(state->fd, 0, SEEK_CUR);
+    if (pos < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot tell output position: %s", strerror(errno));
+    return (int64_t)pos;
+}
+
+static void truncate_fd_output(fz_context* ctx, void* opaque) {
+    FdOutput* state = (FdOutput*)opaque;
+    off_t pos = lseek(state->fd, 0, SEEK_CUR);
+    if (pos < 0 || ftruncate(state->fd, pos) != 0)
+        fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot truncate output: %s", strerror(errno));
+}
+
+static void drop_fd_output(fz_context* ctx, void* opaque) {
+    FdOutput* state = (FdOutput*)opaque;
+    if (state->ownFd) close(state->fd);
+    fz_free(ctx, state);
+}
+
+fz_output* open_fd_output(fz_context* ctx, int fd, bool ownFd, ToolProgress* progress) {
+    FdOutput* state = nullptr;
+    fz_try(ctx) {
+        state = fz_malloc_struct(ctx, FdOutput);
+    } fz_catch(ctx) {
+        if (ownFd) close(fd);
+        fz_rethrow(ctx);
+    }
+    state->fd = fd;
+    state->ownFd = ownFd;
+    state->progress = progress;
+
+    // fz_new_output drops the state itself when it throws.
+    fz_output* out = fz_new_output(ctx, FD_OUTPUT_BUFFER, state, write_fd, nullptr, drop_fd_output);
+    out->seek = seek_fd_output;
+    out->tell = tell_fd_output;
+    out->truncate = truncate_fd_output;
+    return out;
+}
+
+// --- ASYNC OUTPUT ---
+// The MuPDF thread only copies into the filling slot and takes the lock to
+// hand a full slot over. Nothing here throws; errors come back as errno
+// values and are raised by the fz_output callbacks after every lock is
+// released, since fz_throw would longjmp past them.
+class AsyncFdOutput {
+public:
+    AsyncFdOutput(int fd, bool ownFd, ToolProgress* progress) : fd_(fd), ownFd_(ownFd), progress_(progress) {
+        off_t pos = lseek(fd, 0, SEEK_CUR);
+        pos_ = pos > 0 ? (int64_t)pos : 0;
+        for (int i = 0; i < ASYNC_SLOTS; ++i) slots_[i].data.reset(new unsigned char[ASYNC_SLOT_BYTES]);
+        writer_ = std::thread(&AsyncFdOutput::run, this);
+    }
+
+    ~AsyncFdOutput() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        ready_.notify_all();
+        writer_.join();
+        if (ownFd_) close(fd_);
+    }
+
+    int append(const unsigned char* data, size_t n) {
+        while (n > 0) {
+            Slot& slot = slots_[fill_];
+            size_t chunk = ASYNC_SLOT_BYTES - slot.len;
+            if (chunk > n) chunk = n;
+            memcpy(slot.data.get() + slot.len, data, chunk);
+            slot.len += chunk;
+            pos_ += (int64_t)chunk;
+            data += chunk;
+            n -= chunk;
+            if (slot.len == ASYNC_SLOT_BYTES) {
+                int err = submit();
+                if (err) return err;
+            }
+        }
+        return 0;
+    }
+
+    // Waits until everything appended so far has been written.
+    int drain() {
+        if (slots_[fill_].len > 0) submit();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return queued_ == 0; });
+        return error_;
+    }
+
+    int seek(int64_t offset, int whence) {
+        int err = drain();
+        if (err) return err;
+        off_t pos = lseek(fd_, (off_t)offset, whence);
+        if (pos < 0) return errno;
+        pos_ = (int64_t)pos;
+        return 0;
+    }
+
+    int64_t tell() const { return pos_; }
+
+    int truncate() {
+        int err = drain();
+        if (err) return err;
+        return ftruncate(fd_, (off_t)pos_) == 0 ? 0 : errno;
+    }
+
+    int finish() {
+        int err = drain();
+        if (err) return err;
+        // Pipes and some providers' descriptors cannot be synced.
+        if (fsync(fd_) != 0 && errno != EINVAL && errno != EROFS && errno != ENOTSUP)
+            return errno;
+        return 0;
+    }
+
+private:
+    struct Slot {
+        std::unique_ptr<unsigned char[]> data;
+        size_t len = 0;
+    };
+
+    // Queues the filling slot and moves on to the next one once it is free.
+    int submit() {
+        // Counted here, on the MuPDF thread, so report never runs on the writer.
+        if (progress_) progress_->add_bytes(slots_[fill_].len);
+        std::unique_lock<std::mutex> lock(mutex_);
+        queued_++;
+        ready_.notify_one();
+        fill_ = (fill_ + 1) % ASYNC_SLOTS;
+        done_.wait(lock, [this] { return queued_ < ASYNC_SLOTS; });
+        return error_;
+    }
+
+    void run() {
+        int next = 0;
+        for (;;) {
+            bool discard;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return queued_ > 0 || stop_; });
+                if (queued_ == 0) return;
+                // Dropped without closing: the output is abandoned.
+                discard = stop_ || error_ != 0;
+            }
+
+            Slot& slot = slots_[next];
+            int err = discard ? 0 : write_all(slot.data.get(), slot.len);
+            slot.len = 0;
+            next = (next + 1) % ASYNC_SLOTS;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (err && !error_) error_ = err;
+                queued_--;
+            }
+            done_.notify_all();
+        }
+    }
+
+    int write_all(const unsigned char* p, size_t n) {
+        while (n > 0) {
+            ssize_t written = write(fd_, p, n);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return errno;
+            }
+            p += written;
+            n -= (size_t)written;
+        }
+        return 0;
+    }
+
+    int fd_;
+    bool ownFd_;
+    ToolProgress* progress_;
+    int64_t pos_ = 0;
+    Slot slots_[ASYNC_SLOTS];
+    int fill_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable done_;
+    int queued_ = 0;
+    int error_ = 0;
+    bool stop_ = false;
+    std::thread writer_;
+};
+
+static void write_async(fz_context* ctx, void* opaque, const void* data, size_t n) {
+    int err = ((AsyncFdOutput*)opaque)->append((const unsigned char*)data, n);
+    if (err) fz_throw(ctx, FZ_ERROR_SYSTEM, "write failed: %s", strerror(err));
+}
+
+static void seek_async(fz_context* ctx, void* opaque, int64_t offset, int whence) {
+    int err = ((AsyncFdOutput*)opaque)->seek(offset, whence);
+    if (err) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot seek output: %s", strerror(err));
+}
+
+static int64_t tell_async(fz_context* ctx, void* opaque) {
+    return ((AsyncFdOutput*)opaque)->tell();
+}
+
+static void truncate_async(fz_context* ctx, void* opaque) {
+    int err = ((AsyncFdOutput*)opaque)->truncate();
+    if (err) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot truncate output: %s", strerror(err));
+}
+
+static void close_async(fz_context* ctx, void* opaque) {
+    int err = ((AsyncFdOutput*)opaque)->finish();
+    if (err) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot finish output: %s", strerror(err));
+}
+
+static void drop_async(fz_context* ctx, void* opaque) {
+    delete (AsyncFdOutput*)opaque;
+}
+
+fz_output* open_async_fd_output(fz_context* ctx, int fd, bool ownFd, ToolProgress* progress) {
+    AsyncFdOutput* state = nullptr;
+    try {
+        state = new AsyncFdOutput(fd, ownFd, progress);
+    } catch (const std::exception& e) {
+        LOGI("Async output unavailable (%s); writing directly", e.what());
+        return open_fd_output(ctx, fd, ownFd, progress);
+    }
+
+    // MuPDF writes a byte or a token at a time; its own buffer batches those
+    // so each callback copies a whole run into the slot.
+    // fz_new_output drops the state itself when it throws.
+    fz_output* out = fz_new_output(ctx, FD_OUTPUT_BUFFER, state, write_async, close_async, drop_async);
+    out->seek = seek_async;
+    out->tell = tell_async;
+    out->truncate = truncate_async;
+    return out;
+}
+
+fz_output* open_destination(fz_context* ctx, const char* destination, fz_buffer** memory, OutputMode mode,
+                            ToolProgress* progress) {
+    if (strcmp(destination, MEMORY_DESTINATION) == 0) {
+        if (!memory) fz_throw(ctx, FZ_ERROR_ARGUMENT, "cannot write this output to memory");
+        *memory = fz_new_buffer(ctx, FD_OUTPUT_BUFFER);
+        return fz_new_output_with_buffer(ctx, *memory);
+    }
+
+    int fd = open_destination_fd(destination);
+    if (fd < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot open %s for writing: %s", destination, strerror(errno));
+    if (mode == OutputMode::ASYNC) return open_async_fd_output(ctx, fd, true, progress);
+    return open_fd_output(ctx, fd, true, progress);
+}
+
+char* finish_destination(fz_context* ctx, const char* destination, fz_buffer* memory) {
+    if (!memory) return fz_strdup(ctx, destination);
+    // Allocated first: nothing may throw once the result is published.
+    static const size_t HANDLE_SIZE = 32;
+    char* handle = (char*)fz_malloc(ctx, HANDLE_SIZE);
+    snprintf(handle, HANDLE_SIZE, MEMORY_DESTINATION "%lld", (long long)publish_result_buffer(ctx, memory));
+    return handle;
+}
+
+// --- BENCHMARK ---
+
+static const int BENCHMARK_ROUNDS = 3;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string benchmark_output_modes(fz_context* ctx, const char* path, const std::string& dir) {
+    static const char* const modes[] = { "direct", "async" };
+    std::string outPath = dir + "/output_bench.pdf";
+    std::string json = "[";
+    char entry[160];
+
+    pdf_write_options opts = pdf_default_write_options;
+    opts.do_compress = 1;
+    opts.do_compress_images = 1;
+    opts.do_compress_fonts = 1;
+    opts.do_garbage = 1;
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+        double ms = 0;
+        long long bytes = -1;
+        pdf_document* doc = nullptr;
+        fz_output* out = nullptr;
+        int fd = -1;
+
+        fz_var(ms);
+        fz_var(doc);
+        fz_var(out);
+        fz_var(fd);
+        fz_try(ctx) {
+            for (int r = 0; r < BENCHMARK_ROUNDS; ++r) {
+                doc = open_pdf_document(ctx, path, InputAccess::SEQUENTIAL);
+                fd = open_destination_fd(outPath.c_str());
+                if (fd < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot open %s: %s", outPath.c_str(), strerror(errno));
+
+                auto start = std::chrono::steady_clock::now();
+                out = m == 0 ? open_fd_output(ctx, fd, false) : open_async_fd_output(ctx, fd, false);
+                pdf_write_document(ctx, doc, out, &opts);
+                fz_close_output(ctx, out);
+                // The async output syncs on close; match it.
+                if (m == 0) fsync(fd);
+                ms += elapsed_ms(start);
+
+                fz_drop_output(ctx, out);
+                out = nullptr;
+                close(fd);
+                fd = -1;
+                pdf_drop_document(ctx, doc);
+                doc = nullptr;
+            }
+        } fz_always(ctx) {
+            fz_drop_output(ctx, out);
+            if (fd >= 0) close(fd);
+            pdf_drop_document(ctx, doc);
+        } fz_catch(ctx) {
+            LOGI("Output benchmark (%s) failed: %s", modes[m], fz_caught_message(ctx));
+            ms = -1;
+        }
+
+        struct stat st;
+        if (stat(outPath.c_str(), &st) == 0) bytes = (long long)st.st_size;
+        remove(outPath.c_str());
+
+        if (ms > 0) ms /= BENCHMARK_ROUNDS;
+        snprintf(entry, sizeof(entry), "%s{\"writer\":\"%s\",\"bytes\":%lld,\"saveMs\":%.2f}",
+                 m ? "," : "", modes[m], bytes, ms);
+        json += entry;
+        LOGI("Output benchmark %-6s save %.2f ms", modes[m], ms);
+    }
+    return json + "]";
+}
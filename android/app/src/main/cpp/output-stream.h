@@ -0,0 +1,59 @@
+#ifndef BLUEPDF_OUTPUT_STREAM_H
+#define BLUEPDF_OUTPUT_STREAM_H
+
+#include <string>
+
+#include "tool-progress.h"
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+// Open a destination for writing. A destination is a filesystem path,
+// created or truncated, or "fd:N", a descriptor the caller keeps open for
+// the duration of the call (a content URI the user picked, opened through
+// ContentResolver). Descriptors are duplicated and truncated, so the
+// result is always the caller's to close. Returns -1 with errno set on
+// failure.
+int open_destination_fd(const char* destination);
+
+// fz_output writing to fd with write(2) behind a 64 KB buffer. It can
+// seek, tell and truncate where the descriptor allows it. With ownFd the
+// descriptor is closed when the output is dropped. Each flushed buffer is
+// added to progress->bytes.
+fz_output* open_fd_output(fz_context* ctx, int fd, bool ownFd, ToolProgress* progress = nullptr);
+
+// How written bytes reach the descriptor.
+//  DIRECT: write(2) on the calling thread each time the buffer fills.
+//  ASYNC:  filled buffers pass through a bounded ring to a writer thread,
+//          so serialization and compression go on while storage stalls.
+//          The file is fsync'ed once, when the output is closed.
+enum class OutputMode { DIRECT, ASYNC };
+
+// open_fd_output() with OutputMode::ASYNC. Seeks and truncation first
+// wait for the queued buffers to be written. Falls back to a direct output
+// when the writer thread cannot be started.
+fz_output* open_async_fd_output(fz_context* ctx, int fd, bool ownFd, ToolProgress* progress = nullptr);
+
+// Destination that collects the output in memory for Dart.
+#define MEMORY_DESTINATION "mem:"
+
+// open_destination_fd() and open_fd_output(); throws when the destination
+// cannot be opened. For MEMORY_DESTINATION the output appends to a new
+// buffer returned in *memory (the caller drops it), which must then go
+// through finish_destination(); callers that pass no memory cannot write
+// to memory.
+fz_output* open_destination(fz_context* ctx, const char* destination, fz_buffer** memory = nullptr,
+                            OutputMode mode = OutputMode::DIRECT, ToolProgress* progress = nullptr);
+
+// What a tool reports after writing to destination: destination itself,
+// or "mem:<id>" once the memory output is published (see result-buffer.h).
+// The string is the caller's to fz_free; tools keep it in a plain pointer
+// because their fz_catch rethrows past any C++ destructor.
+char* finish_destination(fz_context* ctx, const char* destination, fz_buffer* memory);
+
+// Time saving the PDF at path (compressed, with garbage collection) into
+// dir through each OutputMode, including the final fsync. Returns JSON.
+std::string benchmark_output_modes(fz_context* ctx, const char* path, const std::string& dir);
+
+#endif
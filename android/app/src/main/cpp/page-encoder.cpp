@@ -0,0 +1,247 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "page-encoder.h"
+#include "native-log.h"
+
+const PageEncoding PAGE_ENCODING_PNG = { PageImageFormat::PNG, 0 };
+
+static const int DEFAULT_JPEG_QUALITY = 80;
+static const size_t PNG_IDAT_CHUNK = 64 * 1024;
+
+PageEncoding parse_page_encoding(const char* spec, const PageEncoding& fallback) {
+    if (!spec || !*spec) return fallback;
+    if (strcmp(spec, "png") == 0) return { PageImageFormat::PNG, 0 };
+    if (strcmp(spec, "png-fast") == 0) return { PageImageFormat::PNG_FAST, 0 };
+    if (strcmp(spec, "raw") == 0) return { PageImageFormat::RAW_RGBA, 0 };
+    if (strncmp(spec, "jpeg", 4) == 0) {
+        int quality = DEFAULT_JPEG_QUALITY;
+        if (spec[4] == ':') quality = atoi(spec + 5);
+        if (quality < 1 || quality > 100) quality = DEFAULT_JPEG_QUALITY;
+        return { PageImageFormat::JPEG, quality };
+    }
+    return fallback;
+}
+
+const char* page_encoding_extension(const PageEncoding& encoding) {
+    switch (encoding.format) {
+        case PageImageFormat::RAW_RGBA: return "rgba";
+        case PageImageFormat::JPEG: return "jpg";
+        default: return "png";
+    }
+}
+
+// --- PNG (fast) ---
+
+static void write_png_chunk(fz_context* ctx, fz_output* out, const char* type,
+                            const unsigned char* data, size_t len) {
+    fz_write_int32_be(ctx, out, (int)len);
+    fz_write_data(ctx, out, type, 4);
+    if (len) fz_write_data(ctx, out, data, len);
+    uLong crc = crc32(0, (const Bytef*)type, 4);
+    if (len) crc = crc32(crc, data, (uInt)len);
+    fz_write_int32_be(ctx, out, (int)crc);
+}
+
+static void write_png_fast(fz_context* ctx, fz_pixmap* pix, fz_output* out) {
+    int w = fz_pixmap_width(ctx, pix);
+    int h = fz_pixmap_height(ctx, pix);
+    int n = fz_pixmap_components(ctx, pix);
+    ptrdiff_t stride = fz_pixmap_stride(ctx, pix);
+    const unsigned char* samples = fz_pixmap_samples(ctx, pix);
+
+    unsigned char colorType = 0;
+    switch (n) {
+        case 1: colorType = 0; break;
+        case 2: colorType = 4; break;
+        case 3: colorType = 2; break;
+        case 4: colorType = 6; break;
+        default: fz_throw(ctx, FZ_ERROR_ARGUMENT, "png-fast: unsupported pixmap with %d components", n);
+    }
+
+    static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    fz_write_data(ctx, out, signature, sizeof(signature));
+
+    unsigned char ihdr[13];
+    ihdr[0] = (unsigned char)(w >> 24); ihdr[1] = (unsigned char)(w >> 16);
+    ihdr[2] = (unsigned char)(w >> 8);  ihdr[3] = (unsigned char)w;
+    ihdr[4] = (unsigned char)(h >> 24); ihdr[5] = (unsigned char)(h >> 16);
+    ihdr[6] = (unsigned char)(h >> 8);  ihdr[7] = (unsigned char)h;
+    ihdr[8] = 8;          // bit depth
+    ihdr[9] = colorType;
+    ihdr[10] = 0;         // deflate
+    ihdr[11] = 0;         // adaptive filtering
+    ihdr[12] = 0;         // no interlace
+    write_png_chunk(ctx, out, "IHDR", ihdr, sizeof(ihdr));
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // Level 1 with RLE matching is several times cheaper than the default
+    // level and still compresses flat page backgrounds very well.
+    if (deflateInit2(&zs, 1, Z_DEFLATED, 15, 8, Z_RLE) != Z_OK)
+        fz_throw(ctx, FZ_ERROR_LIBRARY, "png-fast: deflateInit failed");
+
+    size_t rowBytes = (size_t)w * n;
+    unsigned char* row = nullptr;
+    unsigned char* idat = nullptr;
+
+    fz_var(row);
+    fz_var(idat);
+    fz_try(ctx) {
+        row = (unsigned char*)fz_malloc(ctx, rowBytes + 1);
+        idat = (unsigned char*)fz_malloc(ctx, PNG_IDAT_CHUNK);
+        zs.next_out = idat;
+        zs.avail_out = (uInt)PNG_IDAT_CHUNK;
+
+        for (int y = 0; y <= h; ++y) {
+            int flush = Z_NO_FLUSH;
+            if (y < h) {
+                const unsigned char* src = samples + y * stride;
+                // "Up" filter: page renders are mostly vertical runs of paper white.
+                row[0] = y > 0 ? 2 : 0;
+                if (y > 0) {
+                    const unsigned char* prev = src - stride;
+                    for (size_t i = 0; i < rowBytes; ++i)
+                        row[i + 1] = (unsigned char)(src[i] - prev[i]);
+                } else {
+                    memcpy(row + 1, src, rowBytes);
+                }
+                zs.next_in = row;
+                zs.avail_in = (uInt)(rowBytes + 1);
+            } else {
+                zs.next_in = nullptr;
+                zs.avail_in = 0;
+                flush = Z_FINISH;
+            }
+
+            for (;;) {
+                int ret = deflate(&zs, flush);
+                if (ret == Z_STREAM_ERROR)
+                    fz_throw(ctx, FZ_ERROR_LIBRARY, "png-fast: deflate failed");
+                if (zs.avail_out == 0) {
+                    write_png_chunk(ctx, out, "IDAT", idat, PNG_IDAT_CHUNK);
+                    zs.next_out = idat;
+                    zs.avail_out = (uInt)PNG_IDAT_CHUNK;
+                    continue;
+                }
+                if (flush == Z_FINISH ? ret == Z_STREAM_END : zs.avail_in == 0)
+                    break;
+            }
+        }
+
+        size_t pending = PNG_IDAT_CHUNK - zs.avail_out;
+        if (pending) write_png_chunk(ctx, out, "IDAT", idat, pending);
+        write_png_chunk(ctx, out, "IEND", nullptr, 0);
+    } fz_always(ctx) {
+        deflateEnd(&zs);
+        fz_free(ctx, row);
+        fz_free(ctx, idat);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// --- RAW RGBA ---
+
+static void write_raw_rgba(fz_context* ctx, fz_pixmap* pix, fz_output* out) {
+    int w = fz_pixmap_width(ctx, pix);
+    int h = fz_pixmap_height(ctx, pix);
+    int n = fz_pixmap_components(ctx, pix);
+    int alpha = fz_pixmap_alpha(ctx, pix);
+    ptrdiff_t stride = fz_pixmap_stride(ctx, pix);
+    const unsigned char* samples = fz_pixmap_samples(ctx, pix);
+
+    if (n - alpha != 3 && n - alpha != 1)
+        fz_throw(ctx, FZ_ERROR_ARGUMENT, "raw: unsupported pixmap with %d components", n);
+
+    fz_write_data(ctx, out, RAW_PAGE_MAGIC, 4);
+    fz_write_int32_le(ctx, out, w);
+    fz_write_int32_le(ctx, out, h);
+    fz_write_int32_le(ctx, out, w * 4);
+
+    // MuPDF pixmaps with alpha are already premultiplied, and opaque
+    // pixmaps are trivially so, which is what Flutter's decoders expect.
+    size_t rowBytes = (size_t)w * 4;
+    unsigned char* row = (unsigned char*)fz_malloc(ctx, rowBytes);
+    fz_try(ctx) {
+        for (int y = 0; y < h; ++y) {
+            const unsigned char* src = samples + y * stride;
+            unsigned char* dst = row;
+            for (int x = 0; x < w; ++x, src += n, dst += 4) {
+                if (n - alpha == 3) {
+                    dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2];
+                } else {
+                    dst[0] = dst[1] = dst[2] = src[0];
+                }
+                dst[3] = alpha ? src[n - 1] : 0xFF;
+            }
+            fz_write_data(ctx, out, row, rowBytes);
+        }
+    } fz_always(ctx) {
+        fz_free(ctx, row);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+void save_page_image(fz_context* ctx, fz_pixmap* pix, const char* path, const PageEncoding& encoding) {
+    if (encoding.format == PageImageFormat::PNG) {
+        fz_save_pixmap_as_png(ctx, pix, path);
+        return;
+    }
+    if (encoding.format == PageImageFormat::JPEG) {
+        fz_save_pixmap_as_jpeg(ctx, pix, path, encoding.jpegQuality);
+        return;
+    }
+
+    fz_output* out = fz_new_output_with_path(ctx, path, 0);
+    fz_try(ctx) {
+        if (encoding.format == PageImageFormat::PNG_FAST) {
+            write_png_fast(ctx, pix, out);
+        } else {
+            write_raw_rgba(ctx, pix, out);
+        }
+        fz_close_output(ctx, out);
+    } fz_always(ctx) {
+        fz_drop_output(ctx, out);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// --- BENCHMARK ---
+
+std::string benchmark_page_encodings(fz_context* ctx, fz_pixmap* pix, const std::string& dir) {
+    static const char* specs[] = { "png", "png-fast", "raw", "jpeg:90", "jpeg:75", "jpeg:50" };
+    const int rounds = 3;
+
+    std::string json = "[";
+    for (size_t i = 0; i < sizeof(specs) / sizeof(specs[0]); ++i) {
+        PageEncoding encoding = parse_page_encoding(specs[i], PAGE_ENCODING_PNG);
+        std::string path = dir + "/encode_bench." + page_encoding_extension(encoding);
+
+        double totalMs = 0;
+        for (int r = 0; r < rounds; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            save_page_image(ctx, pix, path.c_str(), encoding);
+            totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        struct stat st;
+        long long bytes = stat(path.c_str(), &st) == 0 ? (long long)st.st_size : -1;
+        remove(path.c_str());
+
+        char entry[160];
+        snprintf(entry, sizeof(entry), "%s{\"encoding\":\"%s\",\"ms\":%.2f,\"bytes\":%lld}",
+                 i ? "," : "", specs[i], totalMs / rounds, bytes);
+        json += entry;
+        LOGI("Encode benchmark %dx%d %-8s %8.2f ms %10lld bytes",
+             fz_pixmap_width(ctx, pix), fz_pixmap_height(ctx, pix), specs[i], totalMs / rounds, bytes);
+    }
+    return json + "]";
+}
@@ -0,0 +1,47 @@
+#ifndef BLUEPDF_PAGE_ENCODER_H
+#define BLUEPDF_PAGE_ENCODER_H
+
+#include <string>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+// Encodings for cached page images.
+//   png      - MuPDF's PNG writer (default zlib settings)
+//   png-fast - PNG with zlib level 1 and RLE strategy; lossless, decodes anywhere
+//   raw      - 16 byte header + premultiplied RGBA rows, no compression
+//   jpeg[:q] - lossy, for thumbnails (quality defaults to 80)
+enum class PageImageFormat {
+    PNG,
+    PNG_FAST,
+    RAW_RGBA,
+    JPEG
+};
+
+struct PageEncoding {
+    PageImageFormat format;
+    int jpegQuality;
+};
+
+extern const PageEncoding PAGE_ENCODING_PNG;
+
+// Parse "png", "png-fast", "raw" or "jpeg[:quality]"; null or unknown
+// specs return the fallback.
+PageEncoding parse_page_encoding(const char* spec, const PageEncoding& fallback);
+
+// File extension (without dot) for files written with this encoding.
+const char* page_encoding_extension(const PageEncoding& encoding);
+
+// Write pix to path in the requested encoding. Throws on failure.
+void save_page_image(fz_context* ctx, fz_pixmap* pix, const char* path, const PageEncoding& encoding);
+
+// Encode pix with every encoding a few times and report the average encode
+// time and the output size as a JSON array. Files are written into dir.
+std::string benchmark_page_encodings(fz_context* ctx, fz_pixmap* pix, const std::string& dir);
+
+// Raw cache header, all fields little endian.
+#define RAW_PAGE_MAGIC "BPRA"
+#define RAW_PAGE_HEADER_SIZE 16
+
+#endif
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "parallel-governor.h"
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+#define GOVERNOR_MB (1024LL * 1024)
+
+// Memory each worker needs besides its store: probes hold a parsed xref,
+// renders a full page pixmap plus its display list, tools a document and
+// a writer with its buffers.
+#define PROBE_WORKER_BYTES    (8 * GOVERNOR_MB)
+#define RENDER_WORKER_BYTES   (96 * GOVERNOR_MB)
+#define DOCUMENT_WORKER_BYTES (48 * GOVERNOR_MB)
+
+// Probing is mostly small reads, so a few threads keep storage busy.
+#define PROBE_MAX_WORKERS 4
+
+// Share of available memory that parallel work may claim. The rest stays
+// for the Dart and Java heaps and for other apps.
+#define MEMORY_SHARE_PERCENT 50
+
+// Below this share of total memory available the device is close to the
+// low memory killer: one worker, smallest store.
+#define TIGHT_MEMORY_PERCENT 10
+
+// Store limit never goes below this; smaller stores just thrash.
+#define MIN_STORE_BYTES (16 * GOVERNOR_MB)
+
+// PowerManager.THERMAL_STATUS_SEVERE and _CRITICAL. From severe on the
+// platform throttles anyway, so fewer threads lose little and run cooler.
+#define THERMAL_STATUS_SEVERE   3
+#define THERMAL_STATUS_CRITICAL 4
+
+static long long worker_bytes(WorkKind kind) {
+    switch (kind) {
+        case WorkKind::PROBE:    return PROBE_WORKER_BYTES;
+        case WorkKind::RENDER:   return RENDER_WORKER_BYTES;
+        case WorkKind::DOCUMENT: return DOCUMENT_WORKER_BYTES;
+    }
+    return DOCUMENT_WORKER_BYTES;
+}
+
+static const char* work_kind_name(WorkKind kind) {
+    switch (kind) {
+        case WorkKind::PROBE:    return "probe";
+        case WorkKind::RENDER:   return "render";
+        case WorkKind::DOCUMENT: return "document";
+    }
+    return "unknown";
+}
+
+ParallelGovernor& ParallelGovernor::instance() {
+    // Never destroyed: detached job workers plan until the process dies.
+    static ParallelGovernor* governor = new ParallelGovernor();
+    return *governor;
+}
+
+ParallelGovernor::ParallelGovernor() : storeBudget_(FZ_STORE_DEFAULT) {
+}
+
+void ParallelGovernor::set_store_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    storeBudget_ = std::max<size_t>(bytes, MIN_STORE_BYTES);
+}
+
+void ParallelGovernor::set_thermal_status(int status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    thermalStatus_ = status;
+}
+
+void ParallelGovernor::set_reader(SystemReader reader) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reader_ = std::move(reader);
+}
+
+SystemReadings ParallelGovernor::read() {
+    SystemReader reader;
+    int thermal;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reader = reader_;
+        thermal = thermalStatus_;
+    }
+    SystemReadings readings = reader ? reader() : read_system();
+    readings.thermalStatus = std::max(readings.thermalStatus, thermal);
+    return readings;
+}
+
+ParallelPlan ParallelGovernor::plan(WorkKind kind, int items) {
+    SystemReadings readings = read();
+    long long budget;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget = (long long)storeBudget_;
+    }
+
+    int workers = std::max(1, readings.onlineCpus);
+    if (kind == WorkKind::PROBE) workers = std::min(workers, PROBE_MAX_WORKERS);
+    if (items > 0) workers = std::min(workers, items);
+
+    long long base = worker_bytes(kind);
+    long long store = budget;
+    long long available = readings.availableBytes;
+    if (available < 0 && readings.totalBytes > 0) available = readings.totalBytes / 4;
+
+    if (available >= 0) {
+        long long usable = available * MEMORY_SHARE_PERCENT / 100;
+        bool tight = readings.totalBytes > 0 && available * 100 < readings.totalBytes * TIGHT_MEMORY_PERCENT;
+        if (tight) {
+            workers = 1;
+            store = MIN_STORE_BYTES;
+        } else {
+            // Fit as many workers as the smallest store allows, then give
+            // them whatever is left as store, up to the budget.
+            long long fit = usable / (base + MIN_STORE_BYTES);
+            workers = (int)std::max(1LL, std::min<long long>(workers, fit));
+            store = std::max<long long>(MIN_STORE_BYTES, std::min(budget, usable / workers - base));
+        }
+    }
+
+    if (readings.thermalStatus >= THERMAL_STATUS_CRITICAL)
+        workers = 1;
+    else if (readings.thermalStatus >= THERMAL_STATUS_SEVERE)
+        workers = std::max(1, workers / 2);
+
+    ParallelPlan plan;
+    plan.workers = workers;
+    plan.storeBytes = (size_t)store;
+    plan.inflightBytes = (size_t)(workers * (base + store));
+    return plan;
+}
+
+std::string ParallelGovernor::plans_json(int items) {
+    SystemReadings readings = read();
+    char buf[192];
+    snprintf(buf, sizeof(buf),
+             "{\"onlineCpus\":%d,\"totalBytes\":%lld,\"availableBytes\":%lld,\"thermalStatus\":%d",
+             readings.onlineCpus, readings.totalBytes, readings.availableBytes, readings.thermalStatus);
+    std::string json = buf;
+
+    for (WorkKind kind : {WorkKind::PROBE, WorkKind::RENDER, WorkKind::DOCUMENT}) {
+        ParallelPlan p = plan(kind, items);
+        snprintf(buf, sizeof(buf), ",\"%s\":{\"workers\":%d,\"storeBytes\":%zu,\"inflightBytes\":%zu}",
+                 work_kind_name(kind), p.workers, p.storeBytes, p.inflightBytes);
+        json += buf;
+    }
+    return json + "}";
+}
+
+SystemReadings ParallelGovernor::read_system() {
+    SystemReadings readings;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    readings.onlineCpus = cpus > 0 ? (int)cpus : 1;
+
+    FILE* f = fopen("/proc/meminfo", "re");
+    if (f) {
+        char text[4096];
+        size_t n = fread(text, 1, sizeof(text) - 1, f);
+        text[n] = '\0';
+        fclose(f);
+        parse_meminfo(text, &readings);
+    }
+    return readings;
+}
+
+bool ParallelGovernor::parse_meminfo(const char* text, SystemReadings* readings) {
+    long long total = -1, available = -1, freeKb = -1, cached = -1;
+
+    for (const char* line = text; line && *line; ) {
+        char name[32];
+        long long kb;
+        if (sscanf(line, "%31[^:]: %lld", name, &kb) == 2) {
+            if (strcmp(name, "MemTotal") == 0) total = kb;
+            else if (strcmp(name, "MemAvailable") == 0) available = kb;
+            else if (strcmp(name, "MemFree") == 0) freeKb = kb;
+            else if (strcmp(name, "Cached") == 0) cached = kb;
+        }
+        line = strchr(line, '\n');
+        if (line) ++line;
+    }
+
+    if (available < 0 && freeKb >= 0)
+        available = freeKb + std::max(0LL, cached);
+    if (total < 0 && available < 0) return false;
+
+    readings->totalBytes = total >= 0 ? total * 1024 : -1;
+    readings->availableBytes = available >= 0 ? available * 1024 : -1;
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef BLUEPDF_PARALLEL_GOVERNOR_H
+#define BLUEPDF_PARALLEL_GOVERNOR_H
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// What the governor knows about the device at one moment. Byte counts
+// are -1 when unknown.
+struct SystemReadings {
+    int onlineCpus = 1;
+    long long totalBytes = -1;      // MemTotal
+    long long availableBytes = -1;  // MemAvailable
+    int thermalStatus = 0;          // PowerManager.THERMAL_STATUS_*, 0 when cool
+};
+
+// Where the readings come from. The default reads sysconf() and
+// /proc/meminfo; tests on a desktop substitute fixed readings.
+using SystemReader = std::function<SystemReadings()>;
+
+// Kinds of parallel work, each with its own per-worker memory cost.
+enum class WorkKind {
+    PROBE,     // batch file probes: small reads, little memory
+    RENDER,    // page rasterization: a full page pixmap per worker
+    DOCUMENT,  // background tools: a document, a writer and a store each
+};
+
+struct ParallelPlan {
+    int workers;           // at least 1
+    size_t storeBytes;     // fz_context store limit for each worker
+    size_t inflightBytes;  // what all workers together are expected to hold
+};
+
+// Picks how many workers a parallel path may run and how much memory each
+// gets, from the online CPUs, available memory, thermal state and the
+// store budget. Every plan() reads the system afresh, so concurrency
+// drops as soon as memory gets tight or the device heats up. Thread-safe.
+class ParallelGovernor {
+public:
+    static ParallelGovernor& instance();
+
+    ParallelGovernor();
+
+    // Plan for at most items pieces of work of kind.
+    ParallelPlan plan(WorkKind kind, int items);
+
+    // Store limit handed to each worker when memory is plentiful.
+    void set_store_budget(size_t bytes);
+
+    // Latest PowerManager thermal status, pushed from Kotlin.
+    void set_thermal_status(int status);
+
+    // Replace the system reader; nullptr restores the default.
+    void set_reader(SystemReader reader);
+
+    // Current readings and the plan of every kind, for diagnostics.
+    std::string plans_json(int items);
+
+    static SystemReadings read_system();
+
+    // Fill totalBytes and availableBytes from /proc/meminfo text. Kernels
+    // without MemAvailable get MemFree + Cached instead. Returns false when
+    // nothing usable was found.
+    static bool parse_meminfo(const char* text, SystemReadings* readings);
+
+private:
+    SystemReadings read();
+
+    std::mutex mutex_;
+    SystemReader reader_;
+    size_t storeBudget_;
+    int thermalStatus_ = 0;
+};
+
+#endif
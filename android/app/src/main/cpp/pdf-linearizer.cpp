@@ -0,0 +1,1398 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pdf-linearizer.h"
+#include "doc-open.h"
+#include "doc-probe.h"
+#include "input-stream.h"
+#include "native-log.h"
+#include "output-stream.h"
+
+// Where the objects taken over from the document go (ISO 32000 Annex
+// F.3). The header, linearization dictionary, first-page xref and hint
+// stream (parts 1-3 and 5) are written here and have no source object.
+enum LinearPart {
+    PART_NONE,    // not placed yet
+    PART_OPEN,    // part 4: catalog and what opening the document needs
+    PART_FIRST,   // part 6: page 1 and everything it uses
+    PART_PAGES,   // part 7: each other page with the objects only it uses
+    PART_SHARED,  // part 8: objects used by several other pages
+    PART_OTHER,   // part 9: everything else
+};
+
+#define PART_BIT(part) (1 << (part))
+
+// Objects a walk stops at rather than following into.
+enum Barrier {
+    BARRIER_PAGE = 1,     // page objects
+    BARRIER_TREE = 2,     // intermediate page tree nodes
+    BARRIER_CATALOG = 4,
+    BARRIER_ENCRYPT = 8,  // the encryption dictionary is never encrypted
+};
+
+#define PAGE_BARRIERS (BARRIER_PAGE | BARRIER_TREE | BARRIER_CATALOG | BARRIER_ENCRYPT)
+
+// Offsets filled into the linearization dictionary and the first-page
+// trailer once the layout is known. The zero placeholders written while
+// measuring take the same room.
+#define LINEAR_OFFSET_FORMAT "%010lld"
+
+// One xref table entry, "oooooooooo ggggg n \n".
+#define XREF_ENTRY_BYTES 20
+
+static int bits_for(long long value) {
+    int bits = 0;
+    while (value > 0) {
+        ++bits;
+        value >>= 1;
+    }
+    return bits;
+}
+
+// Big-endian bit packing for the hint tables.
+struct BitWriter {
+    std::vector<unsigned char>& out;
+    unsigned int acc = 0;
+    int count = 0;
+
+    explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+    void put(long long value, int bits) {
+        for (int i = bits - 1; i >= 0; --i) {
+            acc = (acc << 1) | (unsigned int)((value >> i) & 1);
+            if (++count == 8) {
+                out.push_back((unsigned char)acc);
+                acc = 0;
+                count = 0;
+            }
+        }
+    }
+
+    // Each hint table item starts on a byte boundary.
+    void flush() {
+        if (count) put(0, 8 - count);
+    }
+};
+
+struct BitReader {
+    const unsigned char* data;
+    size_t len;
+    size_t bit;
+    bool overrun = false;
+
+    BitReader(const unsigned char* data, size_t len, size_t start) : data(data), len(len), bit(start * 8) {}
+
+    long long get(int bits) {
+        long long value = 0;
+        for (int i = 0; i < bits; ++i) {
+            if (bit / 8 >= len) {
+                overrun = true;
+                return value;
+            }
+            value = (value << 1) | ((data[bit / 8] >> (7 - bit % 8)) & 1);
+            ++bit;
+        }
+        return value;
+    }
+
+    void align() { bit = (bit + 7) / 8 * 8; }
+};
+
+static void append_hex(fz_context* ctx, void* arg, const unsigned char* data, size_t n) {
+    static const char digits[] = "0123456789abcdef";
+    fz_buffer* buf = (fz_buffer*)arg;
+    for (size_t i = 0; i < n; ++i) {
+        fz_append_byte(ctx, buf, digits[data[i] >> 4]);
+        fz_append_byte(ctx, buf, digits[data[i] & 15]);
+    }
+}
+
+static void append_raw(fz_context* ctx, void* arg, const unsigned char* data, size_t n) {
+    fz_append_data(ctx, (fz_buffer*)arg, data, n);
+}
+
+static void write_raw(fz_context* ctx, void* arg, const unsigned char* data, size_t n) {
+    fz_write_data(ctx, (fz_output*)arg, data, n);
+}
+
+// --- WRITER ---
+
+// Lays doc out in three passes: place every object in a part, serialize
+// them under their new numbers to learn their lengths, then write the
+// file with offsets and hint tables computed from those lengths. Every
+// member may throw, so the containers live here rather than in the stack
+// frames a throw longjmps past; write_linearized() keeps the object itself
+// on the heap and deletes it in fz_always.
+class Linearizer {
+public:
+    Linearizer(fz_context* ctx, pdf_document* doc) : ctx_(ctx), doc_(doc), crypt_(doc->crypt) {}
+
+    ~Linearizer() {
+        for (fz_buffer* buf : texts_) fz_drop_buffer(ctx_, buf);
+        fz_drop_buffer(ctx_, hint_);
+        fz_drop_buffer(ctx_, stream_);
+    }
+
+    void write(fz_output* out) {
+        classify();
+        number();
+        serialize();
+        layout();
+        emit(out);
+    }
+
+private:
+    fz_context* ctx_;
+    pdf_document* doc_;
+    pdf_crypt* crypt_;
+    int xrefLen_ = 0;
+    pdf_obj* catalog_ = nullptr;  // borrowed from the trailer
+    pdf_obj* encrypt_ = nullptr;
+
+    // By source object number.
+    std::vector<int> part_;      // LinearPart
+    std::vector<int> barrier_;   // Barrier bits
+    std::vector<int> owner_;     // the one page (>= 1) using it, -1 none yet, -2 several
+    std::vector<int> mark_;      // epoch of the last walk that met it
+    std::vector<int> sharedId_;  // shared object hint table entry, -1 none
+    std::vector<int> target_;    // new number, 0 when not written
+
+    int epoch_ = 0;
+    std::vector<pdf_obj*> stack_;
+    std::vector<int> reached_;
+
+    int pageCount_ = 0;
+    std::vector<pdf_obj*> pageObjs_;          // borrowed from the page tree
+    std::vector<int> pageNums_;
+    std::vector<std::vector<int>> pageUses_;  // what each page >= 1 reaches
+    std::vector<size_t> pageStart_;           // order_ index of each page's first object
+    std::vector<int> pageObjects_;
+
+    std::vector<int> open_, first_, pages_, shared_, other_;
+
+    // Source numbers in file order: parts 4, 6, 7, 8 and 9.
+    std::vector<int> order_;
+    size_t firstIndex_ = 0;   // where part 6 starts in order_
+    size_t pagesIndex_ = 0;   // part 7
+    size_t sharedIndex_ = 0;  // part 8
+    size_t otherIndex_ = 0;   // part 9
+
+    int linNum_ = 0, hintNum_ = 0, total_ = 0;
+
+    // By order_ index: the object up to its stream data, the stream data
+    // length as written (-1 without a stream), the whole object's length
+    // and its offset as the hint tables give it.
+    std::vector<fz_buffer*> texts_;
+    std::vector<long long> streamLen_;
+    std::vector<long long> length_;
+    std::vector<long long> offset_;
+
+    char header_[32] = {};
+    fz_buffer* hint_ = nullptr;    // the hint stream object as written
+    fz_buffer* stream_ = nullptr;  // stream data being copied
+    std::vector<unsigned char> hintData_;
+    long long hintSharedOffset_ = 0;
+    long long headerLen_ = 0, linLen_ = 0, firstXrefLen_ = 0, firstTrailerLen_ = 0;
+    long long hintOffset_ = 0, hintLen_ = 0;
+    long long firstPageEnd_ = 0, mainXref_ = 0, fileLen_ = 0;
+
+    // --- Placing objects ---
+
+    void push_children(pdf_obj* obj, bool stream) {
+        if (pdf_is_array(ctx_, obj)) {
+            for (int i = pdf_array_len(ctx_, obj) - 1; i >= 0; --i) {
+                pdf_obj* item = pdf_array_get(ctx_, obj, i);
+                if (pdf_is_indirect(ctx_, item) || pdf_is_array(ctx_, item) || pdf_is_dict(ctx_, item))
+                    stack_.push_back(item);
+            }
+        } else if (pdf_is_dict(ctx_, obj)) {
+            for (int i = pdf_dict_len(ctx_, obj) - 1; i >= 0; --i) {
+                // A stream's /Length is written in place; an indirect one
+                // is not kept.
+                if (stream && pdf_name_eq(ctx_, pdf_dict_get_key(ctx_, obj, i), PDF_NAME(Length))) continue;
+                pdf_obj* val = pdf_dict_get_val(ctx_, obj, i);
+                if (pdf_is_indirect(ctx_, val) || pdf_is_array(ctx_, val) || pdf_is_dict(ctx_, val))
+                    stack_.push_back(val);
+            }
+        }
+    }
+
+    void begin_walk() {
+        ++epoch_;
+        reached_.clear();
+        stack_.clear();
+    }
+
+    // Depth first from what is on the stack, collecting in reached_ the
+    // objects met in the order a reader meets them. Objects behind one of
+    // barriers are not collected; those outside the descend parts are
+    // collected but not followed.
+    void run_walk(int descend, int barriers) {
+        while (!stack_.empty()) {
+            pdf_obj* obj = stack_.back();
+            stack_.pop_back();
+            bool stream = false;
+
+            if (pdf_is_indirect(ctx_, obj)) {
+                int num = pdf_to_num(ctx_, obj);
+                if (num <= 0 || num >= xrefLen_ || mark_[num] == epoch_) continue;
+                mark_[num] = epoch_;
+                if (barrier_[num] & barriers) continue;
+
+                pdf_obj* resolved = pdf_resolve_indirect(ctx_, obj);
+                if (!resolved || pdf_is_null(ctx_, resolved)) continue;
+                reached_.push_back(num);
+                if (!(descend & PART_BIT(part_[num]))) continue;
+                stream = pdf_obj_num_is_stream(ctx_, doc_, num);
+                obj = resolved;
+            }
+            push_children(obj, stream);
+        }
+    }
+
+    void walk(pdf_obj* start, int descend, int barriers) {
+        begin_walk();
+        stack_.push_back(start);
+        run_walk(descend, barriers);
+    }
+
+    // A page object first, then what it reaches.
+    void walk_page(int page) {
+        begin_walk();
+        pdf_obj* dict = pageObjs_[page];
+        mark_[pageNums_[page]] = epoch_;
+        reached_.push_back(pageNums_[page]);
+        push_children(dict, false);
+        run_walk(PART_BIT(PART_NONE), PAGE_BARRIERS);
+    }
+
+    void take_walk(std::vector<int>& list, int part) {
+        for (int num : reached_) {
+            if (part_[num] != PART_NONE) continue;
+            part_[num] = part;
+            list.push_back(num);
+        }
+    }
+
+    void mark_barriers() {
+        int catalogNum = pdf_to_num(ctx_, catalog_);
+        barrier_[catalogNum] |= BARRIER_CATALOG;
+        if (pdf_is_indirect(ctx_, encrypt_) && pdf_to_num(ctx_, encrypt_) < xrefLen_)
+            barrier_[pdf_to_num(ctx_, encrypt_)] |= BARRIER_ENCRYPT;
+
+        for (int i = 0; i < pageCount_; ++i) {
+            pdf_obj* page = pdf_lookup_page_obj(ctx_, doc_, i);
+            int num = pdf_to_num(ctx_, page);
+            if (num <= 0 || num >= xrefLen_ || (barrier_[num] & BARRIER_PAGE))
+                fz_throw(ctx_, FZ_ERROR_FORMAT, "page %d is not a distinct object", i + 1);
+            pageObjs_[i] = pdf_resolve_indirect(ctx_, page);
+            pageNums_[i] = num;
+            barrier_[num] |= BARRIER_PAGE;
+
+            for (pdf_obj* node = pdf_dict_get(ctx_, page, PDF_NAME(Parent)); pdf_is_indirect(ctx_, node);
+                 node = pdf_dict_get(ctx_, node, PDF_NAME(Parent))) {
+                int n = pdf_to_num(ctx_, node);
+                if (n <= 0 || n >= xrefLen_ || (barrier_[n] & BARRIER_TREE)) break;
+                barrier_[n] |= BARRIER_TREE;
+            }
+        }
+    }
+
+    // Page tree nodes end up in part 9, at the end of the file, so a page
+    // cannot inherit from them what a reader needs to show it. Copy each
+    // inherited attribute into every page using it, as MuPDF's linearizer
+    // and qpdf did, then drop it from the nodes.
+    void localise_page_attributes() {
+        pdf_obj* keys[] = {
+            PDF_NAME(Resources), PDF_NAME(MediaBox), PDF_NAME(CropBox), PDF_NAME(Rotate),
+        };
+        for (int i = 0; i < pageCount_; ++i) {
+            for (pdf_obj* key : keys) {
+                if (pdf_dict_get(ctx_, pageObjs_[i], key)) continue;
+                pdf_obj* inherited = pdf_dict_get_inheritable(ctx_, pageObjs_[i], key);
+                if (!inherited) continue;
+                // A direct value gets a copy per page, as it would if the
+                // page had been written with its own.
+                if (pdf_is_indirect(ctx_, inherited))
+                    pdf_dict_put(ctx_, pageObjs_[i], key, inherited);
+                else
+                    pdf_dict_put_drop(ctx_, pageObjs_[i], key, pdf_deep_copy_obj(ctx_, inherited));
+            }
+        }
+        // A node met before has had itself and its ancestors cleared.
+        begin_walk();
+        for (int i = 0; i < pageCount_; ++i) {
+            for (pdf_obj* node = pdf_dict_get(ctx_, pageObjs_[i], PDF_NAME(Parent)); pdf_is_dict(ctx_, node);
+                 node = pdf_dict_get(ctx_, node, PDF_NAME(Parent))) {
+                int num = pdf_to_num(ctx_, node);
+                if (num <= 0 || num >= xrefLen_ || mark_[num] == epoch_) break;
+                mark_[num] = epoch_;
+                for (pdf_obj* key : keys) pdf_dict_del(ctx_, node, key);
+            }
+        }
+    }
+
+    void classify() {
+        xrefLen_ = pdf_xref_len(ctx_, doc_);
+        part_.assign(xrefLen_, PART_NONE);
+        barrier_.assign(xrefLen_, 0);
+        owner_.assign(xrefLen_, -1);
+        mark_.assign(xrefLen_, 0);
+        sharedId_.assign(xrefLen_, -1);
+
+        pdf_obj* trailer = pdf_trailer(ctx_, doc_);
+        catalog_ = pdf_dict_get(ctx_, trailer, PDF_NAME(Root));
+        encrypt_ = pdf_dict_get(ctx_, trailer, PDF_NAME(Encrypt));
+        if (!pdf_is_indirect(ctx_, catalog_) || pdf_to_num(ctx_, catalog_) >= xrefLen_)
+            fz_throw(ctx_, FZ_ERROR_FORMAT, "document has no catalog");
+        if (crypt_ && !pdf_crypt_encrypt_metadata(ctx_, crypt_))
+            fz_throw(ctx_, FZ_ERROR_UNSUPPORTED, "cannot linearize with unencrypted metadata");
+
+        pageCount_ = pdf_count_pages(ctx_, doc_);
+        if (pageCount_ <= 0) fz_throw(ctx_, FZ_ERROR_FORMAT, "document has no pages");
+        pageObjs_.assign(pageCount_, nullptr);
+        pageNums_.assign(pageCount_, 0);
+        mark_barriers();
+        localise_page_attributes();
+
+        // Part 6: page 1 and everything it reaches.
+        walk_page(0);
+        take_walk(first_, PART_FIRST);
+
+        // Which other pages use each object.
+        pageUses_.resize(pageCount_);
+        for (int i = 1; i < pageCount_; ++i) {
+            walk_page(i);
+            pageUses_[i] = reached_;
+            for (int num : reached_) {
+                if (part_[num] != PART_NONE) continue;
+                if (owner_[num] == -1) owner_[num] = i;
+                else if (owner_[num] != i) owner_[num] = -2;
+            }
+        }
+
+        // Part 7: each page object followed by what only that page uses.
+        pageStart_.assign(pageCount_, 0);
+        pageObjects_.assign(pageCount_, 0);
+        pageObjects_[0] = (int)first_.size();
+        for (int i = 1; i < pageCount_; ++i) {
+            pageStart_[i] = pages_.size();
+            for (int num : pageUses_[i]) {
+                if (part_[num] != PART_NONE || owner_[num] != i) continue;
+                part_[num] = PART_PAGES;
+                pages_.push_back(num);
+            }
+            pageObjects_[i] = (int)(pages_.size() - pageStart_[i]);
+        }
+
+        // Part 8, in the order the pages first use them.
+        for (int i = 1; i < pageCount_; ++i) {
+            for (int num : pageUses_[i]) {
+                if (part_[num] != PART_NONE) continue;
+                part_[num] = PART_SHARED;
+                shared_.push_back(num);
+            }
+        }
+        for (size_t i = 0; i < first_.size(); ++i) sharedId_[first_[i]] = (int)i;
+        for (size_t i = 0; i < shared_.size(); ++i) sharedId_[shared_[i]] = (int)(first_.size() + i);
+
+        // Part 4: the catalog, the encryption dictionary and what a viewer
+        // reads before showing page 1.
+        int catalogNum = pdf_to_num(ctx_, catalog_);
+        part_[catalogNum] = PART_OPEN;
+        open_.push_back(catalogNum);
+        if (pdf_is_indirect(ctx_, encrypt_) && pdf_to_num(ctx_, encrypt_) < xrefLen_) {
+            part_[pdf_to_num(ctx_, encrypt_)] = PART_OPEN;
+            open_.push_back(pdf_to_num(ctx_, encrypt_));
+        }
+        pdf_obj* opening[] = {
+            pdf_dict_gets(ctx_, catalog_, "ViewerPreferences"),
+            pdf_dict_gets(ctx_, catalog_, "OpenAction"),
+        };
+        for (pdf_obj* obj : opening) {
+            if (!obj) continue;
+            walk(obj, PART_BIT(PART_NONE), PAGE_BARRIERS);
+            take_walk(open_, PART_OPEN);
+        }
+
+        // Part 9: whatever else the catalog and the document info reach,
+        // the page tree among it.
+        walk(catalog_, PART_BIT(PART_NONE) | PART_BIT(PART_OPEN), BARRIER_ENCRYPT);
+        take_walk(other_, PART_OTHER);
+        pdf_obj* info = pdf_dict_get(ctx_, trailer, PDF_NAME(Info));
+        if (pdf_is_indirect(ctx_, info)) {
+            walk(info, PART_BIT(PART_NONE), BARRIER_ENCRYPT);
+            take_walk(other_, PART_OTHER);
+        }
+
+        order_.insert(order_.end(), open_.begin(), open_.end());
+        firstIndex_ = order_.size();
+        order_.insert(order_.end(), first_.begin(), first_.end());
+        pagesIndex_ = order_.size();
+        order_.insert(order_.end(), pages_.begin(), pages_.end());
+        sharedIndex_ = order_.size();
+        order_.insert(order_.end(), shared_.begin(), shared_.end());
+        otherIndex_ = order_.size();
+        order_.insert(order_.end(), other_.begin(), other_.end());
+
+        pageStart_[0] = firstIndex_;
+        for (int i = 1; i < pageCount_; ++i) pageStart_[i] += pagesIndex_;
+    }
+
+    // The main section (parts 7-9) is numbered 1..N-1, so page 2 is object
+    // 1 and each page's objects follow the one before, as readers assume
+    // when locating pages through the hint table. The first-page section
+    // (linearization dictionary, part 4, hint stream, part 6) follows.
+    void number() {
+        target_.assign(xrefLen_, 0);
+        int next = 1;
+        for (size_t i = pagesIndex_; i < order_.size(); ++i) target_[order_[i]] = next++;
+        linNum_ = next++;
+        for (size_t i = 0; i < firstIndex_; ++i) target_[order_[i]] = next++;
+        hintNum_ = next++;
+        for (size_t i = firstIndex_; i < pagesIndex_; ++i) target_[order_[i]] = next++;
+        total_ = next;
+    }
+
+    // --- Serializing ---
+
+    int new_num(pdf_obj* ref) const {
+        int num = pdf_to_num(ctx_, ref);
+        return num > 0 && num < xrefLen_ ? target_[num] : 0;
+    }
+
+    void print_leaf(fz_buffer* buf, pdf_obj* obj) {
+        char small[256];
+        size_t len = 0;
+        char* s = pdf_sprint_obj(ctx_, small, sizeof(small), &len, obj, 1, 0);
+        fz_try(ctx_) {
+            fz_append_data(ctx_, buf, s, len);
+        } fz_always(ctx_) {
+            if (s != small) fz_free(ctx_, s);
+        } fz_catch(ctx_) {
+            fz_rethrow(ctx_);
+        }
+    }
+
+    // References are renumbered, or become null when their object is not
+    // written. Strings are encrypted for object num unless num is 0. A
+    // non-negative streamLength replaces /Length.
+    void print_obj(fz_buffer* buf, pdf_obj* obj, int num, long long streamLength = -1) {
+        if (pdf_is_indirect(ctx_, obj)) {
+            int target = new_num(obj);
+            if (target) fz_append_printf(ctx_, buf, "%d 0 R", target);
+            else fz_append_string(ctx_, buf, "null");
+        } else if (pdf_is_array(ctx_, obj)) {
+            fz_append_byte(ctx_, buf, '[');
+            int n = pdf_array_len(ctx_, obj);
+            for (int i = 0; i < n; ++i) {
+                if (i) fz_append_byte(ctx_, buf, ' ');
+                print_obj(buf, pdf_array_get(ctx_, obj, i), num);
+            }
+            fz_append_byte(ctx_, buf, ']');
+        } else if (pdf_is_dict(ctx_, obj)) {
+            fz_append_string(ctx_, buf, "<<");
+            int n = pdf_dict_len(ctx_, obj);
+            for (int i = 0; i < n; ++i) {
+                pdf_obj* key = pdf_dict_get_key(ctx_, obj, i);
+                if (streamLength >= 0 && pdf_name_eq(ctx_, key, PDF_NAME(Length))) continue;
+                print_leaf(buf, key);
+                fz_append_byte(ctx_, buf, ' ');
+                print_obj(buf, pdf_dict_get_val(ctx_, obj, i), num);
+            }
+            if (streamLength >= 0) fz_append_printf(ctx_, buf, "/Length %lld", streamLength);
+            fz_append_string(ctx_, buf, ">>");
+        } else if (num && crypt_ && pdf_is_string(ctx_, obj)) {
+            fz_append_byte(ctx_, buf, '<');
+            pdf_encrypt_data(ctx_, crypt_, num, 0, append_hex, buf,
+                             (const unsigned char*)pdf_to_str_buf(ctx_, obj), pdf_to_str_len(ctx_, obj));
+            fz_append_byte(ctx_, buf, '>');
+        } else {
+            print_leaf(buf, obj);
+        }
+    }
+
+    void print_loaded(fz_buffer* buf, pdf_obj* obj, int num, long long streamLength) {
+        fz_try(ctx_) {
+            print_obj(buf, obj, num, streamLength);
+        } fz_always(ctx_) {
+            pdf_drop_obj(ctx_, obj);
+        } fz_catch(ctx_) {
+            fz_rethrow(ctx_);
+        }
+    }
+
+    long long stream_length(int num, int target) {
+        stream_ = pdf_load_raw_stream_number(ctx_, doc_, num);
+        size_t raw = fz_buffer_storage(ctx_, stream_, nullptr);
+        fz_drop_buffer(ctx_, stream_);
+        stream_ = nullptr;
+        return crypt_ ? (long long)pdf_encrypted_len(ctx_, crypt_, target, 0, raw) : (long long)raw;
+    }
+
+    void serialize() {
+        texts_.assign(order_.size(), nullptr);
+        streamLen_.assign(order_.size(), -1);
+        length_.assign(order_.size(), 0);
+        int encryptNum = pdf_is_indirect(ctx_, encrypt_) ? pdf_to_num(ctx_, encrypt_) : 0;
+
+        for (size_t i = 0; i < order_.size(); ++i) {
+            int num = order_[i];
+            int target = target_[num];
+            texts_[i] = fz_new_buffer(ctx_, 256);
+            fz_buffer* buf = texts_[i];
+            fz_append_printf(ctx_, buf, "%d 0 obj\n", target);
+
+            if (num == encryptNum) {
+                print_loaded(buf, pdf_load_unencrypted_object(ctx_, doc_, num), 0, -1);
+                fz_append_string(ctx_, buf, "\nendobj\n");
+            } else if (pdf_obj_num_is_stream(ctx_, doc_, num)) {
+                // Raw data keeps its filters; only the encryption changes.
+                streamLen_[i] = stream_length(num, target);
+                print_loaded(buf, pdf_load_object(ctx_, doc_, num), target, streamLen_[i]);
+                fz_append_string(ctx_, buf, "\nstream\n");
+            } else {
+                print_loaded(buf, pdf_load_object(ctx_, doc_, num), target, -1);
+                fz_append_string(ctx_, buf, "\nendobj\n");
+            }
+
+            length_[i] = (long long)fz_buffer_storage(ctx_, buf, nullptr);
+            if (streamLen_[i] >= 0) length_[i] += streamLen_[i] + (long long)strlen("\nendstream\nendobj\n");
+        }
+    }
+
+    // --- Layout ---
+
+    void print_lin_dict(fz_buffer* buf, long long fileLen, long long hintOffset, long long hintLen,
+                        long long firstPageEnd, long long mainXrefEntries) {
+        fz_append_printf(ctx_, buf,
+                         "%d 0 obj\n<</Linearized 1/L " LINEAR_OFFSET_FORMAT "/H[" LINEAR_OFFSET_FORMAT
+                         " " LINEAR_OFFSET_FORMAT "]/O %d/E " LINEAR_OFFSET_FORMAT "/N %d/T " LINEAR_OFFSET_FORMAT
+                         ">>\nendobj\n",
+                         linNum_, fileLen, hintOffset, hintLen, target_[pageNums_[0]], firstPageEnd, pageCount_,
+                         mainXrefEntries);
+    }
+
+    void print_first_trailer(fz_buffer* buf, long long mainXref) {
+        pdf_obj* trailer = pdf_trailer(ctx_, doc_);
+        fz_append_printf(ctx_, buf, "trailer\n<</Size %d/Root %d 0 R", total_, new_num(catalog_));
+        pdf_obj* info = pdf_dict_get(ctx_, trailer, PDF_NAME(Info));
+        if (pdf_is_indirect(ctx_, info) && new_num(info)) fz_append_printf(ctx_, buf, "/Info %d 0 R", new_num(info));
+        if (encrypt_) {
+            fz_append_string(ctx_, buf, "/Encrypt ");
+            print_obj(buf, encrypt_, 0);
+        }
+        pdf_obj* id = pdf_dict_get(ctx_, trailer, PDF_NAME(ID));
+        if (id) {
+            fz_append_string(ctx_, buf, "/ID");
+            print_obj(buf, id, 0);
+        }
+        fz_append_printf(ctx_, buf, "/Prev " LINEAR_OFFSET_FORMAT ">>\nstartxref\n0\n%%%%EOF\n", mainXref);
+    }
+
+    long long measure(bool linDict) {
+        fz_buffer* buf = fz_new_buffer(ctx_, 256);
+        long long len = 0;
+        fz_try(ctx_) {
+            if (linDict) print_lin_dict(buf, 0, 0, 0, 0, 0);
+            else print_first_trailer(buf, 0);
+            len = (long long)fz_buffer_storage(ctx_, buf, nullptr);
+        } fz_always(ctx_) {
+            fz_drop_buffer(ctx_, buf);
+        } fz_catch(ctx_) {
+            fz_rethrow(ctx_);
+        }
+        return len;
+    }
+
+    long long main_xref_len() const {
+        return (long long)snprintf(nullptr, 0, "xref\n0 %d\n", linNum_) + (long long)XREF_ENTRY_BYTES * linNum_ +
+               (long long)snprintf(nullptr, 0, "trailer\n<</Size %d>>\nstartxref\n%lld\n%%%%EOF\n", linNum_,
+                                   headerLen_ + linLen_);
+    }
+
+    // Hint table offsets leave the hint stream out: past it they are less
+    // its length (Annex F.4), which readers add back to offsets at or
+    // after the hint stream's own. A line break written after the hint
+    // stream, outside its length, keeps page 1 strictly past it, so
+    // readers comparing either way agree.
+    void layout() {
+        int version = std::max(pdf_version(ctx_, doc_), 14);
+        snprintf(header_, sizeof(header_), "%%PDF-%d.%d\n%%\xE2\xE3\xCF\xD3\n", version / 10, version % 10);
+        headerLen_ = (long long)strlen(header_);
+        linLen_ = measure(true);
+        firstXrefLen_ = (long long)snprintf(nullptr, 0, "xref\n%d %d\n", linNum_, total_ - linNum_) +
+                        (long long)XREF_ENTRY_BYTES * (total_ - linNum_);
+        firstTrailerLen_ = measure(false);
+
+        offset_.assign(order_.size(), 0);
+        long long pos = headerLen_ + linLen_ + firstXrefLen_ + firstTrailerLen_;
+        for (size_t i = 0; i < order_.size(); ++i) {
+            if (i == firstIndex_) {
+                hintOffset_ = pos;
+                pos += 1;
+            }
+            offset_[i] = pos;
+            pos += length_[i];
+            if (i + 1 == pagesIndex_) firstPageEnd_ = pos;
+        }
+
+        build_hints();
+
+        size_t hintDataLen = hintData_.size();
+        long long hintStreamLen = crypt_ ? (long long)pdf_encrypted_len(ctx_, crypt_, hintNum_, 0, hintDataLen)
+                                         : (long long)hintDataLen;
+        hint_ = fz_new_buffer(ctx_, hintDataLen + 128);
+        fz_append_printf(ctx_, hint_, "%d 0 obj\n<</Length %lld/S %lld>>\nstream\n", hintNum_, hintStreamLen,
+                         hintSharedOffset_);
+        if (crypt_) pdf_encrypt_data(ctx_, crypt_, hintNum_, 0, append_raw, hint_, hintData_.data(), hintDataLen);
+        else fz_append_data(ctx_, hint_, hintData_.data(), hintDataLen);
+        fz_append_string(ctx_, hint_, "\nendstream\nendobj\n");
+        hintLen_ = (long long)fz_buffer_storage(ctx_, hint_, nullptr);
+
+        firstPageEnd_ += hintLen_;
+        mainXref_ = pos + hintLen_;
+        fileLen_ = mainXref_ + main_xref_len();
+    }
+
+    long long page_length(int page) const {
+        size_t last = pageStart_[page] + pageObjects_[page] - 1;
+        return offset_[last] + length_[last] - offset_[pageStart_[page]];
+    }
+
+    bool is_shared(int num) const { return part_[num] == PART_FIRST || part_[num] == PART_SHARED; }
+
+    int shared_refs(int page) const {
+        if (page == 0) return 0;
+        int n = 0;
+        for (int num : pageUses_[page])
+            if (is_shared(num)) ++n;
+        return n;
+    }
+
+    void build_hints() {
+        BitWriter bits(hintData_);
+
+        long long leastObjects = pageObjects_[0], mostObjects = pageObjects_[0];
+        long long leastLength = page_length(0), mostLength = leastLength;
+        int mostShared = 0;
+        for (int i = 1; i < pageCount_; ++i) {
+            leastObjects = std::min(leastObjects, (long long)pageObjects_[i]);
+            mostObjects = std::max(mostObjects, (long long)pageObjects_[i]);
+            leastLength = std::min(leastLength, page_length(i));
+            mostLength = std::max(mostLength, page_length(i));
+            mostShared = std::max(mostShared, shared_refs(i));
+        }
+        long long entries = (long long)(first_.size() + shared_.size());
+        int objectBits = bits_for(mostObjects - leastObjects);
+        int lengthBits = bits_for(mostLength - leastLength);
+        int sharedBits = bits_for(mostShared);
+        int idBits = bits_for(entries - 1);
+
+        // Page offset hint table header (Table F.3). Content streams are
+        // not located on their own; their fields span the whole page.
+        bits.put(leastObjects, 32);
+        bits.put(offset_[firstIndex_], 32);
+        bits.put(objectBits, 16);
+        bits.put(leastLength, 32);
+        bits.put(lengthBits, 16);
+        bits.put(0, 32);
+        bits.put(0, 16);
+        bits.put(leastLength, 32);
+        bits.put(lengthBits, 16);
+        bits.put(sharedBits, 16);
+        bits.put(idBits, 16);
+        bits.put(0, 16);
+        bits.put(1, 16);
+
+        // Per-page entries (Table F.4), item by item across all pages.
+        // Items 5 and 6 take no bits.
+        for (int i = 0; i < pageCount_; ++i) bits.put(pageObjects_[i] - leastObjects, objectBits);
+        bits.flush();
+        for (int i = 0; i < pageCount_; ++i) bits.put(page_length(i) - leastLength, lengthBits);
+        bits.flush();
+        for (int i = 0; i < pageCount_; ++i) bits.put(shared_refs(i), sharedBits);
+        bits.flush();
+        for (int i = 1; i < pageCount_; ++i) {
+            for (int num : pageUses_[i])
+                if (is_shared(num)) bits.put(sharedId_[num], idBits);
+        }
+        bits.flush();
+        for (int i = 0; i < pageCount_; ++i) bits.put(page_length(i) - leastLength, lengthBits);
+        bits.flush();
+
+        // Shared object hint table (Tables F.5 and F.6), one object per
+        // group: page 1's objects, then part 8.
+        hintSharedOffset_ = (long long)hintData_.size();
+        long long leastGroup = length_[firstIndex_], mostGroup = leastGroup;
+        for (size_t i = firstIndex_; i < otherIndex_; ++i) {
+            if (i >= pagesIndex_ && i < sharedIndex_) continue;
+            leastGroup = std::min(leastGroup, length_[i]);
+            mostGroup = std::max(mostGroup, length_[i]);
+        }
+        int groupBits = bits_for(mostGroup - leastGroup);
+        bool anyShared = otherIndex_ > sharedIndex_;
+
+        bits.put(anyShared ? target_[order_[sharedIndex_]] : 0, 32);
+        bits.put(anyShared ? offset_[sharedIndex_] : 0, 32);
+        bits.put((long long)first_.size(), 32);
+        bits.put(entries, 32);
+        bits.put(0, 16);
+        bits.put(leastGroup, 32);
+        bits.put(groupBits, 16);
+        for (size_t i = firstIndex_; i < pagesIndex_; ++i) bits.put(length_[i] - leastGroup, groupBits);
+        for (size_t i = sharedIndex_; i < otherIndex_; ++i) bits.put(length_[i] - leastGroup, groupBits);
+        bits.flush();
+        // No MD5 signatures.
+        for (long long i = 0; i < entries; ++i) bits.put(0, 1);
+        bits.flush();
+    }
+
+    // --- Writing ---
+
+    long long real_offset(size_t index) const { return offset_[index] + (index >= firstIndex_ ? hintLen_ : 0); }
+
+    void write_xref_entry(fz_output* out, long long offset) {
+        fz_write_printf(ctx_, out, "%010lld 00000 n \n", offset);
+    }
+
+    void write_object(fz_output* out, size_t index) {
+        fz_write_buffer(ctx_, out, texts_[index]);
+        if (streamLen_[index] < 0) return;
+
+        int num = order_[index];
+        stream_ = pdf_load_raw_stream_number(ctx_, doc_, num);
+        unsigned char* data = nullptr;
+        size_t raw = fz_buffer_storage(ctx_, stream_, &data);
+        long long len = crypt_ ? (long long)pdf_encrypted_len(ctx_, crypt_, target_[num], 0, raw) : (long long)raw;
+        if (len != streamLen_[index])
+            fz_throw(ctx_, FZ_ERROR_FORMAT, "stream %d changed length while linearizing", num);
+        if (crypt_) pdf_encrypt_data(ctx_, crypt_, target_[num], 0, write_raw, out, data, raw);
+        else fz_write_data(ctx_, out, data, raw);
+        fz_drop_buffer(ctx_, stream_);
+        stream_ = nullptr;
+        fz_write_string(ctx_, out, "\nendstream\nendobj\n");
+    }
+
+    void emit(fz_output* out) {
+        int64_t start = fz_tell_output(ctx_, out);
+        // /T is the line break before the first main xref entry.
+        long long mainFirstEntry = mainXref_ + (long long)snprintf(nullptr, 0, "xref\n0 %d", linNum_);
+
+        fz_write_string(ctx_, out, header_);
+        fz_buffer* buf = fz_new_buffer(ctx_, 1024);
+        fz_try(ctx_) {
+            print_lin_dict(buf, fileLen_, hintOffset_, hintLen_, firstPageEnd_, mainFirstEntry);
+            fz_write_buffer(ctx_, out, buf);
+            fz_clear_buffer(ctx_, buf);
+
+            fz_write_printf(ctx_, out, "xref\n%d %d\n", linNum_, total_ - linNum_);
+            write_xref_entry(out, headerLen_);
+            for (size_t i = 0; i < firstIndex_; ++i) write_xref_entry(out, real_offset(i));
+            write_xref_entry(out, hintOffset_);
+            for (size_t i = firstIndex_; i < pagesIndex_; ++i) write_xref_entry(out, real_offset(i));
+
+            print_first_trailer(buf, mainXref_);
+            fz_write_buffer(ctx_, out, buf);
+        } fz_always(ctx_) {
+            fz_drop_buffer(ctx_, buf);
+        } fz_catch(ctx_) {
+            fz_rethrow(ctx_);
+        }
+
+        for (size_t i = 0; i < order_.size(); ++i) {
+            if (i == firstIndex_) {
+                fz_write_buffer(ctx_, out, hint_);
+                fz_write_byte(ctx_, out, '\n');
+            }
+            write_object(out, i);
+        }
+
+        fz_write_printf(ctx_, out, "xref\n0 %d\n0000000000 65535 f \n", linNum_);
+        for (size_t i = pagesIndex_; i < order_.size(); ++i) write_xref_entry(out, real_offset(i));
+        fz_write_printf(ctx_, out, "trailer\n<</Size %d>>\nstartxref\n%lld\n%%%%EOF\n", linNum_, headerLen_ + linLen_);
+
+        long long written = (long long)(fz_tell_output(ctx_, out) - start);
+        if (written != fileLen_)
+            fz_throw(ctx_, FZ_ERROR_FORMAT, "linearized file is %lld bytes, laid out as %lld", written, fileLen_);
+        LOGI("Linearized %d pages, %d objects: page 1 complete at %lld of %lld bytes", pageCount_,
+             (int)order_.size(), firstPageEnd_, fileLen_);
+    }
+};
+
+void write_linearized(fz_context* ctx, pdf_document* doc, fz_output* out) {
+    // On the heap: a throw longjmps past this frame without running
+    // destructors, so only fz_always can free what the passes built.
+    Linearizer* linearizer = new Linearizer(ctx, doc);
+    fz_try(ctx) {
+        linearizer->write(out);
+    } fz_always(ctx) {
+        delete linearizer;
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// --- VERIFIER ---
+
+class LinearizationCheck {
+public:
+    explicit LinearizationCheck(fz_context* ctx) : ctx_(ctx) {}
+
+    ~LinearizationCheck() {
+        pdf_drop_obj(ctx_, linDict_);
+        pdf_drop_obj(ctx_, hintDict_);
+        fz_drop_buffer(ctx_, hintData_);
+    }
+
+    void run(pdf_document* doc) {
+        doc_ = doc;
+        fz_seek(ctx_, doc->file, 0, SEEK_END);
+        fileLen_ = fz_tell(ctx_, doc->file);
+        collect_offsets();
+        if (!find_lin_dict()) return;
+        check_lin_dict();
+        if (pdf_needs_password(ctx_, doc_)) {
+            warning("encrypted; hint tables not checked");
+            return;
+        }
+        if (load_hints()) {
+            check_page_table();
+            check_shared_table();
+        }
+    }
+
+    void error(const char* fmt, ...) {
+        char msg[256];
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(msg, sizeof(msg), fmt, args);
+        va_end(args);
+        errors_.push_back(msg);
+    }
+
+    void warning(const char* fmt, ...) {
+        char msg[256];
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(msg, sizeof(msg), fmt, args);
+        va_end(args);
+        warnings_.push_back(msg);
+    }
+
+    std::string json() const {
+        char buf[320];
+        snprintf(buf, sizeof(buf),
+                 "{\"linearized\":%s,\"valid\":%s,\"pages\":%d,\"fileLength\":%lld,\"firstPageEnd\":%lld,"
+                 "\"hintOffset\":%lld,\"hintLength\":%lld,\"sharedObjects\":%lld,\"errors\":[",
+                 linearized_ ? "true" : "false", linearized_ && errors_.empty() ? "true" : "false", pages_,
+                 fileLen_, firstPageEnd_, hintOffset_, hintLen_, sharedEntries_);
+        std::string out = buf;
+        for (size_t i = 0; i < errors_.size(); ++i) {
+            if (i) out += ",";
+            append_json_string(out, errors_[i]);
+        }
+        out += "],\"warnings\":[";
+        for (size_t i = 0; i < warnings_.size(); ++i) {
+            if (i) out += ",";
+            append_json_string(out, warnings_[i]);
+        }
+        return out + "]}";
+    }
+
+private:
+    struct Located {
+        long long offset;
+        int num;
+        bool operator<(const Located& other) const { return offset < other.offset; }
+    };
+
+    fz_context* ctx_;
+    pdf_document* doc_ = nullptr;
+    pdf_obj* linDict_ = nullptr;
+    pdf_obj* hintDict_ = nullptr;
+    fz_buffer* hintData_ = nullptr;
+    std::vector<Located> objects_;  // uncompressed objects by offset
+    std::vector<std::string> errors_, warnings_;
+    bool linearized_ = false;
+    int pages_ = 0;
+    long long fileLen_ = 0, firstPageEnd_ = 0, hintOffset_ = 0, hintLen_ = 0, sharedEntries_ = 0;
+
+    // Page offset table, by page.
+    std::vector<long long> pageObjects_, pageStart_, pageLength_, pageShared_;
+    long long sharedOffset_ = 0;
+
+    void collect_offsets() {
+        int n = pdf_xref_len(ctx_, doc_);
+        for (int i = 1; i < n; ++i) {
+            pdf_xref_entry* entry = pdf_get_xref_entry_no_null(ctx_, doc_, i);
+            if (entry->type == 'n') objects_.push_back({(long long)entry->ofs, i});
+        }
+        std::sort(objects_.begin(), objects_.end());
+    }
+
+    // Object number at offset, 0 when no object starts there.
+    int object_at(long long offset) const {
+        auto it = std::lower_bound(objects_.begin(), objects_.end(), Located{offset, 0});
+        return it != objects_.end() && it->offset == offset ? it->num : 0;
+    }
+
+    long long objects_between(long long from, long long to) const {
+        auto a = std::lower_bound(objects_.begin(), objects_.end(), Located{from, 0});
+        auto b = std::lower_bound(objects_.begin(), objects_.end(), Located{to, 0});
+        return (long long)(b - a);
+    }
+
+    // -1 for objects in object streams.
+    long long offset_of(int num) const {
+        pdf_xref_entry* entry = pdf_get_xref_entry_no_null(ctx_, doc_, num);
+        return entry->type == 'n' ? (long long)entry->ofs : -1;
+    }
+
+    // Hint table offsets leave the hint stream out.
+    long long adjust(long long offset) const { return offset >= hintOffset_ ? offset + hintLen_ : offset; }
+
+    bool find_lin_dict() {
+        if (objects_.empty() || objects_[0].offset > 1024) return false;
+        linDict_ = pdf_load_object(ctx_, doc_, objects_[0].num);
+        if (!pdf_dict_get(ctx_, linDict_, PDF_NAME(Linearized))) return false;
+        linearized_ = true;
+        return true;
+    }
+
+    void check_lin_dict() {
+        long long declared = pdf_dict_get_int64(ctx_, linDict_, PDF_NAME(L));
+        if (declared != fileLen_)
+            error("/L is %lld but the file has %lld bytes (updated after linearizing?)", declared, fileLen_);
+
+        pages_ = pdf_dict_get_int(ctx_, linDict_, PDF_NAME(N));
+        int pageCount = pdf_count_pages(ctx_, doc_);
+        if (pages_ != pageCount) error("/N is %d but the document has %d pages", pages_, pageCount);
+        if (pageCount <= 0) return;
+
+        int first = pdf_dict_get_int(ctx_, linDict_, PDF_NAME(O));
+        int page1 = pdf_to_num(ctx_, pdf_lookup_page_obj(ctx_, doc_, 0));
+        if (first != page1) error("/O is %d but page 1 is object %d", first, page1);
+
+        firstPageEnd_ = pdf_dict_get_int64(ctx_, linDict_, PDF_NAME(E));
+        pdf_obj* hints = pdf_dict_get(ctx_, linDict_, PDF_NAME(H));
+        hintOffset_ = pdf_array_get_int(ctx_, hints, 0);
+        hintLen_ = pdf_array_get_int(ctx_, hints, 1);
+        if (doc_->startxref >= firstPageEnd_)
+            error("startxref %lld is past /E, not the first-page xref", (long long)doc_->startxref);
+
+        long long mainXref = pdf_dict_get_int64(ctx_, linDict_, PDF_NAME(T));
+        unsigned char before[32];
+        long long from = std::max(0LL, mainXref - (long long)sizeof(before));
+        fz_seek(ctx_, doc_->file, from, SEEK_SET);
+        size_t got = fz_read(ctx_, doc_->file, before, (size_t)(mainXref - from));
+        bool found = false;
+        for (size_t i = 0; i + 4 <= got && !found; ++i) found = memcmp(before + i, "xref", 4) == 0;
+        if (!found && !object_at(mainXref)) error("/T %lld is not in the main xref", mainXref);
+    }
+
+    bool load_hints() {
+        int hintNum = object_at(hintOffset_);
+        if (!hintNum) {
+            error("no object at hint stream offset %lld", hintOffset_);
+            return false;
+        }
+        auto next = std::upper_bound(objects_.begin(), objects_.end(), Located{hintOffset_, 0});
+        if (next != objects_.end() && next->offset < hintOffset_ + hintLen_)
+            error("hint stream length %lld overlaps object %d", hintLen_, next->num);
+
+        hintDict_ = pdf_load_object(ctx_, doc_, hintNum);
+        sharedOffset_ = pdf_dict_get_int64(ctx_, hintDict_, PDF_NAME(S));
+        hintData_ = pdf_load_stream_number(ctx_, doc_, hintNum);
+        return true;
+    }
+
+    void check_page_table() {
+        unsigned char* data = nullptr;
+        size_t len = fz_buffer_storage(ctx_, hintData_, &data);
+        BitReader bits(data, len, 0);
+
+        long long leastObjects = bits.get(32);
+        long long firstPage = bits.get(32);
+        int objectBits = (int)bits.get(16);
+        long long leastLength = bits.get(32);
+        int lengthBits = (int)bits.get(16);
+        bits.get(32);
+        int contentOffsetBits = (int)bits.get(16);
+        bits.get(32);
+        int contentLengthBits = (int)bits.get(16);
+        int sharedBits = (int)bits.get(16);
+        int idBits = (int)bits.get(16);
+        int numeratorBits = (int)bits.get(16);
+        bits.get(16);
+
+        int pages = pdf_count_pages(ctx_, doc_);
+        pageObjects_.assign(pages, 0);
+        pageLength_.assign(pages, 0);
+        pageShared_.assign(pages, 0);
+        pageStart_.assign(pages, 0);
+        for (int i = 0; i < pages; ++i) pageObjects_[i] = leastObjects + bits.get(objectBits);
+        bits.align();
+        for (int i = 0; i < pages; ++i) pageLength_[i] = leastLength + bits.get(lengthBits);
+        bits.align();
+        for (int i = 0; i < pages; ++i) pageShared_[i] = bits.get(sharedBits);
+        bits.align();
+        long long maxId = 0;
+        for (int i = 0; i < pages; ++i)
+            for (long long j = 0; j < pageShared_[i]; ++j) maxId = std::max(maxId, bits.get(idBits));
+        bits.align();
+        for (int i = 0; i < pages; ++i)
+            for (long long j = 0; j < pageShared_[i]; ++j) bits.get(numeratorBits);
+        bits.align();
+        for (int i = 0; i < pages; ++i) bits.get(contentOffsetBits);
+        bits.align();
+        for (int i = 0; i < pages; ++i) bits.get(contentLengthBits);
+        if (bits.overrun) {
+            error("page offset hint table is truncated");
+            return;
+        }
+        if (bits.bit / 8 > (size_t)sharedOffset_) error("page offset hint table runs into the shared table");
+
+        long long expectNum = 1;
+        for (int i = 0; i < pages; ++i) {
+            pageStart_[i] = i == 0 ? adjust(firstPage) : pageStart_[i - 1] + pageLength_[i - 1];
+            long long end = pageStart_[i] + pageLength_[i];
+            int num = pdf_to_num(ctx_, pdf_lookup_page_obj(ctx_, doc_, i));
+            long long offset = offset_of(num);
+
+            if (offset < 0) error("page %d is object %d, which is compressed", i + 1, num);
+            else if (i == 0 && offset != pageStart_[0])
+                error("page 1 object is at %lld, hint table says %lld", offset, pageStart_[0]);
+            else if (offset < pageStart_[i] || offset >= end)
+                error("page %d object at %lld lies outside its range %lld-%lld", i + 1, offset, pageStart_[i], end);
+
+            long long count = objects_between(pageStart_[i], end);
+            if (count != pageObjects_[i])
+                error("page %d has %lld objects, hint table says %lld", i + 1, count, pageObjects_[i]);
+
+            if (i > 0 && num != expectNum)
+                warning("page %d is object %d; readers numbering pages from the hint table expect %lld",
+                        i + 1, num, expectNum);
+            if (i > 0) expectNum += pageObjects_[i];
+        }
+        if (pages > 0 && pageStart_[0] + pageLength_[0] != firstPageEnd_)
+            error("page 1 ends at %lld, /E is %lld", pageStart_[0] + pageLength_[0], firstPageEnd_);
+        sharedEntries_ = maxId + 1;
+    }
+
+    void check_shared_table() {
+        unsigned char* data = nullptr;
+        size_t len = fz_buffer_storage(ctx_, hintData_, &data);
+        if (sharedOffset_ <= 0 || (size_t)sharedOffset_ >= len) {
+            error("shared object hint table offset %lld is outside the hint stream", sharedOffset_);
+            return;
+        }
+        BitReader bits(data, len, (size_t)sharedOffset_);
+
+        long long firstNum = bits.get(32);
+        long long firstOffset = adjust(bits.get(32));
+        long long firstPageEntries = bits.get(32);
+        long long entries = bits.get(32);
+        int groupBits = (int)bits.get(16);
+        long long leastLength = bits.get(32);
+        int lengthBits = (int)bits.get(16);
+        if (bits.overrun || firstPageEntries > entries) {
+            error("shared object hint table header is malformed");
+            return;
+        }
+        if (sharedEntries_ > entries)
+            error("pages refer to shared object %lld of %lld", sharedEntries_ - 1, entries);
+        sharedEntries_ = entries;
+        if (groupBits) warning("shared objects are grouped; only group starts are checked");
+
+        long long pos = pageStart_.empty() ? 0 : pageStart_[0];
+        for (long long i = 0; i < entries; ++i) {
+            long long length = leastLength + bits.get(lengthBits);
+            if (bits.overrun) {
+                error("shared object hint table is truncated");
+                return;
+            }
+            if (i == firstPageEntries) {
+                pos = firstOffset;
+                int num = object_at(pos);
+                if (num != firstNum)
+                    error("first shared object is %lld, but object %d is at %lld", firstNum, num, pos);
+            }
+            if (!object_at(pos)) error("shared object %lld at %lld is not an object", i, pos);
+            pos += length;
+        }
+    }
+};
+
+std::string verify_linearization(fz_context* ctx, const char* path) {
+    LinearizationCheck check(ctx);
+    pdf_document* doc = nullptr;
+
+    fz_var(doc);
+    fz_try(ctx) {
+        doc = open_pdf_document(ctx, path, InputAccess::RANDOM);
+        check.run(doc);
+    } fz_always(ctx) {
+        pdf_drop_document(ctx, doc);
+    } fz_catch(ctx) {
+        check.error("%s", fz_caught_message(ctx));
+    }
+    return check.json();
+}
+
+// --- BENCHMARK ---
+
+// Bytes a read may need beyond what it stopped at before it can go on;
+// the simulated download jumps ahead by at least this much.
+#define TRICKLE_STEP (16 * 1024)
+#define TRICKLE_BUFFER (16 * 1024)
+// Rate used when the caller gives none: a slow mobile connection.
+#define TRICKLE_DEFAULT_RATE (256 * 1024)
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A file arriving at bytesPerSecond. Reads past what has arrived throw
+// FZ_ERROR_TRYLATER, as they would on a progressive download. Instead of
+// sleeping, the reader skips the wait: the time until the bytes it
+// stopped at arrive is added to skippedMs, which counts as elapsed.
+struct TrickleStream {
+    int fd;
+    int64_t fileSize;
+    int64_t bytesPerSecond;
+    std::chrono::steady_clock::time_point start;
+    double skippedMs;
+    int64_t wanted;
+    unsigned char buffer[TRICKLE_BUFFER];
+};
+
+static double trickle_elapsed_ms(TrickleStream* state) { return elapsed_ms(state->start) + state->skippedMs; }
+
+static int64_t trickle_arrived(TrickleStream* state) {
+    double bytes = trickle_elapsed_ms(state) * (double)state->bytesPerSecond / 1000.0;
+    return bytes >= (double)state->fileSize ? state->fileSize : (int64_t)bytes;
+}
+
+static int next_trickle(fz_context* ctx, fz_stream* stm, size_t max) {
+    TrickleStream* state = (TrickleStream*)stm->state;
+    int64_t pos = stm->pos;
+    if (pos >= state->fileSize) return EOF;
+
+    int64_t arrived = trickle_arrived(state);
+    if (pos >= arrived) {
+        state->wanted = pos;
+        fz_throw(ctx, FZ_ERROR_TRYLATER, "byte %lld has not arrived", (long long)pos);
+    }
+
+    size_t want = (size_t)fz_mini((int64_t)TRICKLE_BUFFER, arrived - pos);
+    ssize_t got;
+    do {
+        got = pread(state->fd, state->buffer, want, (off_t)pos);
+    } while (got < 0 && errno == EINTR);
+    if (got < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "pread failed: %s", strerror(errno));
+
+    stm->rp = state->buffer;
+    stm->wp = state->buffer + got;
+    stm->pos += (int64_t)got;
+    if (got == 0) return EOF;
+    return *stm->rp++;
+}
+
+// The length is known up front, as from Content-Length.
+static void seek_trickle(fz_context* ctx, fz_stream* stm, int64_t offset, int whence) {
+    TrickleStream* state = (TrickleStream*)stm->state;
+    int64_t pos;
+    switch (whence) {
+        case SEEK_END: pos = state->fileSize + offset; break;
+        case SEEK_CUR: pos = stm->pos - (stm->wp - stm->rp) + offset; break;
+        default: pos = offset; break;
+    }
+    if (pos < 0 || pos > state->fileSize) fz_throw(ctx, FZ_ERROR_ARGUMENT, "cannot seek to %lld", (long long)pos);
+
+    stm->pos = pos;
+    stm->rp = stm->wp = state->buffer;
+}
+
+static void drop_trickle(fz_context* ctx, void* opaque) {
+    TrickleStream* state = (TrickleStream*)opaque;
+    close(state->fd);
+    fz_free(ctx, state);
+}
+
+static fz_stream* open_trickle_stream(fz_context* ctx, const char* path, int bytesPerSecond) {
+    int fd = open_source_fd(path);
+    if (fd < 0) fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot open %s: %s", path, strerror(errno));
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot stat %s: %s", path, strerror(errno));
+    }
+
+    TrickleStream* state = nullptr;
+    fz_try(ctx) {
+        state = fz_malloc_struct(ctx, TrickleStream);
+    } fz_catch(ctx) {
+        close(fd);
+        fz_rethrow(ctx);
+    }
+    state->fd = fd;
+    state->fileSize = (int64_t)st.st_size;
+    state->bytesPerSecond = bytesPerSecond;
+    state->start = std::chrono::steady_clock::now();
+
+    fz_stream* stm = fz_new_stream(ctx, state, next_trickle, drop_trickle);
+    stm->seek = seek_trickle;
+    stm->progressive = 1;
+    return stm;
+}
+
+struct FirstPageTiming {
+    double firstPageMs = -1;  // simulated: work plus waiting for bytes
+    long long bytesArrived = 0;
+    int retries = 0;
+};
+
+// Skip ahead to when the byte the last read stopped at, and a step
+// beyond, have arrived. False once the whole file is there.
+static bool wait_for_more(TrickleStream* state) {
+    if (trickle_arrived(state) >= state->fileSize) return false;
+    double due = (double)(state->wanted + TRICKLE_STEP) * 1000.0 / (double)state->bytesPerSecond;
+    double now = trickle_elapsed_ms(state);
+    if (due > now) state->skippedMs += due - now;
+    return true;
+}
+
+// Open the document and render page 1 at 72 DPI, retrying whatever
+// could not be read yet until it can.
+static void time_first_page(fz_context* ctx, const char* path, int bytesPerSecond, FirstPageTiming& timing) {
+    fz_stream* stm = open_trickle_stream(ctx, path, bytesPerSecond);
+    TrickleStream* state = (TrickleStream*)stm->state;
+    pdf_document* doc = nullptr;
+    fz_page* page = nullptr;
+    fz_pixmap* pix = nullptr;
+    fz_device* dev = nullptr;
+    bool done = false;
+
+    fz_var(doc);
+    fz_var(page);
+    fz_var(pix);
+    fz_var(dev);
+    fz_var(done);
+    fz_try(ctx) {
+        while (!done) {
+            fz_cookie cookie;
+            memset(&cookie, 0, sizeof(cookie));
+            fz_try(ctx) {
+                if (!doc) doc = pdf_open_document_with_stream(ctx, stm);
+                if (!page) page = fz_load_page(ctx, (fz_document*)doc, 0);
+                fz_irect box = fz_round_rect(fz_bound_page(ctx, page));
+                pix = fz_new_pixmap_with_bbox(ctx, fz_device_rgb(ctx), box, nullptr, 0);
+                fz_clear_pixmap_with_value(ctx, pix, 255);
+                dev = fz_new_draw_device(ctx, fz_identity, pix);
+                fz_run_page(ctx, page, dev, fz_identity, &cookie);
+                fz_close_device(ctx, dev);
+                done = !cookie.incomplete;
+            } fz_always(ctx) {
+                fz_drop_device(ctx, dev);
+                dev = nullptr;
+                fz_drop_pixmap(ctx, pix);
+                pix = nullptr;
+            } fz_catch(ctx) {
+                if (fz_caught(ctx) != FZ_ERROR_TRYLATER) fz_rethrow(ctx);
+                fz_ignore_error(ctx);
+            }
+            if (done) break;
+
+            timing.retries++;
+            if (!wait_for_more(state)) fz_throw(ctx, FZ_ERROR_FORMAT, "page 1 incomplete with the whole file read");
+        }
+        timing.firstPageMs = trickle_elapsed_ms(state);
+        timing.bytesArrived = (long long)trickle_arrived(state);
+    } fz_always(ctx) {
+        fz_drop_page(ctx, page);
+        pdf_drop_document(ctx, doc);
+        fz_drop_stream(ctx, stm);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+static std::string timing_json(const char* name, const FirstPageTiming& timing, long long bytes,
+                               int bytesPerSecond) {
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "\"%s\":{\"bytes\":%lld,\"firstPageMs\":%.2f,\"bytesArrived\":%lld,\"retries\":%d,"
+             "\"fullArrivalMs\":%.2f}",
+             name, bytes, timing.firstPageMs, timing.bytesArrived, timing.retries,
+             (double)bytes * 1000.0 / bytesPerSecond);
+    return buf;
+}
+
+static long long file_bytes(const char* path) {
+    int fd = open_source_fd(path);
+    if (fd < 0) return -1;
+    struct stat st;
+    long long bytes = fstat(fd, &st) == 0 ? (long long)st.st_size : -1;
+    close(fd);
+    return bytes;
+}
+
+std::string benchmark_first_page(fz_context* ctx, const char* path, const std::string& dir, int bytesPerSecond) {
+    if (bytesPerSecond <= 0) bytesPerSecond = TRICKLE_DEFAULT_RATE;
+    std::string copyPath = dir + "/linearize_bench.pdf";
+    FirstPageTiming original, linear;
+    bool haveCopy = false;
+    pdf_document* doc = nullptr;
+    fz_output* out = nullptr;
+
+    fz_var(haveCopy);
+    fz_var(doc);
+    fz_var(out);
+    fz_try(ctx) {
+        doc = open_pdf_document(ctx, path, InputAccess::SEQUENTIAL);
+        if (pdf_needs_password(ctx, doc)) fz_throw(ctx, FZ_ERROR_ARGUMENT, "password required");
+        out = open_destination(ctx, copyPath.c_str());
+        write_linearized(ctx, doc, out);
+        fz_close_output(ctx, out);
+        haveCopy = true;
+    } fz_always(ctx) {
+        fz_drop_output(ctx, out);
+        pdf_drop_document(ctx, doc);
+    } fz_catch(ctx) {
+        LOGI("First page benchmark: cannot linearize %s: %s", path, fz_caught_message(ctx));
+        remove(copyPath.c_str());
+    }
+
+    fz_try(ctx) {
+        time_first_page(ctx, path, bytesPerSecond, original);
+    } fz_catch(ctx) {
+        LOGI("First page benchmark (original) failed: %s", fz_caught_message(ctx));
+    }
+    if (haveCopy) {
+        fz_try(ctx) {
+            time_first_page(ctx, copyPath.c_str(), bytesPerSecond, linear);
+        } fz_catch(ctx) {
+            LOGI("First page benchmark (linearized) failed: %s", fz_caught_message(ctx));
+        }
+    }
+
+    std::string json = "{\"bytesPerSecond\":" + std::to_string(bytesPerSecond) + ",";
+    json += timing_json("original", original, file_bytes(path), bytesPerSecond);
+    if (haveCopy) {
+        json += "," + timing_json("linearized", linear, file_bytes(copyPath.c_str()), bytesPerSecond);
+        json += ",\"verify\":" + verify_linearization(ctx, copyPath.c_str());
+        remove(copyPath.c_str());
+    }
+    LOGI("First page at %d B/s: original %.2f ms, linearized %.2f ms", bytesPerSecond, original.firstPageMs,
+         linear.firstPageMs);
+    return json + "}";
+}
@@ -0,0 +1,43 @@
+#ifndef BLUEPDF_PDF_LINEARIZER_H
+#define BLUEPDF_PDF_LINEARIZER_H
+
+#include <string>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+    #include "mupdf/pdf.h"
+}
+
+// Write doc to out as a linearized ("Fast Web View") PDF, laid out as in
+// ISO 32000 Annex F: the linearization dictionary and first-page xref,
+// the catalog, the hint stream, every object page 1 needs, then each
+// further page with the objects only it uses, objects shared between
+// pages and finally everything else. A reader streaming the file can
+// show page 1 once /E bytes have arrived, and find any other page
+// through the hint tables without the main xref at the end.
+//
+// MuPDF stopped writing linearized files (do_linear is ignored since
+// 1.24), so this re-serializes doc itself, renumbering every object and
+// dropping those the trailer cannot reach. Object streams are unpacked.
+// Page attributes inherited from the page tree (/Resources, /MediaBox,
+// /CropBox, /Rotate) are moved into the pages of doc itself.
+// An encrypted doc must be authenticated; its objects are encrypted
+// again under their new numbers with the same key.
+void write_linearized(fz_context* ctx, pdf_document* doc, fz_output* out);
+
+// Check the linearization of the PDF at path against the file: the
+// linearization dictionary (/L, /N, /O, /E, /H, /T), the first-page xref
+// being the one startxref names, and both hint tables, whose page and
+// shared object offsets, lengths and object counts must match the
+// objects where the xref puts them. Returns JSON with "linearized",
+// "valid" and the "errors" found.
+std::string verify_linearization(fz_context* ctx, const char* path);
+
+// Time to the first rendered page when path arrives at bytesPerSecond
+// through a stream that throws FZ_ERROR_TRYLATER past the bytes received
+// so far, as a download would, for path as it is and for a linearized
+// copy written into dir. Returns JSON.
+std::string benchmark_first_page(fz_context* ctx, const char* path, const std::string& dir,
+                                 int bytesPerSecond);
+
+#endif
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "pixmap-pool.h"
+
+// Buckets never waste more than 1/8th of a buffer, and small buffers are
+// rounded to 64 KB so thumbnails of slightly different sizes share slots.
+static const size_t MIN_BUCKET_GRANULARITY = 64 * 1024;
+
+PixmapPool::PixmapPool(size_t maxRetainedBytes)
+    : maxRetainedBytes_(maxRetainedBytes) {
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+PixmapPool::~PixmapPool() {
+    trim();
+}
+
+size_t PixmapPool::bucket_size(size_t bytes) {
+    size_t pow2 = 1;
+    while (pow2 < bytes) pow2 <<= 1;
+    size_t granularity = pow2 / 8;
+    if (granularity < MIN_BUCKET_GRANULARITY) granularity = MIN_BUCKET_GRANULARITY;
+    return (bytes + granularity - 1) / granularity * granularity;
+}
+
+fz_pixmap* PixmapPool::acquire(fz_context* ctx, fz_colorspace* cs, fz_irect bbox, int alpha) {
+    int w = bbox.x1 - bbox.x0;
+    int h = bbox.y1 - bbox.y0;
+    if (w <= 0 || h <= 0)
+        fz_throw(ctx, FZ_ERROR_ARGUMENT, "empty pixmap bbox");
+
+    size_t n = (size_t)fz_colorspace_n(ctx, cs) + (alpha ? 1 : 0);
+    size_t bytes = (size_t)w * n * (size_t)h;
+    size_t bucket = bucket_size(bytes);
+
+    unsigned char* samples = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Any bucket at least as big as the request will do, but don't hand
+        // a huge buffer to a tiny render.
+        auto it = free_.lower_bound(bucket);
+        if (it != free_.end() && it->first <= bucket * 2 && !it->second.empty()) {
+            samples = it->second.back();
+            it->second.pop_back();
+            bucket = it->first;
+            if (it->second.empty()) free_.erase(it);
+            stats_.retainedBytes -= bucket;
+            stats_.hits++;
+        } else {
+            stats_.misses++;
+        }
+    }
+
+    if (!samples) {
+        samples = (unsigned char*)malloc(bucket);
+        if (!samples)
+            fz_throw(ctx, FZ_ERROR_SYSTEM, "cannot allocate %zu byte pixmap buffer", bucket);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        outstanding_[samples] = bucket;
+        stats_.outstandingBytes += bucket;
+    }
+
+    fz_pixmap* pix = nullptr;
+    fz_try(ctx) {
+        pix = fz_new_pixmap_with_bbox_and_data(ctx, cs, bbox, nullptr, alpha, samples);
+    } fz_catch(ctx) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            outstanding_.erase(samples);
+            stats_.outstandingBytes -= bucket;
+        }
+        free(samples);
+        fz_rethrow(ctx);
+    }
+    return pix;
+}
+
+void PixmapPool::release(fz_context* ctx, fz_pixmap* pix) {
+    if (!pix) return;
+    unsigned char* samples = fz_pixmap_samples(ctx, pix);
+    fz_drop_pixmap(ctx, pix);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = outstanding_.find(samples);
+    if (it == outstanding_.end()) return; // not one of ours; MuPDF freed it
+
+    size_t bucket = it->second;
+    outstanding_.erase(it);
+    stats_.outstandingBytes -= bucket;
+
+    if (bucket > maxRetainedBytes_) {
+        free(samples);
+        stats_.evictions++;
+        return;
+    }
+    evict_locked(maxRetainedBytes_ - bucket);
+    free_[bucket].push_back(samples);
+    stats_.retainedBytes += bucket;
+}
+
+void PixmapPool::evict_locked(size_t targetBytes) {
+    // Largest buffers first: they are the most expensive to keep around.
+    while (stats_.retainedBytes > targetBytes && !free_.empty()) {
+        auto it = std::prev(free_.end());
+        free(it->second.back());
+        it->second.pop_back();
+        stats_.retainedBytes -= it->first;
+        stats_.evictions++;
+        if (it->second.empty()) free_.erase(it);
+    }
+}
+
+void PixmapPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    evict_locked(0);
+}
+
+PixmapPoolStats PixmapPool::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::string PixmapPool::stats_json() {
+    PixmapPoolStats s = stats();
+    char json[192];
+    snprintf(json, sizeof(json),
+             "{\"hits\":%llu,\"misses\":%llu,\"evictions\":%llu,\"retainedBytes\":%zu,\"outstandingBytes\":%zu}",
+             s.hits, s.misses, s.evictions, s.retainedBytes, s.outstandingBytes);
+    return json;
+}
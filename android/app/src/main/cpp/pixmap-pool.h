@@ -0,0 +1,55 @@
+#ifndef BLUEPDF_PIXMAP_POOL_H
+#define BLUEPDF_PIXMAP_POOL_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+struct PixmapPoolStats {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    size_t retainedBytes;     // idle buffers kept for reuse
+    size_t outstandingBytes;  // buffers currently backing live pixmaps
+};
+
+// Size-bucketed pool of pixmap sample buffers. Buffers are plain malloc
+// allocations so they outlive the fz_context that borrowed them, and a
+// render of similar dimensions reuses the previous buffer instead of a
+// fresh multi-megabyte malloc/free pair.
+//
+// Thread-safe. Pixmaps returned by acquire() must be handed back to
+// release() and must not be kept alive by other references.
+class PixmapPool {
+public:
+    explicit PixmapPool(size_t maxRetainedBytes);
+    ~PixmapPool();
+
+    fz_pixmap* acquire(fz_context* ctx, fz_colorspace* cs, fz_irect bbox, int alpha);
+    void release(fz_context* ctx, fz_pixmap* pix);
+
+    // Free every idle buffer, e.g. on memory pressure.
+    void trim();
+
+    PixmapPoolStats stats();
+    std::string stats_json();
+
+private:
+    static size_t bucket_size(size_t bytes);
+    void evict_locked(size_t targetBytes);
+
+    std::mutex mutex_;
+    std::map<size_t, std::vector<unsigned char*>> free_;
+    std::unordered_map<unsigned char*, size_t> outstanding_;
+    size_t maxRetainedBytes_;
+    PixmapPoolStats stats_;
+};
+
+#endif
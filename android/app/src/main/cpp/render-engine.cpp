@@ -0,0 +1,238 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "render-engine.h"
+#include "image-page.h"
+#include "output-stream.h"
+#include "native-log.h"
+
+// Enough for a handful of 2x page renders; thumbnails take a fraction of this.
+static const size_t PIXMAP_POOL_BYTES = 64 * 1024 * 1024;
+
+RenderEngine& RenderEngine::instance() {
+    static RenderEngine engine;
+    return engine;
+}
+
+RenderEngine::RenderEngine()
+    : pool_(PIXMAP_POOL_BYTES) {
+}
+
+fz_pixmap* RenderEngine::render_page(fz_context* ctx, fz_page* page, const RenderProfile& profile,
+                                     fz_cookie* cookie, bool keepPartial) {
+    fz_rect bounds = fz_bound_page(ctx, page);
+    fz_matrix ctm = fz_scale(profile.scale, profile.scale);
+    fz_irect bbox = fz_round_rect(fz_transform_rect(bounds, ctm));
+
+    fz_pixmap* pix = nullptr;
+    if (render_image_page(ctx, page, profile, bbox, &pix))
+        return pix;
+
+    pix = pool_.acquire(ctx, fz_device_rgb(ctx), bbox, 0);
+    fz_device* dev = nullptr;
+
+    fz_var(dev);
+    fz_try(ctx) {
+        fz_clear_pixmap_with_value(ctx, pix, 0xFF);
+        dev = fz_new_draw_device(ctx, fz_identity, pix);
+        apply_render_profile_hints(ctx, dev, profile);
+        fz_run_page(ctx, page, dev, ctm, cookie);
+        fz_close_device(ctx, dev);
+    } fz_always(ctx) {
+        fz_drop_device(ctx, dev);
+    } fz_catch(ctx) {
+        if (keepPartial && fz_caught(ctx) == FZ_ERROR_ABORT)
+            return pix;
+        pool_.release(ctx, pix);
+        fz_rethrow(ctx);
+    }
+
+    return pix;
+}
+
+fz_pixmap* RenderEngine::render_page_with_budget(fz_context* ctx, fz_page* page, const RenderProfile& profile,
+                                                 RenderRequest& request, int budgetMs) {
+    std::mutex mutex;
+    std::condition_variable finishedCv;
+    bool finished = false;
+
+    std::thread watchdog([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!finishedCv.wait_for(lock, std::chrono::milliseconds(budgetMs), [&]() { return finished; }))
+            request.cookie.abort = 1;
+    });
+
+    fz_pixmap* pix = nullptr;
+    int errorCode = 0;
+    std::string errorMessage;
+
+    // Keep the watchdog thread out of any longjmp: catch here, join, and
+    // only then report the failure.
+    fz_var(pix);
+    fz_try(ctx) {
+        pix = render_page(ctx, page, profile, &request.cookie, true);
+    } fz_catch(ctx) {
+        errorCode = fz_caught(ctx);
+        errorMessage = fz_caught_message(ctx);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    finishedCv.notify_all();
+    watchdog.join();
+
+    if (errorCode)
+        fz_throw(ctx, errorCode, "%s", errorMessage.c_str());
+    return pix;
+}
+
+std::shared_ptr<RenderRequest> RenderEngine::begin_request(long long id) {
+    auto request = std::make_shared<RenderRequest>();
+    memset(&request->cookie, 0, sizeof(request->cookie));
+    request->cancelled = false;
+
+    std::lock_guard<std::mutex> lock(requestsMutex_);
+    requests_[id] = request;
+    return request;
+}
+
+void RenderEngine::cancel_request(long long id) {
+    std::lock_guard<std::mutex> lock(requestsMutex_);
+    auto it = requests_.find(id);
+    if (it == requests_.end()) return;
+    it->second->cancelled = true;
+    it->second->cookie.abort = 1;
+}
+
+void RenderEngine::end_request(long long id) {
+    std::lock_guard<std::mutex> lock(requestsMutex_);
+    requests_.erase(id);
+}
+
+// Fast path for scanned pages: an embedded /Thumb for draft renders, or the
+// page image decoded directly at the target size. Any failure falls back to
+// the regular draw device.
+bool RenderEngine::render_image_page(fz_context* ctx, fz_page* page, const RenderProfile& profile,
+                                     fz_irect bbox, fz_pixmap** result) {
+    SingleImagePage sip = { nullptr, fz_identity };
+    fz_pixmap* pix = nullptr;
+    bool done = false;
+
+    fz_var(pix);
+    fz_try(ctx) {
+        fz_image* thumb = nullptr;
+        if (profile.useEmbeddedThumbnail)
+            thumb = load_page_thumbnail(ctx, page, bbox.x1 - bbox.x0);
+
+        if (thumb) {
+            // /Thumb covers the whole page box.
+            fz_rect bounds = fz_bound_page(ctx, page);
+            sip.image = thumb;
+            sip.ctm = fz_make_matrix(bounds.x1 - bounds.x0, 0, 0, bounds.y1 - bounds.y0, bounds.x0, bounds.y0);
+        }
+
+        if (sip.image || find_single_image_page(ctx, page, &sip)) {
+            pix = pool_.acquire(ctx, fz_device_rgb(ctx), bbox, 0);
+            draw_single_image_page(ctx, sip, profile.scale, pix);
+            done = true;
+        }
+    } fz_always(ctx) {
+        drop_single_image_page(ctx, &sip);
+    } fz_catch(ctx) {
+        LOGI("Image page fast path failed, using draw device: %s", fz_caught_message(ctx));
+        if (pix) pool_.release(ctx, pix);
+        pix = nullptr;
+        done = false;
+    }
+
+    *result = pix;
+    return done;
+}
+
+void RenderEngine::release_pixmap(fz_context* ctx, fz_pixmap* pix) {
+    pool_.release(ctx, pix);
+}
+
+static fz_band_writer* new_band_writer(fz_context* ctx, fz_output* out, const char* format) {
+    if (strcmp(format, "png") == 0) return fz_new_png_band_writer(ctx, out);
+    if (strcmp(format, "pam") == 0) return fz_new_pam_band_writer(ctx, out);
+    if (strcmp(format, "pnm") == 0) return fz_new_pnm_band_writer(ctx, out);
+    if (strcmp(format, "pwg") == 0) {
+        fz_pwg_options pwg;
+        memset(&pwg, 0, sizeof(pwg));
+        fz_write_pwg_file_header(ctx, out);
+        return fz_new_pwg_band_writer(ctx, out, &pwg);
+    }
+    fz_throw(ctx, FZ_ERROR_ARGUMENT, "no band writer for format '%s'", format);
+}
+
+void RenderEngine::export_page_banded(fz_context* ctx, fz_page* page, const RenderProfile& profile,
+                                      int dpi, const char* format, const char* path, size_t bandBytes) {
+    float zoom = dpi / 72.0f;
+    fz_matrix ctm = fz_scale(zoom, zoom);
+    fz_irect bbox = fz_round_rect(fz_transform_rect(fz_bound_page(ctx, page), ctm));
+    int w = bbox.x1 - bbox.x0;
+    int h = bbox.y1 - bbox.y0;
+    if (w <= 0 || h <= 0)
+        fz_throw(ctx, FZ_ERROR_ARGUMENT, "page has empty bounds");
+
+    int bandHeight = (int)(bandBytes / ((size_t)w * 3));
+    if (bandHeight < 16) bandHeight = 16;
+    if (bandHeight > h) bandHeight = h;
+
+    fz_display_list* list = nullptr;
+    fz_output* out = nullptr;
+    fz_band_writer* writer = nullptr;
+    fz_pixmap* band = nullptr;
+    fz_device* dev = nullptr;
+
+    fz_var(list);
+    fz_var(out);
+    fz_var(writer);
+    fz_var(band);
+    fz_var(dev);
+    fz_try(ctx) {
+        list = fz_new_display_list_from_page(ctx, page);
+        out = open_destination(ctx, path);
+        writer = new_band_writer(ctx, out, format);
+        fz_write_header(ctx, writer, w, h, 3, 0, dpi, dpi, 0, fz_device_rgb(ctx), nullptr);
+
+        fz_irect bandBox = fz_make_irect(bbox.x0, bbox.y0, bbox.x1, bbox.y0 + bandHeight);
+        band = pool_.acquire(ctx, fz_device_rgb(ctx), bandBox, 0);
+
+        for (int y = 0; y < h; y += bandHeight) {
+            int rows = h - y < bandHeight ? h - y : bandHeight;
+
+            // Slide the same buffer down the page instead of allocating a
+            // pixmap per band.
+            band->y = bbox.y0 + y;
+            fz_clear_pixmap_with_value(ctx, band, 0xFF);
+
+            fz_irect clip = fz_make_irect(bbox.x0, band->y, bbox.x1, band->y + rows);
+            dev = fz_new_draw_device_with_bbox(ctx, fz_identity, band, &clip);
+            apply_render_profile_hints(ctx, dev, profile);
+            fz_run_display_list(ctx, list, dev, ctm, fz_rect_from_irect(clip), nullptr);
+            fz_close_device(ctx, dev);
+            fz_drop_device(ctx, dev);
+            dev = nullptr;
+
+            fz_write_band(ctx, writer, (int)fz_pixmap_stride(ctx, band), rows, fz_pixmap_samples(ctx, band));
+        }
+
+        fz_close_band_writer(ctx, writer);
+        fz_close_output(ctx, out);
+    } fz_always(ctx) {
+        fz_drop_device(ctx, dev);
+        if (band) pool_.release(ctx, band);
+        fz_drop_band_writer(ctx, writer);
+        fz_drop_output(ctx, out);
+        fz_drop_display_list(ctx, list);
+    } fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
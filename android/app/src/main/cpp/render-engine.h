@@ -0,0 +1,68 @@
+#ifndef BLUEPDF_RENDER_ENGINE_H
+#define BLUEPDF_RENDER_ENGINE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "pixmap-pool.h"
+#include "render-profile.h"
+
+// A cancellable render request. The cookie is shared with MuPDF, which
+// polls cookie.abort while running the page.
+struct RenderRequest {
+    fz_cookie cookie;
+    std::atomic<bool> cancelled;
+};
+
+// Process-wide rendering state shared by every JNI call. Each call still
+// creates its own fz_context; the engine only owns what is worth keeping
+// between calls.
+class RenderEngine {
+public:
+    static RenderEngine& instance();
+
+    // Render a page onto a white RGB pixmap using the given profile. The
+    // pixmap is backed by the engine's buffer pool and must be returned
+    // with release_pixmap(). Single-image pages (scans) skip the draw
+    // device and decode their image straight to the target size.
+    // With a cookie the render can be aborted; keepPartial returns whatever
+    // was drawn before the abort instead of throwing.
+    fz_pixmap* render_page(fz_context* ctx, fz_page* page, const RenderProfile& profile,
+                           fz_cookie* cookie = nullptr, bool keepPartial = false);
+    void release_pixmap(fz_context* ctx, fz_pixmap* pix);
+
+    // Render, but stop drawing once budgetMs has passed and return the
+    // partial result. Used for the coarse pass of progressive rendering.
+    fz_pixmap* render_page_with_budget(fz_context* ctx, fz_page* page, const RenderProfile& profile,
+                                       RenderRequest& request, int budgetMs);
+
+    // Registry of in-flight requests so another thread can cancel them.
+    std::shared_ptr<RenderRequest> begin_request(long long id);
+    void cancel_request(long long id);
+    void end_request(long long id);
+
+    // Rasterize a page at the given DPI in horizontal bands and stream each
+    // band through a band writer ("png", "pam", "pnm" or "pwg") to path, a
+    // file path or "fd:N" destination (see open_destination_fd).
+    // The page is interpreted once into a display list; peak pixel memory
+    // is one band of roughly bandBytes no matter the page size or DPI.
+    void export_page_banded(fz_context* ctx, fz_page* page, const RenderProfile& profile,
+                            int dpi, const char* format, const char* path, size_t bandBytes);
+
+    PixmapPool& pixmap_pool() { return pool_; }
+
+private:
+    RenderEngine();
+
+    bool render_image_page(fz_context* ctx, fz_page* page, const RenderProfile& profile,
+                           fz_irect bbox, fz_pixmap** result);
+
+    PixmapPool pool_;
+
+    std::mutex requestsMutex_;
+    std::unordered_map<long long, std::shared_ptr<RenderRequest>> requests_;
+};
+
+#endif
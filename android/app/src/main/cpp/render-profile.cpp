@@ -0,0 +1,42 @@
+#include <string>
+#include <cstring>
+#include "render-profile.h"
+
+const RenderProfile RENDER_PROFILE_COARSE  = { "coarse",  2, 2, false, false, 0.35f, true  };
+const RenderProfile RENDER_PROFILE_DRAFT   = { "draft",   2, 4, false, false, 1.0f,  true  };
+const RenderProfile RENDER_PROFILE_QUALITY = { "quality", 8, 8, true,  true,  1.0f,  false };
+const RenderProfile RENDER_PROFILE_EXPORT  = { "export",  8, 8, true,  true,  2.0f,  false };
+
+const RenderProfile& render_profile_by_name(const char* name, const RenderProfile& fallback) {
+    if (!name) return fallback;
+    if (strcmp(name, RENDER_PROFILE_COARSE.name) == 0) return RENDER_PROFILE_COARSE;
+    if (strcmp(name, RENDER_PROFILE_DRAFT.name) == 0) return RENDER_PROFILE_DRAFT;
+    if (strcmp(name, RENDER_PROFILE_QUALITY.name) == 0) return RENDER_PROFILE_QUALITY;
+    if (strcmp(name, RENDER_PROFILE_EXPORT.name) == 0) return RENDER_PROFILE_EXPORT;
+    return fallback;
+}
+
+void apply_render_profile(fz_context* ctx, const RenderProfile& profile) {
+    fz_set_graphics_aa_level(ctx, profile.aaLevel);
+    fz_set_text_aa_level(ctx, profile.textAaLevel);
+    if (profile.useIcc) {
+        fz_enable_icc(ctx);
+    } else {
+        fz_disable_icc(ctx);
+    }
+}
+
+void apply_render_profile_hints(fz_context* ctx, fz_device* dev, const RenderProfile& profile) {
+    if (!profile.interpolateImages) {
+        fz_enable_device_hints(ctx, dev, FZ_DONT_INTERPOLATE_IMAGES);
+    }
+}
+
+std::string render_profile_page_name(const RenderProfile& profile, int pageNumber, const char* extension) {
+    std::string name = "page_" + std::to_string(pageNumber);
+    if (strcmp(profile.name, RENDER_PROFILE_QUALITY.name) != 0) {
+        name += "_";
+        name += profile.name;
+    }
+    return name + "." + extension;
+}
@@ -0,0 +1,46 @@
+#ifndef BLUEPDF_RENDER_PROFILE_H
+#define BLUEPDF_RENDER_PROFILE_H
+
+#include <string>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+// Rendering knobs applied to a context and draw device before a page is run.
+// "draft" is meant for thumbnails and scroll previews: the same page scale as
+// "quality", with cheaper anti-aliasing and no ICC. "quality" is for final
+// views and "export" for the high resolution page images. "coarse" is the
+// first pass of a progressive render.
+struct RenderProfile {
+    const char* name;
+    int aaLevel;            // graphics anti-aliasing bits (0-8)
+    int textAaLevel;        // text anti-aliasing bits (0-8)
+    bool useIcc;            // full ICC color management
+    bool interpolateImages; // smooth image scaling
+    float scale;            // default page scale (1.0 = 72 DPI)
+    bool useEmbeddedThumbnail; // prefer a page's /Thumb image when big enough
+};
+
+extern const RenderProfile RENDER_PROFILE_COARSE;
+extern const RenderProfile RENDER_PROFILE_DRAFT;
+extern const RenderProfile RENDER_PROFILE_QUALITY;
+extern const RenderProfile RENDER_PROFILE_EXPORT;
+
+// Look a profile up by name, falling back to the given default for null or
+// unknown names.
+const RenderProfile& render_profile_by_name(const char* name, const RenderProfile& fallback);
+
+// Context-wide settings: anti-aliasing and color management.
+void apply_render_profile(fz_context* ctx, const RenderProfile& profile);
+
+// Per-device settings. Lower image interpolation cost on the draw device;
+// a reduced page scale (coarse) already makes MuPDF decode images at a
+// lower subsampling level.
+void apply_render_profile_hints(fz_context* ctx, fz_device* dev, const RenderProfile& profile);
+
+// File name for a rendered page image: page_N.png for the quality profile,
+// page_N_<profile>.png otherwise so profiles never overwrite each other.
+std::string render_profile_page_name(const RenderProfile& profile, int pageNumber, const char* extension);
+
+#endif
@@ -0,0 +1,54 @@
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+#include "result-buffer.h"
+#include "native-log.h"
+
+namespace {
+
+struct ResultBytes {
+    uint8_t* data;
+    size_t len;
+};
+
+std::mutex resultsMutex;
+std::map<int64_t, ResultBytes> results;
+int64_t nextResultId = 1;
+
+}
+
+int64_t publish_result_buffer(fz_context* ctx, fz_buffer* buf) {
+    unsigned char* data = nullptr;
+    size_t len = fz_buffer_extract(ctx, buf, &data);
+
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    int64_t id = nextResultId++;
+    results[id] = { data, len };
+    LOGI("Published result %lld (%zu bytes)", (long long)id, len);
+    return id;
+}
+
+int64_t bluepdf_result_length(int64_t id) {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    auto it = results.find(id);
+    return it == results.end() ? -1 : (int64_t)it->second.len;
+}
+
+uint8_t* bluepdf_take_result(int64_t id) {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    auto it = results.find(id);
+    if (it == results.end()) return nullptr;
+    uint8_t* data = it->second.data;
+    results.erase(it);
+    return data;
+}
+
+void bluepdf_free_result(void* data) {
+    free(data);
+}
+
+void bluepdf_release_result(int64_t id) {
+    uint8_t* data = bluepdf_take_result(id);
+    free(data);
+}
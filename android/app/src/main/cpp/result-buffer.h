@@ -0,0 +1,32 @@
+#ifndef BLUEPDF_RESULT_BUFFER_H
+#define BLUEPDF_RESULT_BUFFER_H
+
+#include <cstdint>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+// Results written to memory are handed to Dart without a copy. The bytes
+// are detached from their fz_buffer and kept under an id; Dart takes them
+// over through dart:ffi and frees them from a finalizer once the
+// Uint8List viewing them is garbage collected.
+//
+// Detaching relies on the context using the default allocator, so the
+// data can outlive the context and be released with free().
+int64_t publish_result_buffer(fz_context* ctx, fz_buffer* buf);
+
+// Entry points for dart:ffi (lib/tools/result_buffer.dart).
+extern "C" {
+    // Length of the result published under id, or -1 when there is none.
+    __attribute__((visibility("default"))) int64_t bluepdf_result_length(int64_t id);
+    // Hands the bytes over to the caller, who frees them with
+    // bluepdf_free_result. Returns null when there is no such result.
+    __attribute__((visibility("default"))) uint8_t* bluepdf_take_result(int64_t id);
+    // Finalizer for taken results.
+    __attribute__((visibility("default"))) void bluepdf_free_result(void* data);
+    // Drops a result that will not be taken.
+    __attribute__((visibility("default"))) void bluepdf_release_result(int64_t id);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef BLUEPDF_TOOL_PROGRESS_H
+#define BLUEPDF_TOOL_PROGRESS_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+extern "C" {
+    #include "mupdf/fitz.h"
+}
+
+// Stages of a document tool. A merge goes back to OPEN for every input.
+enum class ToolPhase { OPEN, PAGES, WRITE };
+
+// Progress of one running tool, shared with whoever watches it.
+// cookie.progress/progress_max count pages, and setting cookie.abort stops
+// the tool at its next check with FZ_ERROR_ABORT. bytes counts output
+// handed to a file or descriptor destination (memory outputs are not
+// counted). report, when set, is called on the tool's thread after each
+// page, phase change and flushed output buffer; it must be cheap, so
+// watchers throttle what they do with it. summary is JSON a tool may set
+// just before it returns, describing what it did beyond its output.
+struct ToolProgress {
+    fz_cookie cookie = {};
+    std::atomic<int> phase{(int)ToolPhase::OPEN};
+    std::atomic<long long> bytes{0};
+    std::function<void()> report;
+    std::string summary;
+
+    void set_phase(ToolPhase next) {
+        phase = (int)next;
+        if (report) report();
+    }
+
+    void add_pages(int done) {
+        cookie.progress += done;
+        if (report) report();
+    }
+
+    void add_bytes(size_t written) {
+        bytes += (long long)written;
+        if (report) report();
+    }
+};
+
+#endif
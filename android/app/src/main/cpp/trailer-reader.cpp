@@ -0,0 +1,629 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <set>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+
+#include "trailer-reader.h"
+#include "input-stream.h"
+
+// startxref must sit in the last 1024 bytes, the header in the first 1024.
+static const size_t TAIL_WINDOW = 1024;
+static const size_t HEAD_WINDOW = 1024;
+static const int MAX_NESTING = 32;
+static const int MAX_XREF_SECTIONS = 64;
+static const long long MAX_XREF_ENTRIES = 10 * 1000 * 1000;
+static const size_t MAX_DECODED_STREAM = 64 * 1024 * 1024;
+
+namespace {
+
+// Just enough of the PDF object model to walk trailer -> catalog -> pages.
+struct Value {
+    enum Kind { NONE, NUMBER, NAME, REF, ARRAY, DICT, OTHER } kind = NONE;
+    double number = 0;
+    int num = 0;
+    int gen = 0;
+    std::string name;
+    std::vector<Value> items;
+    std::vector<std::pair<std::string, Value>> entries;
+
+    const Value* get(const char* key) const {
+        for (const auto& e : entries)
+            if (e.first == key) return &e.second;
+        return nullptr;
+    }
+};
+
+static bool is_space(unsigned char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == 0;
+}
+
+static bool is_delim(unsigned char c) {
+    return strchr("()<>[]{}/%", c) != nullptr && c != 0;
+}
+
+static bool is_regular(unsigned char c) {
+    return !is_space(c) && !is_delim(c);
+}
+
+class Lexer {
+public:
+    Lexer(const unsigned char* data, size_t size, size_t pos)
+        : data_(data), size_(size), pos_(pos) {}
+
+    size_t pos() const { return pos_; }
+    void seek(size_t pos) { pos_ = pos; }
+
+    void skip_space() {
+        while (pos_ < size_) {
+            if (is_space(data_[pos_])) {
+                ++pos_;
+            } else if (data_[pos_] == '%') {
+                while (pos_ < size_ && data_[pos_] != '\n' && data_[pos_] != '\r') ++pos_;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool keyword(const char* kw) {
+        skip_space();
+        size_t len = strlen(kw);
+        if (pos_ + len > size_ || memcmp(data_ + pos_, kw, len) != 0) return false;
+        if (pos_ + len < size_ && is_regular(data_[pos_ + len])) return false;
+        pos_ += len;
+        return true;
+    }
+
+    bool integer(long long* out) {
+        skip_space();
+        size_t p = pos_;
+        bool negative = false;
+        if (p < size_ && (data_[p] == '+' || data_[p] == '-')) negative = data_[p++] == '-';
+        size_t digits = p;
+        long long v = 0;
+        while (p < size_ && data_[p] >= '0' && data_[p] <= '9' && p - digits < 18)
+            v = v * 10 + (data_[p++] - '0');
+        if (p == digits || (p < size_ && is_regular(data_[p]))) return false;
+        pos_ = p;
+        *out = negative ? -v : v;
+        return true;
+    }
+
+    bool value(Value* out, int depth) {
+        if (depth > MAX_NESTING) return false;
+        skip_space();
+        if (pos_ >= size_) return false;
+
+        unsigned char c = data_[pos_];
+        if (c == '<' && pos_ + 1 < size_ && data_[pos_ + 1] == '<') {
+            pos_ += 2;
+            out->kind = Value::DICT;
+            for (;;) {
+                skip_space();
+                if (pos_ + 1 < size_ && data_[pos_] == '>' && data_[pos_ + 1] == '>') {
+                    pos_ += 2;
+                    return true;
+                }
+                Value key;
+                if (!value(&key, depth + 1) || key.kind != Value::NAME) return false;
+                out->entries.emplace_back(key.name, Value());
+                if (!value(&out->entries.back().second, depth + 1)) return false;
+            }
+        }
+        if (c == '[') {
+            ++pos_;
+            out->kind = Value::ARRAY;
+            for (;;) {
+                skip_space();
+                if (pos_ < size_ && data_[pos_] == ']') {
+                    ++pos_;
+                    return true;
+                }
+                out->items.emplace_back();
+                if (!value(&out->items.back(), depth + 1)) return false;
+            }
+        }
+        if (c == '<') {
+            const void* end = memchr(data_ + pos_, '>', size_ - pos_);
+            if (!end) return false;
+            pos_ = (const unsigned char*)end - data_ + 1;
+            out->kind = Value::OTHER;
+            return true;
+        }
+        if (c == '(') return literal_string(out);
+        if (c == '/') {
+            size_t start = ++pos_;
+            while (pos_ < size_ && is_regular(data_[pos_])) ++pos_;
+            out->kind = Value::NAME;
+            out->name.assign((const char*)data_ + start, pos_ - start);
+            return true;
+        }
+        if (c == '+' || c == '-' || c == '.' || (c >= '0' && c <= '9')) return number_or_ref(out);
+        if (is_regular(c)) {
+            // true, false, null
+            while (pos_ < size_ && is_regular(data_[pos_])) ++pos_;
+            out->kind = Value::OTHER;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    bool literal_string(Value* out) {
+        int nesting = 0;
+        for (++pos_; pos_ < size_; ++pos_) {
+            unsigned char c = data_[pos_];
+            if (c == '\\') {
+                ++pos_;
+            } else if (c == '(') {
+                ++nesting;
+            } else if (c == ')' && nesting-- == 0) {
+                ++pos_;
+                out->kind = Value::OTHER;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool number_or_ref(Value* out) {
+        size_t start = pos_;
+        while (pos_ < size_ && is_regular(data_[pos_])) ++pos_;
+        std::string token((const char*)data_ + start, pos_ - start);
+        char* end = nullptr;
+        double v = strtod(token.c_str(), &end);
+        if (!end || *end) return false;
+        out->kind = Value::NUMBER;
+        out->number = v;
+
+        // "num gen R"
+        if (token.find('.') == std::string::npos && v >= 0) {
+            size_t save = pos_;
+            long long gen;
+            if (integer(&gen) && keyword("R")) {
+                out->kind = Value::REF;
+                out->num = (int)v;
+                out->gen = (int)gen;
+            } else {
+                pos_ = save;
+            }
+        }
+        return true;
+    }
+
+    const unsigned char* data_;
+    size_t size_;
+    size_t pos_;
+};
+
+static bool inflate_all(const unsigned char* src, size_t len, std::vector<unsigned char>* out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit(&zs) != Z_OK) return false;
+
+    out->resize(len * 4 + 1024);
+    zs.next_in = (Bytef*)src;
+    zs.avail_in = (uInt)len;
+    int rc = Z_OK;
+    while (rc == Z_OK) {
+        if (zs.total_out == out->size()) {
+            if (out->size() >= MAX_DECODED_STREAM) break;
+            out->resize(out->size() * 2);
+        }
+        zs.next_out = out->data() + zs.total_out;
+        zs.avail_out = (uInt)(out->size() - zs.total_out);
+        rc = inflate(&zs, Z_NO_FLUSH);
+    }
+    out->resize(zs.total_out);
+    inflateEnd(&zs);
+    return rc == Z_STREAM_END;
+}
+
+// PNG predictors (10-15) as used by xref and object streams.
+static bool unpredict_png(std::vector<unsigned char>* data, int colors, int bpc, int columns) {
+    int bpp = (colors * bpc + 7) / 8;
+    size_t rowLen = ((size_t)colors * bpc * columns + 7) / 8;
+    if (bpp < 1 || rowLen == 0) return false;
+
+    size_t rows = data->size() / (rowLen + 1);
+    std::vector<unsigned char> out(rows * rowLen);
+    std::vector<unsigned char> prev(rowLen, 0);
+    for (size_t r = 0; r < rows; ++r) {
+        const unsigned char* in = data->data() + r * (rowLen + 1);
+        unsigned char* row = out.data() + r * rowLen;
+        int filter = in[0];
+        ++in;
+        for (size_t i = 0; i < rowLen; ++i) {
+            int a = i >= (size_t)bpp ? row[i - bpp] : 0;
+            int b = prev[i];
+            int c = i >= (size_t)bpp ? prev[i - bpp] : 0;
+            int pred;
+            switch (filter) {
+                case 0: pred = 0; break;
+                case 1: pred = a; break;
+                case 2: pred = b; break;
+                case 3: pred = (a + b) / 2; break;
+                case 4: {
+                    int p = a + b - c;
+                    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                    pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                    break;
+                }
+                default: return false;
+            }
+            row[i] = (unsigned char)(in[i] + pred);
+        }
+        memcpy(prev.data(), row, rowLen);
+    }
+    data->swap(out);
+    return true;
+}
+
+static int dict_int(const Value* dict, const char* key, int fallback) {
+    const Value* v = dict ? dict->get(key) : nullptr;
+    return v && v->kind == Value::NUMBER ? (int)v->number : fallback;
+}
+
+struct XrefEntry {
+    int type;           // 0 free, 1 in file, 2 in object stream
+    long long offset;   // file offset, or object stream number
+    int index;          // index inside the object stream
+};
+
+class TailReader {
+public:
+    TailReader(const unsigned char* data, size_t size) : data_(data), size_(size) {}
+
+    bool load_xref(long long offset) {
+        std::set<long long> seen;
+        bool newest = true;
+        while (offset >= 0) {
+            if ((int)seen.size() >= MAX_XREF_SECTIONS || !seen.insert(offset).second) return false;
+            sectionFree_.clear();
+            Value sectionTrailer;
+            if (!load_xref_section(offset, &sectionTrailer)) return false;
+
+            // Hybrid files keep newer entries in a stream next to the table;
+            // they replace the table's free placeholders (see add_entry).
+            const Value* stm = sectionTrailer.get("XRefStm");
+            if (stm && stm->kind == Value::NUMBER) {
+                Value ignored;
+                if (!load_xref_section((long long)stm->number, &ignored)) return false;
+            }
+
+            const Value* prev = sectionTrailer.get("Prev");
+            offset = prev && prev->kind == Value::NUMBER ? (long long)prev->number : -1;
+            if (newest) {
+                trailer_ = std::move(sectionTrailer);
+                newest = false;
+            }
+        }
+        return true;
+    }
+
+    const Value& trailer() const { return trailer_; }
+
+    bool resolve(const Value* v, Value* out, int depth = 0) {
+        if (!v) return false;
+        if (v->kind != Value::REF) {
+            *out = *v;
+            return true;
+        }
+        if (depth > MAX_NESTING) return false;
+        Value loaded;
+        if (!load_object(v->num, &loaded)) return false;
+        return resolve(&loaded, out, depth + 1);
+    }
+
+private:
+    void add_entry(long long num, const XrefEntry& e) {
+        // Sections are read newest first; older ones never override. The
+        // exception is a hybrid file's /XRefStm, read after its table: the
+        // table marks the stream's objects free, and the stream wins.
+        auto it = xref_.find((int)num);
+        if (it == xref_.end()) {
+            xref_.emplace((int)num, e);
+            if (e.type == 0) sectionFree_.insert((int)num);
+        } else if (e.type != 0 && sectionFree_.erase((int)num)) {
+            it->second = e;
+        }
+    }
+
+    bool load_xref_section(long long offset, Value* sectionTrailer) {
+        if (offset < 0 || (size_t)offset >= size_) return false;
+        Lexer lx(data_, size_, (size_t)offset);
+
+        if (lx.keyword("xref")) {
+            for (;;) {
+                if (lx.keyword("trailer"))
+                    return lx.value(sectionTrailer, 0) && sectionTrailer->kind == Value::DICT;
+                long long start, count;
+                if (!lx.integer(&start) || !lx.integer(&count)) return false;
+                if (start < 0 || count < 0 || count > MAX_XREF_ENTRIES) return false;
+                for (long long i = 0; i < count; ++i) {
+                    long long entryOffset, gen;
+                    if (!lx.integer(&entryOffset) || !lx.integer(&gen)) return false;
+                    if (lx.keyword("n"))
+                        add_entry(start + i, { 1, entryOffset, 0 });
+                    else if (lx.keyword("f"))
+                        add_entry(start + i, { 0, 0, 0 });
+                    else
+                        return false;
+                }
+            }
+        }
+
+        // Cross-reference stream.
+        std::vector<unsigned char> stream;
+        if (!read_object_at((size_t)offset, -1, sectionTrailer, &stream)) return false;
+        const Value* type = sectionTrailer->get("Type");
+        if (!type || type->kind != Value::NAME || type->name != "XRef") return false;
+
+        const Value* w = sectionTrailer->get("W");
+        if (!w || w->kind != Value::ARRAY || w->items.size() != 3) return false;
+        int widths[3];
+        for (int i = 0; i < 3; ++i) {
+            if (w->items[i].kind != Value::NUMBER) return false;
+            widths[i] = (int)w->items[i].number;
+            if (widths[i] < 0 || widths[i] > 8) return false;
+        }
+        size_t entrySize = (size_t)widths[0] + widths[1] + widths[2];
+        if (entrySize == 0) return false;
+
+        std::vector<long long> index;
+        const Value* idx = sectionTrailer->get("Index");
+        if (idx && idx->kind == Value::ARRAY) {
+            for (const Value& item : idx->items) {
+                if (item.kind != Value::NUMBER) return false;
+                index.push_back((long long)item.number);
+            }
+        } else {
+            index.push_back(0);
+            index.push_back(dict_int(sectionTrailer, "Size", 0));
+        }
+        if (index.size() % 2) return false;
+
+        size_t pos = 0;
+        for (size_t s = 0; s < index.size(); s += 2) {
+            if (index[s] < 0 || index[s + 1] < 0 || index[s + 1] > MAX_XREF_ENTRIES) return false;
+            for (long long i = 0; i < index[s + 1]; ++i) {
+                if (pos + entrySize > stream.size()) return false;
+                long long fields[3];
+                for (int f = 0; f < 3; ++f) {
+                    long long v = 0;
+                    for (int b = 0; b < widths[f]; ++b) v = (v << 8) | stream[pos++];
+                    fields[f] = v;
+                }
+                int entryType = widths[0] ? (int)fields[0] : 1;
+                if (entryType == 1 || entryType == 2)
+                    add_entry(index[s] + i, { entryType, fields[1], (int)fields[2] });
+                else if (entryType == 0)
+                    add_entry(index[s] + i, { 0, 0, 0 });
+            }
+        }
+        return true;
+    }
+
+    // Parse "num gen obj <value> [stream]" at offset. expectNum < 0 accepts
+    // any object number. The decoded stream is returned when there is one.
+    bool read_object_at(size_t offset, int expectNum, Value* out, std::vector<unsigned char>* stream) {
+        Lexer lx(data_, size_, offset);
+        long long num, gen;
+        if (!lx.integer(&num) || !lx.integer(&gen) || !lx.keyword("obj")) return false;
+        if (expectNum >= 0 && num != expectNum) return false;
+        if (!lx.value(out, 0)) return false;
+        if (!stream) return true;
+        if (out->kind != Value::DICT || !lx.keyword("stream")) return false;
+
+        size_t start = lx.pos();
+        if (start < size_ && data_[start] == '\r') ++start;
+        if (start < size_ && data_[start] == '\n') ++start;
+
+        long long length = -1;
+        const Value* len = out->get("Length");
+        if (len && len->kind == Value::NUMBER) {
+            length = (long long)len->number;
+        } else if (len && len->kind == Value::REF && expectNum >= 0) {
+            Value resolved;
+            if (resolve(len, &resolved, 1) && resolved.kind == Value::NUMBER)
+                length = (long long)resolved.number;
+        }
+        if (length < 0 || (size_t)length > size_ - start) {
+            const void* end = memmem(data_ + start, size_ - start, "endstream", 9);
+            if (!end) return false;
+            length = (const unsigned char*)end - (data_ + start);
+        }
+        return decode_stream(*out, data_ + start, (size_t)length, stream);
+    }
+
+    bool decode_stream(const Value& dict, const unsigned char* raw, size_t len, std::vector<unsigned char>* out) {
+        const Value* filter = dict.get("Filter");
+        const Value* parms = dict.get("DecodeParms");
+        if (filter && filter->kind == Value::ARRAY) {
+            if (filter->items.size() > 1) return false;
+            filter = filter->items.empty() ? nullptr : &filter->items[0];
+        }
+        if (parms && parms->kind == Value::ARRAY)
+            parms = parms->items.empty() ? nullptr : &parms->items[0];
+
+        if (!filter) {
+            out->assign(raw, raw + len);
+            return true;
+        }
+        if (filter->kind != Value::NAME || (filter->name != "FlateDecode" && filter->name != "Fl"))
+            return false;
+        if (!inflate_all(raw, len, out)) return false;
+
+        int predictor = dict_int(parms, "Predictor", 1);
+        if (predictor == 1) return true;
+        if (predictor < 10) return false;
+        return unpredict_png(out, dict_int(parms, "Colors", 1), dict_int(parms, "BitsPerComponent", 8),
+                             dict_int(parms, "Columns", 1));
+    }
+
+    bool load_object(int num, Value* out) {
+        auto it = xref_.find(num);
+        if (it == xref_.end()) return false;
+        const XrefEntry& e = it->second;
+        if (e.type == 1)
+            return e.offset >= 0 && (size_t)e.offset < size_ && read_object_at((size_t)e.offset, num, out, nullptr);
+        if (e.type != 2) return false;
+
+        int stmNum = (int)e.offset;
+        auto stm = xref_.find(stmNum);
+        if (stm == xref_.end() || stm->second.type != 1 || stm->second.offset < 0 ||
+            (size_t)stm->second.offset >= size_)
+            return false;
+        if (objstmNum_ != stmNum) {
+            // An object stream whose /Length lives in an object stream is
+            // not worth untangling here.
+            if (loadingObjstm_) return false;
+            objstmNum_ = -1;
+            loadingObjstm_ = true;
+            bool loaded = read_object_at((size_t)stm->second.offset, stmNum, &objstmDict_, &objstm_);
+            loadingObjstm_ = false;
+            if (!loaded) return false;
+            objstmNum_ = stmNum;
+        }
+
+        int count = dict_int(&objstmDict_, "N", -1);
+        int first = dict_int(&objstmDict_, "First", -1);
+        if (e.index < 0 || e.index >= count || first < 0 || (size_t)first > objstm_.size()) return false;
+
+        Lexer header(objstm_.data(), first, 0);
+        long long objNum = -1, objOffset = -1;
+        for (int i = 0; i <= e.index; ++i)
+            if (!header.integer(&objNum) || !header.integer(&objOffset)) return false;
+        if (objNum != num || objOffset < 0 || (size_t)(first + objOffset) >= objstm_.size()) return false;
+
+        Lexer lx(objstm_.data(), objstm_.size(), first + (size_t)objOffset);
+        return lx.value(out, 0);
+    }
+
+    const unsigned char* data_;
+    size_t size_;
+    std::map<int, XrefEntry> xref_;
+    // Objects the section being read added as free.
+    std::set<int> sectionFree_;
+    Value trailer_;
+    // Catalog and page tree root usually share one object stream.
+    int objstmNum_ = -1;
+    bool loadingObjstm_ = false;
+    Value objstmDict_;
+    std::vector<unsigned char> objstm_;
+};
+
+class MappedFile {
+public:
+    explicit MappedFile(const char* path) {
+        int fd = open_source_fd(path);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = (const unsigned char*)p;
+                size_ = (size_t)st.st_size;
+                // Only a handful of pages are touched; skip readahead.
+                madvise(p, size_, MADV_RANDOM);
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (data_) munmap((void*)data_, size_);
+    }
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+static int parse_version(const unsigned char* p, size_t len) {
+    if (len < 3 || p[0] < '1' || p[0] > '9' || p[1] != '.' || p[2] < '0' || p[2] > '9') return 0;
+    return (p[0] - '0') * 10 + (p[2] - '0');
+}
+
+// Page count from the linearization dictionary, if the file still matches it.
+static int linearized_page_count(const unsigned char* data, size_t size, size_t headerStart) {
+    // Starting on the header comment skips it and the binary marker line.
+    Lexer lx(data, std::min(size, headerStart + HEAD_WINDOW), headerStart);
+    long long num, gen;
+    Value dict;
+    if (!lx.integer(&num) || !lx.integer(&gen) || !lx.keyword("obj") || !lx.value(&dict, 0)) return -1;
+    if (dict.kind != Value::DICT || !dict.get("Linearized")) return -1;
+    // An incremental update after linearization invalidates the dictionary.
+    const Value* l = dict.get("L");
+    if (!l || l->kind != Value::NUMBER || (size_t)l->number != size) return -1;
+    return dict_int(&dict, "N", -1);
+}
+
+} // namespace
+
+bool read_trailer_info(const char* path, TrailerInfo* info) {
+    MappedFile file(path);
+    const unsigned char* data = file.data();
+    size_t size = file.size();
+    if (!data) return false;
+
+    size_t headWindow = std::min(size, HEAD_WINDOW);
+    const unsigned char* header = (const unsigned char*)memmem(data, headWindow, "%PDF-", 5);
+    if (!header) return false;
+    size_t headerEnd = header - data + 5;
+    int version = parse_version(header + 5, headWindow - headerEnd);
+    if (!version) return false;
+
+    // The last "startxref" in the tail.
+    size_t tail = size > TAIL_WINDOW ? size - TAIL_WINDOW : 0;
+    const unsigned char* startxref = nullptr;
+    for (const unsigned char* p = data + tail;
+         (p = (const unsigned char*)memmem(p, size - (p - data), "startxref", 9)) != nullptr; ++p)
+        startxref = p;
+    if (!startxref) return false;
+
+    Lexer lx(data, size, startxref - data + 9);
+    long long xrefOffset;
+    if (!lx.integer(&xrefOffset)) return false;
+
+    TailReader reader(data, size);
+    if (!reader.load_xref(xrefOffset)) return false;
+    const Value& trailer = reader.trailer();
+
+    info->version = version;
+    info->encrypted = trailer.get("Encrypt") != nullptr;
+    info->pageCount = linearized_page_count(data, size, header - data);
+    info->linearized = info->pageCount > 0;
+
+    Value catalog;
+    if (!reader.resolve(trailer.get("Root"), &catalog) || catalog.kind != Value::DICT)
+        return true;
+
+    // A newer /Version in the catalog overrides the header.
+    const Value* catalogVersion = catalog.get("Version");
+    if (catalogVersion && catalogVersion->kind == Value::NAME) {
+        int v = parse_version((const unsigned char*)catalogVersion->name.c_str(), catalogVersion->name.size());
+        if (v > info->version) info->version = v;
+    }
+
+    if (info->pageCount <= 0) {
+        Value pages, count;
+        if (reader.resolve(catalog.get("Pages"), &pages) && pages.kind == Value::DICT &&
+            reader.resolve(pages.get("Count"), &count) && count.kind == Value::NUMBER && count.number >= 1)
+            info->pageCount = (int)count.number;
+        else
+            info->pageCount = -1;
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef BLUEPDF_TRAILER_READER_H
+#define BLUEPDF_TRAILER_READER_H
+
+// Answers "is it encrypted" and "how many pages" without opening the
+// document in MuPDF. The file is memory-mapped and only the header, the
+// tail (startxref, xref sections and trailer) and the objects on the path
+// to the page count are touched, which matters for huge scans and for
+// broken files that MuPDF would first repair.
+struct TrailerInfo {
+    int version;      // 17 for PDF-1.7
+    bool encrypted;   // the trailer has an /Encrypt entry
+    bool linearized;  // valid linearization dictionary (its /L matches the file)
+    int pageCount;    // /N of the linearization dictionary or /Count of the page
+                      // tree root; -1 when those objects could not be read
+};
+
+// Returns false when the header, startxref, xref sections or trailer are
+// missing, damaged or use features this reader skips (filters other than
+// Flate, for example). Callers then do a full open, as they do when only
+// the page count is needed and it came back as -1. path may be any source
+// open_source_fd() accepts.
+bool read_trailer_info(const char* path, TrailerInfo* info);
+
+#endif
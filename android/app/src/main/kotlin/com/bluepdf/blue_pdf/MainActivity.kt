@@ -1,18 +1,49 @@
 package com.bluepdf.blue_pdf
 
+import android.app.Activity
+import android.content.Intent
+import android.net.Uri
+import android.os.Build
 import android.os.Bundle
+import android.os.ParcelFileDescriptor
+import android.os.PowerManager
+import android.provider.DocumentsContract
+import android.provider.OpenableColumns
 import android.util.Log
 import java.io.File
+import java.io.FileNotFoundException
 import io.flutter.embedding.android.FlutterActivity
 import io.flutter.embedding.engine.FlutterEngine
+import io.flutter.plugin.common.EventChannel
+import io.flutter.plugin.common.MethodCall
 import io.flutter.plugin.common.MethodChannel
 import kotlinx.coroutines.*
 import org.json.JSONArray
+import org.json.JSONObject
+import java.io.IOException
 
 class MainActivity : FlutterActivity() {
 
     private val CHANNEL = "com.bluepdf.channel/pdf"
+    private val PROGRESS_CHANNEL = "com.bluepdf.channel/progress"
     private val scope = CoroutineScope(Dispatchers.Main + SupervisorJob())
+    private var channel: MethodChannel? = null
+    private var progressSink: EventChannel.EventSink? = null
+    private val PICK_DOCUMENTS_REQUEST = 4101
+    private val CREATE_DOCUMENT_REQUEST = 4102
+    private var pendingPick: MethodChannel.Result? = null
+    private var pendingCreate: MethodChannel.Result? = null
+
+    // Native jobs started from here: the content URI each one writes to,
+    // if any, the tag Dart gave the call and who waits for it to finish.
+    // Guarded by itself.
+    private class JobWatch(val output: String?, val tag: String?, val onFinished: ((JSONObject) -> Unit)?)
+    private val jobWatches = HashMap<Long, JobWatch>()
+    // Jobs awaited without an explicit output, by the result path they
+    // left in their job directory, until Dart releases the result.
+    // Guarded by itself.
+    private val resultJobs = HashMap<String, Long>()
+    private var thermalListener: PowerManager.OnThermalStatusChangedListener? = null
 
     companion object {
         init {
@@ -21,14 +52,33 @@ class MainActivity : FlutterActivity() {
     }
 
     // Native function declarations
-    private external fun imageToPdfNative(imagePaths: Array<String>, cacheDir: String, pageMode: String): String
-    private external fun mergePdfNative(pdfPaths: Array<String>, cacheDir: String): String
-    private external fun encryptPdfNative(pdfPath: String, password: String, cacheDir: String): String
-    private external fun splitPdfNative(path: String, pages: List<Int>, cacheDir: String, outputFilename: String): String
-    private external fun reorderPdfNative(inputPath: String, cacheDir: String): Array<String>
-    private external fun isPdfEncryptedNative(inputPath: String): Boolean
-    private external fun renderPdfPageNative(inputPath: String, pageNumber: Int, cacheDir: String): String
-    private external fun getPdfPageCountNative(pdfPath: String): Int
+    private external fun setCacheDirNative(cacheDir: String)
+    private external fun probePdfsNative(pdfPaths: Array<String>, pageSizes: Boolean): String
+    private external fun benchmarkPageEncodingNative(inputPath: String, pageNumber: Int, cacheDir: String): String
+    private external fun benchmarkInputStreamsNative(inputPath: String): String
+    private external fun benchmarkOutputWritersNative(inputPath: String, cacheDir: String): String
+    private external fun verifyLinearizationNative(inputPath: String): String
+    private external fun benchmarkFirstPageNative(inputPath: String, cacheDir: String, kilobytesPerSecond: Int): String
+    private external fun benchmarkImageKernelsNative(width: Int, height: Int): String
+    private external fun benchmarkAesNative(megabytes: Int): String
+    private external fun renderPdfPageProgressiveNative(requestId: Long, inputPath: String, pageNumber: Int, cacheDir: String, budgetMs: Int, profile: String): Boolean
+    private external fun cancelRenderNative(requestId: Long)
+    private external fun exportPageImageNative(inputPath: String, pageNumber: Int, dpi: Int, format: String, outputPath: String): String
+    private external fun extractPageImageNative(inputPath: String, pageNumber: Int, outputBase: String): String
+    private external fun getRenderStatsNative(): String
+    private external fun setThermalStatusNative(status: Int)
+    private external fun trimNativeMemoryNative()
+    private external fun getPdfPageCountNative(pdfPath: String, password: String): Int
+    private external fun setJobListenerNative(listen: Boolean)
+    private external fun submitImageToPdfJobNative(imagePaths: Array<String>, output: String, pageMode: String, linearize: Boolean): Long
+    private external fun submitMergeJobNative(pdfPaths: Array<String>, output: String, password: String, objectStreams: Boolean, linearize: Boolean, subsetFonts: Boolean): Long
+    private external fun submitSplitJobNative(path: String, pages: List<Int>, output: String, password: String, objectStreams: Boolean, linearize: Boolean, subsetFonts: Boolean): Long
+    private external fun submitEncryptJobNative(pdfPath: String, password: String, output: String, clean: Boolean, currentPassword: String, linearize: Boolean): Long
+    private external fun submitOptimizeJobNative(pdfPath: String, output: String, preset: String, password: String, linearize: Boolean): Long
+    private external fun submitRenderPageJobNative(inputPath: String, pageNumber: Int, profile: String, encoding: String, password: String): Long
+    private external fun cancelJobNative(jobId: Long): Boolean
+    private external fun getJobStatusNative(jobId: Long): String
+    private external fun releaseJobNative(jobId: Long)
 
 
 
@@ -40,18 +90,32 @@ class MainActivity : FlutterActivity() {
     override fun configureFlutterEngine(flutterEngine: FlutterEngine) {
         super.configureFlutterEngine(flutterEngine)
 
-        MethodChannel(flutterEngine.dartExecutor.binaryMessenger, CHANNEL).setMethodCallHandler { call, result ->
+        setCacheDirNative(applicationContext.cacheDir.absolutePath)
+        setJobListenerNative(true)
+        watchThermalStatus()
+
+        val methodChannel = MethodChannel(flutterEngine.dartExecutor.binaryMessenger, CHANNEL)
+        channel = methodChannel
+
+        // Every job update, progress included, as a JSON status string.
+        EventChannel(flutterEngine.dartExecutor.binaryMessenger, PROGRESS_CHANNEL).setStreamHandler(
+            object : EventChannel.StreamHandler {
+                override fun onListen(arguments: Any?, events: EventChannel.EventSink?) {
+                    progressSink = events
+                }
+
+                override fun onCancel(arguments: Any?) {
+                    progressSink = null
+                }
+            }
+        )
+
+        methodChannel.setMethodCallHandler { call, result ->
             when (call.method) {
                 "imageToPdf" -> {
-                    val imagePaths = call.argument<List<String>>("paths")?.toTypedArray() ?: emptyArray()
-                    val pageMode = call.argument<String>("pageMode") ?: "A4"
-                    val cacheDir = applicationContext.cacheDir.absolutePath
-                    
                     scope.launch {
                         try {
-                            val pdfPath = withContext(Dispatchers.IO) {
-                                imageToPdfNative(imagePaths, cacheDir, pageMode)
-                            }
+                            val pdfPath = jobResult(awaitJob(call.argument("output"), call.argument("tag")) { submitToolJob("imageToPdf", call) })
                             result.success(pdfPath)
                         } catch (e: Exception) {
                             Log.e("MainActivity", "Failed to create PDF: ${e.message}")
@@ -59,49 +123,34 @@ class MainActivity : FlutterActivity() {
                         }
                     }
                 }
+                // Encrypted inputs are unlocked natively with "password".
                 "mergePdf" -> {
-                    val pdfPaths = call.argument<List<String>>("paths")?.toTypedArray() ?: emptyArray()
-                    val cacheDir = applicationContext.cacheDir.absolutePath
-
                     scope.launch {
                         try {
-                            val encryptedFile = pdfPaths.firstOrNull { isPdfEncryptedNative(it) }
-                            if (encryptedFile != null) {
-                                result.error("CANNOT_MERGE_ENCRYPTED", "One or more PDFs are encrypted. Please decrypt before merging.", null)
-                                return@launch
-                            }
-
-                            val pdfPath = withContext(Dispatchers.IO) {
-                                mergePdfNative(pdfPaths, cacheDir)
-                            }
+                            val pdfPath = jobResult(awaitJob(call.argument("output"), call.argument("tag")) { submitToolJob("merge", call) })
                             result.success(pdfPath)
                         } catch (e: Exception) {
                             Log.e("MainActivity", "Failed to merge PDFs: ${e.message}")
-                            result.error("PDF_MERGE_FAILED", "Failed to merge PDFs: ${e.message}", null)
+                            result.error(passwordErrorCode(e.message) ?: "PDF_MERGE_FAILED", "Failed to merge PDFs: ${e.message}", null)
                         }
                     }
                 }
 
                 "encryptPdf" -> {
-                    val path = call.argument<String>("path") ?: return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing path", null)
-                    val password = call.argument<String>("password") ?: return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing password", null)
-                    val cacheDir = applicationContext.cacheDir.absolutePath
+                    if (call.argument<String>("path") == null) return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing path", null)
+                    if (call.argument<String>("password") == null) return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing password", null)
 
+                    // An encrypted input needs "currentPassword" and gets the new one.
                     scope.launch {
                         try {
-                            if (isPdfEncryptedNative(path)) {
+                            val job = awaitJob(call.argument("output"), call.argument("tag")) { submitToolJob("encrypt", call) }
+                            if (job.optString("state") == "done") {
+                                result.success(job.getString("result"))
+                            } else if (job.optString("error") == "password required") {
                                 result.error("ALREADY_ENCRYPTED", "PDF is already encrypted", null)
-                                return@launch
-                            }
-
-                            val res = withContext(Dispatchers.IO) {
-                                encryptPdfNative(path, password, cacheDir)
-                            }
-
-                            when {
-                                res.startsWith("ERROR:") -> result.error("ENCRYPTION_FAILED", res, null)
-                                res.isEmpty() -> result.error("EMPTY_RESULT", "No result returned from native code", null)
-                                else -> result.success(res)
+                            } else {
+                                val error = job.optString("error", "Encryption ${job.optString("state")}")
+                                result.error(passwordErrorCode(error) ?: "ENCRYPTION_FAILED", error, null)
                             }
                         } catch (e: Exception) {
                             result.error("EXCEPTION", "Exception during encryption: ${e.message}", null)
@@ -110,65 +159,84 @@ class MainActivity : FlutterActivity() {
                 }
 
                 "splitPdf" -> {
-                    val path = call.argument<String>("path") ?: return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing path", null)
-                    val pages = call.argument<List<Int>>("pages") ?: return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing pages", null)
-                    val cacheDir = applicationContext.cacheDir.absolutePath
+                    if (call.argument<String>("path") == null) return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing path", null)
+                    if (call.argument<List<Int>>("pages") == null) return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing pages", null)
 
                     scope.launch {
                         try {
-                            if (isPdfEncryptedNative(path)) {
-                                result.error("CANNOT_SPLIT_ENCRYPTED", "Cannot split an encrypted PDF. Please decrypt it first.", null)
-                                return@launch
-                            }
-
-                            val res = withContext(Dispatchers.IO) {
-                                splitPdfNative(path, pages, cacheDir, "split_pdf.pdf")
-                            }
+                            val res = jobResult(awaitJob(call.argument("output"), call.argument("tag")) { submitToolJob("split", call) })
                             result.success(res)
                         } catch (e: Exception) {
-                            result.error("EXCEPTION", e.message, null)
+                            result.error(passwordErrorCode(e.message) ?: "EXCEPTION", e.message, null)
+                        }
+                    }
+                }
+
+                // Reports the job summary (image bytes by class before and
+                // after) with "path" set to where the result was written.
+                "optimizePdf" -> {
+                    if (call.argument<String>("path") == null) return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing path", null)
+
+                    scope.launch {
+                        try {
+                            val job = awaitJob(call.argument("output"), call.argument("tag")) { submitToolJob("optimize", call) }
+                            val path = jobResult(job)
+                            val report = job.optJSONObject("summary") ?: JSONObject()
+                            result.success(report.put("path", path).toString())
+                        } catch (e: Exception) {
+                            result.error(passwordErrorCode(e.message) ?: "OPTIMIZE_FAILED", e.message, null)
                         }
                     }
                 }
 
                 "reorderPdf" -> {
                     val inputPath = call.argument<String>("path")
-                    val cacheDir = applicationContext.cacheDir.absolutePath
 
                     if (inputPath == null) {
                         result.error("INVALID_ARGUMENT", "path is null", null)
                         return@setMethodCallHandler
                     }
 
+                    val password = call.argument<String>("password") ?: ""
+
                     scope.launch {
                         try {
-                            if (isPdfEncryptedNative(inputPath)) {
-                                result.error(
-                                    "CANNOT_REORDER_ENCRYPTED",
-                                    "Cannot reorder an encrypted PDF. Please decrypt it first.",
-                                    null
-                                )
-                                return@launch
+                            val probe = withContext(Dispatchers.IO) {
+                                withNativeSource(inputPath) { probePdfs(arrayOf(it)) }.getJSONObject(0)
                             }
-
-                            val totalPages = withContext(Dispatchers.IO) {
-                                getPdfPageCountNative(inputPath)
+                            var totalPages = probe.optInt("pageCount", -1)
+                            if (probe.optBoolean("encrypted")) {
+                                if (password.isEmpty()) {
+                                    result.error("PASSWORD_REQUIRED", "This PDF is encrypted. Enter its password to reorder it.", null)
+                                    return@launch
+                                }
+                                // Only an unlocked page tree can be counted.
+                                totalPages = withContext(Dispatchers.IO) {
+                                    withNativeSource(inputPath) { getPdfPageCountNative(it, password) }
+                                }
+                                if (totalPages <= 0) {
+                                    result.error("WRONG_PASSWORD", "Incorrect password", null)
+                                    return@launch
+                                }
                             }
 
-                            val splitPaths = mutableListOf<String>()
-
-                            for (i in 1..totalPages){
-                                val singlePageList = listOf(i)
-                                val filename = "page_$i.pdf"
-
-                                val path = withContext(Dispatchers.IO) {
-                                    splitPdfNative(inputPath, singlePageList, cacheDir, filename)
+                            // One split job per page, each writing into its own job
+                            // directory; the scheduler runs a few at a time.
+                            val pageJobs = (1..totalPages).map { i ->
+                                async {
+                                    awaitJob(null) {
+                                        withNativeSource(inputPath) { submitSplitJobNative(it, listOf(i), "", password, false, false, false) }
+                                    }
                                 }
+                            }
 
-                                if (path != null && path.isNotBlank()) {
-                                    splitPaths.add(path)
+                            val splitPaths = mutableListOf<String>()
+                            pageJobs.forEachIndexed { i, pageJob ->
+                                val job = pageJob.await()
+                                if (job.optString("state") == "done") {
+                                    splitPaths.add(job.getString("result"))
                                 } else {
-                                    Log.e("MainActivity", "Failed to split page $i")
+                                    Log.e("MainActivity", "Failed to split page ${i + 1}")
                                 }
                             }
 
@@ -185,8 +253,33 @@ class MainActivity : FlutterActivity() {
                 }
 
                 "renderPdfPage" -> {
+                    if (call.argument<String>("pdfPath") == null) {
+                        result.error("INVALID_ARGUMENT", "pdfPath is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val job = awaitJob(null, call.argument("tag")) { submitToolJob("renderPage", call) }
+
+                            if (job.optString("state") == "done") {
+                                result.success(job.getString("result"))
+                            } else {
+                                val error = job.optString("error")
+                                result.error(passwordErrorCode(error) ?: "RENDER_FAILED", "Failed to render page", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("RENDER_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "renderPdfPageProgressive" -> {
                     val pdfPath = call.argument<String>("pdfPath")
                     val pageIndex = call.argument<Int>("pageIndex") ?: 0
+                    val requestId = call.argument<Number>("requestId")?.toLong() ?: 0L
+                    val budgetMs = call.argument<Int>("budgetMs") ?: 120
+                    val profile = call.argument<String>("profile") ?: "quality"
                     val cacheDir = applicationContext.cacheDir.absolutePath
 
                     if (pdfPath == null) {
@@ -196,21 +289,244 @@ class MainActivity : FlutterActivity() {
 
                     scope.launch {
                         try {
-                            val outputImagePath = withContext(Dispatchers.IO) {
-                                renderPdfPageNative(pdfPath, pageIndex, cacheDir)
+                            // Both passes arrive through onProgressiveRender; the result
+                            // only says whether the fine pass completed.
+                            val completed = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) {
+                                    renderPdfPageProgressiveNative(requestId, it, pageIndex, cacheDir, budgetMs, profile)
+                                }
                             }
+                            result.success(completed)
+                        } catch (e: Exception) {
+                            result.error("RENDER_FAILED", e.message, null)
+                        }
+                    }
+                }
 
-                            if (outputImagePath != null && outputImagePath.isNotEmpty()) {
-                                result.success(outputImagePath)
+                "cancelRender" -> {
+                    val requestId = call.argument<Number>("requestId")?.toLong() ?: 0L
+                    cancelRenderNative(requestId)
+                    result.success(null)
+                }
+
+                "exportPageImage" -> {
+                    val pdfPath = call.argument<String>("pdfPath")
+                    val pageIndex = call.argument<Int>("pageIndex") ?: 0
+                    val dpi = call.argument<Int>("dpi") ?: 300
+                    val format = call.argument<String>("format") ?: "png"
+                    val cacheDir = applicationContext.cacheDir.absolutePath
+                    val output = call.argument<String>("output")
+
+                    if (pdfPath == null) {
+                        result.error("INVALID_ARGUMENT", "pdfPath is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val outputPath = output ?: "$cacheDir/page_${pageIndex + 1}_${dpi}dpi.$format"
+                            val res = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) { source ->
+                                    withNativeDestination(outputPath) { exportPageImageNative(source, pageIndex, dpi, format, it) }
+                                }
+                            }
+
+                            if (res.isNotEmpty()) {
+                                result.success(res)
                             } else {
-                                result.error("RENDER_FAILED", "Failed to render page", null)
+                                result.error("EXPORT_FAILED", "Failed to export page image", null)
                             }
                         } catch (e: Exception) {
-                            result.error("RENDER_FAILED", e.message, null)
+                            result.error("EXPORT_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "extractPageImage" -> {
+                    val pdfPath = call.argument<String>("pdfPath")
+                    val pageIndex = call.argument<Int>("pageIndex") ?: 0
+                    val cacheDir = applicationContext.cacheDir.absolutePath
+
+                    if (pdfPath == null) {
+                        result.error("INVALID_ARGUMENT", "pdfPath is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val res = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) {
+                                    extractPageImageNative(it, pageIndex, "$cacheDir/page_${pageIndex + 1}_image")
+                                }
+                            }
+                            // Empty result: the page is not a single image.
+                            result.success(res.ifEmpty { null })
+                        } catch (e: Exception) {
+                            result.error("EXTRACT_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "benchmarkPageEncoding" -> {
+                    val pdfPath = call.argument<String>("pdfPath")
+                    val pageIndex = call.argument<Int>("pageIndex") ?: 0
+                    val cacheDir = applicationContext.cacheDir.absolutePath
+
+                    if (pdfPath == null) {
+                        result.error("INVALID_ARGUMENT", "pdfPath is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val report = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) { benchmarkPageEncodingNative(it, pageIndex, cacheDir) }
+                            }
+                            if (report.isNotEmpty()) {
+                                result.success(report)
+                            } else {
+                                result.error("BENCHMARK_FAILED", "Encoding benchmark failed", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("BENCHMARK_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "benchmarkInputStreams" -> {
+                    val pdfPath = call.argument<String>("pdfPath")
+
+                    if (pdfPath == null) {
+                        result.error("INVALID_ARGUMENT", "pdfPath is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val report = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) { benchmarkInputStreamsNative(it) }
+                            }
+                            if (report.isNotEmpty()) {
+                                result.success(report)
+                            } else {
+                                result.error("BENCHMARK_FAILED", "Input stream benchmark failed", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("BENCHMARK_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "benchmarkOutputWriters" -> {
+                    val pdfPath = call.argument<String>("pdfPath")
+                    val cacheDir = applicationContext.cacheDir.absolutePath
+
+                    if (pdfPath == null) {
+                        result.error("INVALID_ARGUMENT", "pdfPath is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val report = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) { benchmarkOutputWritersNative(it, cacheDir) }
+                            }
+                            if (report.isNotEmpty()) {
+                                result.success(report)
+                            } else {
+                                result.error("BENCHMARK_FAILED", "Output writer benchmark failed", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("BENCHMARK_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "verifyLinearization" -> {
+                    val pdfPath = call.argument<String>("pdfPath")
+
+                    if (pdfPath == null) {
+                        result.error("INVALID_ARGUMENT", "pdfPath is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val report = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) { verifyLinearizationNative(it) }
+                            }
+                            if (report.isNotEmpty()) {
+                                result.success(report)
+                            } else {
+                                result.error("VERIFY_FAILED", "Linearization check failed", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("VERIFY_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "benchmarkFirstPage" -> {
+                    val pdfPath = call.argument<String>("pdfPath")
+                    val kilobytesPerSecond = call.argument<Int>("kilobytesPerSecond") ?: 256
+                    val cacheDir = applicationContext.cacheDir.absolutePath
+
+                    if (pdfPath == null) {
+                        result.error("INVALID_ARGUMENT", "pdfPath is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val report = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) { benchmarkFirstPageNative(it, cacheDir, kilobytesPerSecond) }
+                            }
+                            if (report.isNotEmpty()) {
+                                result.success(report)
+                            } else {
+                                result.error("BENCHMARK_FAILED", "First page benchmark failed", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("BENCHMARK_FAILED", e.message, null)
                         }
                     }
                 }
 
+                "benchmarkImageKernels" -> {
+                    val width = call.argument<Int>("width") ?: 2480
+                    val height = call.argument<Int>("height") ?: 3508
+
+                    scope.launch {
+                        val report = withContext(Dispatchers.IO) {
+                            benchmarkImageKernelsNative(width, height)
+                        }
+                        if (report.isNotEmpty()) {
+                            result.success(report)
+                        } else {
+                            result.error("BENCHMARK_FAILED", "Image kernel benchmark failed", null)
+                        }
+                    }
+                }
+
+                "benchmarkAes" -> {
+                    val megabytes = call.argument<Int>("megabytes") ?: 32
+
+                    scope.launch {
+                        val report = withContext(Dispatchers.IO) {
+                            benchmarkAesNative(megabytes)
+                        }
+                        if (report.isNotEmpty()) {
+                            result.success(report)
+                        } else {
+                            result.error("BENCHMARK_FAILED", "AES benchmark failed", null)
+                        }
+                    }
+                }
+
+                "getRenderStats" -> {
+                    result.success(getRenderStatsNative())
+                }
+
                 "getPdfPageCount" -> {
                     val pdfPath = call.argument<String>("pdfPath")
 
@@ -219,22 +535,489 @@ class MainActivity : FlutterActivity() {
                         return@setMethodCallHandler
                     }
 
+                    scope.launch {
+                        try {
+                            val pageCount = withContext(Dispatchers.IO) {
+                                withNativeSource(pdfPath) { getPdfPageCountNative(it, call.argument<String>("password") ?: "") }
+                            }
+                            result.success(pageCount)
+                        } catch (e: Exception) {
+                            result.error("GET_PAGE_COUNT_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "probePdfs" -> {
+                    val pdfPaths = call.argument<List<String>>("paths")?.toTypedArray() ?: emptyArray()
+                    val pageSizes = call.argument<Boolean>("pageSizes") ?: true
+
+                    scope.launch {
+                        try {
+                            val report = withContext(Dispatchers.IO) {
+                                withNativeSources(pdfPaths) { probePdfsNative(it, pageSizes) }
+                            }
+                            if (report.isNotEmpty()) {
+                                result.success(report)
+                            } else {
+                                result.error("PROBE_FAILED", "Failed to probe PDFs", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("PROBE_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "pickDocuments" -> {
+                    val allowMultiple = call.argument<Boolean>("allowMultiple") ?: false
+                    val mimeType = call.argument<String>("mimeType") ?: "application/pdf"
+
+                    if (pendingPick != null) {
+                        result.error("PICK_IN_PROGRESS", "A document picker is already open", null)
+                        return@setMethodCallHandler
+                    }
+
+                    val intent = Intent(Intent.ACTION_OPEN_DOCUMENT).apply {
+                        addCategory(Intent.CATEGORY_OPENABLE)
+                        type = mimeType
+                        putExtra(Intent.EXTRA_ALLOW_MULTIPLE, allowMultiple)
+                    }
+                    pendingPick = result
+                    startActivityForResult(intent, PICK_DOCUMENTS_REQUEST)
+                }
+
+                "createDocument" -> {
+                    val name = call.argument<String>("name") ?: "document.pdf"
+                    val mimeType = call.argument<String>("mimeType") ?: "application/pdf"
+
+                    if (pendingCreate != null) {
+                        result.error("CREATE_IN_PROGRESS", "A save dialog is already open", null)
+                        return@setMethodCallHandler
+                    }
+
+                    val intent = Intent(Intent.ACTION_CREATE_DOCUMENT).apply {
+                        addCategory(Intent.CATEGORY_OPENABLE)
+                        type = mimeType
+                        putExtra(Intent.EXTRA_TITLE, name)
+                    }
+                    pendingCreate = result
+                    startActivityForResult(intent, CREATE_DOCUMENT_REQUEST)
+                }
+
+                // Drops a document created for a result that was never written.
+                "deleteDocument" -> {
+                    val uri = call.argument<String>("uri")
+
+                    if (uri == null) {
+                        result.error("INVALID_ARGUMENT", "uri is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        withContext(Dispatchers.IO) { deleteIncompleteDocument(uri) }
+                        result.success(null)
+                    }
+                }
+
+                "describeDocument" -> {
+                    val uri = call.argument<String>("uri")
+
+                    if (uri == null) {
+                        result.error("INVALID_ARGUMENT", "uri is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    scope.launch {
+                        try {
+                            val info = withContext(Dispatchers.IO) {
+                                describeDocument(Uri.parse(uri))
+                            }
+                            result.success(info)
+                        } catch (e: Exception) {
+                            result.error("DESCRIBE_FAILED", e.message, null)
+                        }
+                    }
+                }
+
+                "viewDocument", "shareDocument" -> {
+                    val uri = call.argument<String>("uri")
+                    val mimeType = call.argument<String>("mimeType") ?: "application/pdf"
+
+                    if (uri == null) {
+                        result.error("INVALID_ARGUMENT", "uri is null", null)
+                        return@setMethodCallHandler
+                    }
+
+                    val intent = if (call.method == "viewDocument") {
+                        Intent(Intent.ACTION_VIEW).setDataAndType(Uri.parse(uri), mimeType)
+                    } else {
+                        Intent.createChooser(
+                            Intent(Intent.ACTION_SEND).apply {
+                                type = mimeType
+                                putExtra(Intent.EXTRA_STREAM, Uri.parse(uri))
+                            },
+                            null
+                        )
+                    }
+                    intent.addFlags(Intent.FLAG_GRANT_READ_URI_PERMISSION)
                     try {
-                        val pageCount = getPdfPageCountNative(pdfPath)
-                        result.success(pageCount)
+                        startActivity(intent)
+                        result.success(true)
                     } catch (e: Exception) {
-                        result.error("GET_PAGE_COUNT_FAILED", e.message, null)
+                        result.error("NO_APP", e.message, null)
+                    }
+                }
+
+                // Background jobs: the tool runs natively and this returns its id
+                // at once. Updates arrive on the progress event channel; arguments
+                // are those of the matching tool call.
+                "submitJob" -> {
+                    val type = call.argument<String>("type")
+                        ?: return@setMethodCallHandler result.error("INVALID_ARGUMENT", "Missing type", null)
+
+                    scope.launch {
+                        try {
+                            val jobId = withContext(Dispatchers.IO) {
+                                startJob(call.argument("output"), call.argument("tag"), null) { submitToolJob(type, call) }
+                            }
+                            if (jobId < 0) {
+                                result.error("JOB_FAILED", "Could not start $type job", null)
+                            } else {
+                                result.success(jobId)
+                            }
+                        } catch (e: Exception) {
+                            result.error("JOB_FAILED", e.message, null)
+                        }
                     }
                 }
 
+                "cancelJob" -> {
+                    val jobId = call.argument<Number>("jobId")?.toLong() ?: -1L
+                    result.success(cancelJobNative(jobId))
+                }
+
+                "getJobStatus" -> {
+                    val jobId = call.argument<Number>("jobId")?.toLong() ?: -1L
+                    val status = getJobStatusNative(jobId)
+                    result.success(if (status.isEmpty()) null else mapJobStatus(jobId, JSONObject(status)).toString())
+                }
+
+                "releaseJob" -> {
+                    val jobId = call.argument<Number>("jobId")?.toLong() ?: -1L
+                    releaseJobNative(jobId)
+                    result.success(null)
+                }
+
+                // Results of renderPdfPage, reorderPdf and memory outputs, once
+                // Dart is done with them.
+                "releaseJobResults" -> {
+                    val paths = call.argument<List<String>>("paths") ?: emptyList()
+                    val jobIds = synchronized(resultJobs) { paths.mapNotNull { resultJobs.remove(it) } }
+                    jobIds.forEach { releaseJobNative(it) }
+                    result.success(null)
+                }
 
                 else -> result.notImplemented()
             }
         }
     }
 
+    // One native round trip for the whole selection; call off the main thread.
+    // Encryption and page count only, answered from the trailers where possible.
+    private fun probePdfs(pdfPaths: Array<String>): JSONArray {
+        val report = probePdfsNative(pdfPaths, false)
+        return JSONArray(if (report.isEmpty()) "[]" else report)
+    }
+
+    // Native code reads content URIs in place: each one is opened here and
+    // passed down as "fd:N", and the descriptors stay open until block
+    // returns. Plain paths pass through unchanged.
+    private fun <T> withNativeSources(paths: Array<String>, block: (Array<String>) -> T): T {
+        val descriptors = mutableListOf<ParcelFileDescriptor>()
+        try {
+            val sources = paths.map { path ->
+                if (path.startsWith("content://")) {
+                    val pfd = contentResolver.openFileDescriptor(Uri.parse(path), "r")
+                        ?: throw FileNotFoundException("Cannot open $path")
+                    descriptors.add(pfd)
+                    "fd:${pfd.fd}"
+                } else {
+                    path
+                }
+            }
+            return block(sources.toTypedArray())
+        } finally {
+            descriptors.forEach { it.close() }
+        }
+    }
+
+    private fun <T> withNativeSource(path: String, block: (String) -> T): T =
+        withNativeSources(arrayOf(path)) { block(it[0]) }
+
+    // Results go straight to where the user chose to save them. A content
+    // URI is opened for writing here and passed down as "fd:N"; block
+    // returns the native result, which is mapped back to output on success.
+    // A document left incomplete by a failed write is deleted.
+    private fun withNativeDestination(output: String, block: (String) -> String): String {
+        if (!output.startsWith("content://")) return block(output)
+
+        val pfd = contentResolver.openFileDescriptor(Uri.parse(output), "rwt")
+            ?: throw FileNotFoundException("Cannot open $output")
+        var res = ""
+        try {
+            res = pfd.use { block("fd:${it.fd}") }
+        } finally {
+            if (res.isEmpty() || res.startsWith("ERROR:")) deleteIncompleteDocument(output)
+        }
+        return if (res.isEmpty() || res.startsWith("ERROR:")) res else output
+    }
+
+    private fun deleteIncompleteDocument(output: String) {
+        try {
+            DocumentsContract.deleteDocument(contentResolver, Uri.parse(output))
+        } catch (e: Exception) {
+            Log.w("MainActivity", "Could not delete incomplete $output")
+        }
+    }
+
+    // Like withNativeDestination, for jobs: native code keeps its own copy of
+    // the descriptor, so it is closed again as soon as block returns.
+    private fun <T> withJobDestination(output: String, block: (String) -> T): T {
+        if (!output.startsWith("content://")) return block(output)
+
+        val pfd = contentResolver.openFileDescriptor(Uri.parse(output), "rwt")
+            ?: throw FileNotFoundException("Cannot open $output")
+        return pfd.use { block("fd:${it.fd}") }
+    }
+
+    // Submits the native job for a tool call. An absent output makes the job
+    // write into its own directory instead of a shared cache file.
+    private fun submitToolJob(type: String, call: MethodCall): Long {
+        val output = call.argument<String>("output") ?: ""
+        // Unlocks encrypted inputs in memory; encrypt calls it currentPassword.
+        val password = call.argument<String>(if (type == "encrypt") "currentPassword" else "password") ?: ""
+        // Merge and split pack objects into object streams with an xref stream.
+        val objectStreams = call.argument<Boolean>("objectStreams") ?: false
+        // Every tool that writes a PDF can write it linearized instead.
+        val linearize = call.argument<Boolean>("linearize") ?: false
+        // Merge and split can cut embedded fonts down to the glyphs they use.
+        val subsetFonts = call.argument<Boolean>("subsetFonts") ?: false
+        return when (type) {
+            "imageToPdf" -> {
+                val imagePaths = call.argument<List<String>>("paths")?.toTypedArray() ?: emptyArray()
+                val pageMode = call.argument<String>("pageMode") ?: "A4"
+                withJobDestination(output) { submitImageToPdfJobNative(imagePaths, it, pageMode, linearize) }
+            }
+            "merge" -> {
+                val pdfPaths = call.argument<List<String>>("paths")?.toTypedArray() ?: emptyArray()
+                withNativeSources(pdfPaths) { sources ->
+                    withJobDestination(output) { submitMergeJobNative(sources, it, password, objectStreams, linearize, subsetFonts) }
+                }
+            }
+            "split" -> {
+                val path = call.argument<String>("path") ?: throw IllegalArgumentException("Missing path")
+                val pages = call.argument<List<Int>>("pages") ?: throw IllegalArgumentException("Missing pages")
+                withNativeSource(path) { source ->
+                    withJobDestination(output) { submitSplitJobNative(source, pages, it, password, objectStreams, linearize, subsetFonts) }
+                }
+            }
+            "encrypt" -> {
+                val path = call.argument<String>("path") ?: throw IllegalArgumentException("Missing path")
+                val newPassword = call.argument<String>("password") ?: throw IllegalArgumentException("Missing password")
+                val clean = call.argument<Boolean>("clean") ?: false
+                withNativeSource(path) { source ->
+                    withJobDestination(output) { submitEncryptJobNative(source, newPassword, it, clean, password, linearize) }
+                }
+            }
+            "optimize" -> {
+                val path = call.argument<String>("path") ?: throw IllegalArgumentException("Missing path")
+                val preset = call.argument<String>("preset") ?: "balanced"
+                withNativeSource(path) { source ->
+                    withJobDestination(output) { submitOptimizeJobNative(source, it, preset, password, linearize) }
+                }
+            }
+            "renderPage" -> {
+                val pdfPath = call.argument<String>("pdfPath") ?: throw IllegalArgumentException("Missing pdfPath")
+                val pageIndex = call.argument<Int>("pageIndex") ?: 0
+                val profile = call.argument<String>("profile") ?: "quality"
+                val encoding = call.argument<String>("encoding") ?: "png"
+                withNativeSource(pdfPath) { submitRenderPageJobNative(it, pageIndex, profile, encoding, password) }
+            }
+            else -> throw IllegalArgumentException("Unknown job type $type")
+        }
+    }
+
+    // Runs submit and watches the job it returns. Updates wait on jobWatches,
+    // so even a job that finishes at once is only reported once watched.
+    private fun startJob(output: String?, tag: String?, onFinished: ((JSONObject) -> Unit)?, submit: () -> Long): Long =
+        synchronized(jobWatches) {
+            val jobId = submit()
+            if (jobId >= 0) {
+                jobWatches[jobId] = JobWatch(output?.takeIf { it.startsWith("content://") }, tag, onFinished)
+            }
+            jobId
+        }
+
+    // Starts a job and suspends, without holding a thread, until it has
+    // finished. Returns its final status; cancelling the caller cancels it.
+    // The job is released once over, except when it succeeded without an
+    // explicit output or into memory: its result stays in the job directory
+    // (or native memory) until Dart hands the path or handle to
+    // releaseJobResults.
+    private suspend fun awaitJob(output: String?, tag: String? = null, submit: () -> Long): JSONObject {
+        val finished = CompletableDeferred<JSONObject>()
+        val jobId = withContext(Dispatchers.IO) {
+            startJob(output, tag, { finished.complete(it) }, submit)
+        }
+        if (jobId < 0) throw IOException("Could not start native job")
+        var keep = false
+        try {
+            val status = finished.await()
+            if ((output == null || output == "mem:") && status.optString("state") == "done") {
+                synchronized(resultJobs) { resultJobs[status.getString("result")] = jobId }
+                keep = true
+            }
+            return status
+        } finally {
+            // A job still running is cancelled and released once it stops.
+            if (!keep) releaseJobNative(jobId)
+        }
+    }
+
+    // Native tools fail with these messages while an encrypted input stays locked.
+    private fun passwordErrorCode(message: String?): String? = when {
+        message == null -> null
+        message.endsWith("password required") -> "PASSWORD_REQUIRED"
+        message.endsWith("incorrect password") -> "WRONG_PASSWORD"
+        else -> null
+    }
+
+    private fun jobResult(status: JSONObject): String {
+        if (status.optString("state") != "done") {
+            throw IOException(status.optString("error", "Job ${status.optString("state")}"))
+        }
+        return status.getString("result")
+    }
+
+    // A job writing to a content URI reports the URI, not the descriptor.
+    private fun mapJobStatus(jobId: Long, status: JSONObject): JSONObject {
+        val output = synchronized(jobWatches) { jobWatches[jobId]?.output }
+        if (output != null && status.optString("state") == "done") status.put("result", output)
+        return status
+    }
+
+    // Called from native code, on a job worker thread, whenever a job changes
+    // state and, throttled natively, as it makes progress. A document left
+    // incomplete by a failed or cancelled job is deleted, unless the job
+    // only lacked a password: Dart runs it again into the same document
+    // and deletes it itself if the user gives up.
+    private fun onJobUpdate(jobId: Long, status: String) {
+        val update = JSONObject(status)
+        val state = update.optString("state")
+        val finished = state == "done" || state == "failed" || state == "cancelled"
+        val watch = synchronized(jobWatches) {
+            if (finished) jobWatches.remove(jobId) else jobWatches[jobId]
+        }
+        watch?.tag?.let { update.put("tag", it) }
+        if (watch?.output != null) {
+            if (state == "done") {
+                update.put("result", watch.output)
+            } else if (finished && passwordErrorCode(update.optString("error")) == null) {
+                deleteIncompleteDocument(watch.output)
+            }
+        }
+        runOnUiThread {
+            progressSink?.success(update.toString())
+            if (finished) watch?.onFinished?.invoke(update)
+        }
+    }
+
+    @Deprecated("Deprecated in Java")
+    override fun onActivityResult(requestCode: Int, resultCode: Int, data: Intent?) {
+        super.onActivityResult(requestCode, resultCode, data)
+        if (requestCode == CREATE_DOCUMENT_REQUEST) {
+            val result = pendingCreate ?: return
+            pendingCreate = null
+            result.success(if (resultCode == Activity.RESULT_OK) data?.data?.toString() else null)
+            return
+        }
+        if (requestCode != PICK_DOCUMENTS_REQUEST) return
+
+        val result = pendingPick ?: return
+        pendingPick = null
+        if (resultCode != Activity.RESULT_OK || data == null) {
+            result.success(emptyList<Map<String, Any?>>())
+            return
+        }
+
+        val uris = mutableListOf<Uri>()
+        val clip = data.clipData
+        if (clip != null) {
+            for (i in 0 until clip.itemCount) uris.add(clip.getItemAt(i).uri)
+        } else {
+            data.data?.let { uris.add(it) }
+        }
+
+        scope.launch {
+            val picked = withContext(Dispatchers.IO) {
+                uris.map { describeDocument(it) }
+            }
+            result.success(picked)
+        }
+    }
+
+    // Keeps read access across restarts, so a picked URI can be reopened
+    // later without copying the document into the cache first.
+    private fun describeDocument(uri: Uri): Map<String, Any?> {
+        try {
+            contentResolver.takePersistableUriPermission(uri, Intent.FLAG_GRANT_READ_URI_PERMISSION)
+        } catch (e: SecurityException) {
+            Log.w("MainActivity", "No persistable permission for $uri")
+        }
+
+        var name: String? = null
+        var size: Long = -1
+        contentResolver.query(uri, arrayOf(OpenableColumns.DISPLAY_NAME, OpenableColumns.SIZE), null, null, null)?.use { cursor ->
+            if (cursor.moveToFirst()) {
+                val nameIndex = cursor.getColumnIndex(OpenableColumns.DISPLAY_NAME)
+                val sizeIndex = cursor.getColumnIndex(OpenableColumns.SIZE)
+                if (nameIndex >= 0) name = cursor.getString(nameIndex)
+                if (sizeIndex >= 0 && !cursor.isNull(sizeIndex)) size = cursor.getLong(sizeIndex)
+            }
+        }
+        return mapOf("uri" to uri.toString(), "name" to (name ?: uri.lastPathSegment), "size" to size)
+    }
+
+    // Called from native code (on an IO thread) after each progressive render pass.
+    private fun onProgressiveRender(requestId: Long, pass: Int, path: String) {
+        runOnUiThread {
+            channel?.invokeMethod(
+                "onPageRendered",
+                mapOf("requestId" to requestId, "pass" to pass, "path" to path)
+            )
+        }
+    }
+
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        trimNativeMemoryNative()
+    }
+
+    // Native parallel work runs fewer threads while the device is hot.
+    private fun watchThermalStatus() {
+        if (Build.VERSION.SDK_INT < Build.VERSION_CODES.Q || thermalListener != null) return
+        val powerManager = getSystemService(PowerManager::class.java) ?: return
+        val listener = PowerManager.OnThermalStatusChangedListener { setThermalStatusNative(it) }
+        setThermalStatusNative(powerManager.currentThermalStatus)
+        powerManager.addThermalStatusListener(mainExecutor, listener)
+        thermalListener = listener
+    }
+
     override fun onDestroy() {
         super.onDestroy()
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+            thermalListener?.let { getSystemService(PowerManager::class.java)?.removeThermalStatusListener(it) }
+        }
+        setJobListenerNative(false)
         scope.cancel()
     }
 }
\ No newline at end of file
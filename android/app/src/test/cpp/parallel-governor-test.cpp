@@ -0,0 +1,130 @@
+#include <cstdio>
+
+#include "parallel-governor.h"
+
+#define MB (1024LL * 1024)
+#define GB (1024 * MB)
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        ++failures; \
+    } \
+} while (0)
+
+static SystemReader fixed(int cpus, long long total, long long available, int thermal = 0) {
+    return [=]() {
+        SystemReadings readings;
+        readings.onlineCpus = cpus;
+        readings.totalBytes = total;
+        readings.availableBytes = available;
+        readings.thermalStatus = thermal;
+        return readings;
+    };
+}
+
+static void test_meminfo_with_available() {
+    const char* text =
+        "MemTotal:        3911520 kB\n"
+        "MemFree:          142880 kB\n"
+        "MemAvailable:    1650432 kB\n"
+        "Buffers:           10240 kB\n"
+        "Cached:          1402368 kB\n";
+    SystemReadings readings;
+    CHECK(ParallelGovernor::parse_meminfo(text, &readings));
+    CHECK(readings.totalBytes == 3911520LL * 1024);
+    CHECK(readings.availableBytes == 1650432LL * 1024);
+}
+
+static void test_meminfo_without_available() {
+    // Kernels before 3.14 have no MemAvailable: MemFree + Cached stands in.
+    const char* text =
+        "MemTotal:        1015808 kB\n"
+        "MemFree:           65536 kB\n"
+        "Buffers:            8192 kB\n"
+        "Cached:           262144 kB\n";
+    SystemReadings readings;
+    CHECK(ParallelGovernor::parse_meminfo(text, &readings));
+    CHECK(readings.totalBytes == 1015808LL * 1024);
+    CHECK(readings.availableBytes == (65536LL + 262144) * 1024);
+}
+
+static void test_meminfo_unusable() {
+    SystemReadings readings;
+    CHECK(!ParallelGovernor::parse_meminfo("", &readings));
+    CHECK(!ParallelGovernor::parse_meminfo("Buffers: 8192 kB\n", &readings));
+    CHECK(readings.totalBytes == -1);
+    CHECK(readings.availableBytes == -1);
+}
+
+static void test_plan_plentiful_memory() {
+    ParallelGovernor governor;
+    governor.set_store_budget(256 * MB);
+    governor.set_reader(fixed(8, 8 * GB, 6 * GB));
+
+    ParallelPlan plan = governor.plan(WorkKind::DOCUMENT, 8);
+    CHECK(plan.workers == 8);
+    CHECK(plan.storeBytes == (size_t)(256 * MB));
+
+    CHECK(governor.plan(WorkKind::DOCUMENT, 3).workers == 3);
+    CHECK(governor.plan(WorkKind::PROBE, 0).workers == 4);
+}
+
+static void test_plan_tight_memory() {
+    ParallelGovernor governor;
+    governor.set_store_budget(256 * MB);
+
+    // Under a tenth of total memory available: one worker, smallest store.
+    governor.set_reader(fixed(8, 4 * GB, 300 * MB));
+    ParallelPlan plan = governor.plan(WorkKind::RENDER, 8);
+    CHECK(plan.workers == 1);
+    CHECK(plan.storeBytes == (size_t)(16 * MB));
+
+    // Not tight yet, but only a few workers fit in half of what is free.
+    governor.set_reader(fixed(8, 4 * GB, 512 * MB));
+    plan = governor.plan(WorkKind::DOCUMENT, 8);
+    CHECK(plan.workers == 4);
+    CHECK(plan.storeBytes == (size_t)(16 * MB));
+    CHECK(plan.inflightBytes <= (size_t)(256 * MB));
+}
+
+static void test_plan_thermal() {
+    ParallelGovernor governor;
+    governor.set_store_budget(256 * MB);
+
+    governor.set_reader(fixed(8, 8 * GB, 6 * GB, 2));
+    CHECK(governor.plan(WorkKind::DOCUMENT, 8).workers == 8);
+
+    // Severe halves the workers, critical leaves one.
+    governor.set_reader(fixed(8, 8 * GB, 6 * GB, 3));
+    CHECK(governor.plan(WorkKind::DOCUMENT, 8).workers == 4);
+    governor.set_reader(fixed(8, 8 * GB, 6 * GB, 4));
+    CHECK(governor.plan(WorkKind::DOCUMENT, 8).workers == 1);
+
+    // A status pushed from Kotlin counts like a read one.
+    governor.set_reader(fixed(8, 8 * GB, 6 * GB));
+    governor.set_thermal_status(3);
+    CHECK(governor.plan(WorkKind::DOCUMENT, 8).workers == 4);
+    governor.set_thermal_status(4);
+    CHECK(governor.plan(WorkKind::DOCUMENT, 8).workers == 1);
+    governor.set_thermal_status(0);
+    CHECK(governor.plan(WorkKind::DOCUMENT, 8).workers == 8);
+}
+
+int main() {
+    test_meminfo_with_available();
+    test_meminfo_without_available();
+    test_meminfo_unusable();
+    test_plan_plentiful_memory();
+    test_plan_tight_memory();
+    test_plan_thermal();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("parallel-governor: all checks passed\n");
+    return 0;
+}
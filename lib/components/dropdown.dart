@@ -49,6 +49,10 @@ class _CustomDropdownState extends State<CustomDropdown> {
       "label": "Reorder PDF",
       "icon": Icons.reorder_rounded, // 🔄 reorder icon
     },
+    {
+      "label": "Compress PDF",
+      "icon": Icons.compress_rounded,
+    },
   ];
 
 
@@ -1,12 +1,6 @@
-import 'dart:io';
-import 'dart:typed_data';
 import 'package:intl/intl.dart';
-import 'package:file_saver/file_saver.dart';
 import 'package:flutter/material.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
-import 'package:path/path.dart' as path;
-import 'package:path_provider/path_provider.dart';
-import 'package:blue_pdf/state_providers.dart';
 
 // Add dark theme color palette
 const Color kDarkBg = Color(0xFF101A30);         // Deep navy
@@ -18,10 +12,21 @@ const Color kDarkTeal = Color(0xFF00B8D4);       // Teal accent
 const Color kDarkText = Colors.white;
 const Color kDarkSecondaryText = Color(0xFFB0B8C1);
 
+/// What was picked in [SavePdfOverlay].
+class SavePdfChoice {
+  final String filename;
+  // Share the result under [filename] instead of saving it.
+  final bool shareOnly;
+
+  const SavePdfChoice(this.filename, {this.shareOnly = false});
+}
+
+/// Asks for the output file name; pops with a [SavePdfChoice], or null on
+/// cancel. [canShare] also offers sharing the result without saving it.
 class SavePdfOverlay extends ConsumerStatefulWidget {
-  final Uint8List pdfBytes;
+  final bool canShare;
 
-  const SavePdfOverlay({super.key, required this.pdfBytes});
+  const SavePdfOverlay({super.key, this.canShare = false});
 
   @override
   ConsumerState<SavePdfOverlay> createState() => _SavePdfOverlayState();
@@ -40,7 +45,9 @@ class _SavePdfOverlayState extends ConsumerState<SavePdfOverlay> {
     _filenameController = TextEditingController(text: defaultName);
   }
 
-  Future<void> _saveFile() async {
+  // Only the name is chosen here; the tool then writes its result straight
+  // to the location picked in the system save dialog.
+  void _saveFile({bool shareOnly = false}) {
     final filename = _filenameController.text.trim();
     if (filename.isEmpty) {
       ScaffoldMessenger.of(context).showSnackBar(
@@ -49,75 +56,8 @@ class _SavePdfOverlayState extends ConsumerState<SavePdfOverlay> {
       return;
     }
 
-    showDialog(
-      context: context,
-      barrierDismissible: false,
-      builder: (_) => const Dialog(
-        child: Padding(
-          padding: EdgeInsets.all(20.0),
-          child: Row(
-            mainAxisSize: MainAxisSize.min,
-            children: [
-              CircularProgressIndicator(),
-              SizedBox(width: 20),
-              Text("Saving PDF..."),
-            ],
-          ),
-        ),
-      ),
-    );
-
-    try {
-      final saveToPublicFuture = _saveToPublicDownloads(filename, widget.pdfBytes);
-      final saveToCacheFuture = _saveToAppCache(filename, widget.pdfBytes);
-
-      final results = await Future.wait([
-        saveToPublicFuture,
-        saveToCacheFuture,
-      ]);
-
-      final publicPath = results[0]; // From FileSaver
-      final cachePath = results[1]; // From app's cache
-
-      ref.read(savePathProvider.notifier).state = publicPath;
-      ref.read(cachePathProvider.notifier).state = cachePath;
-
-      final currentList = ref.read(recentFilesProvider);
-      if (publicPath != null && !currentList.contains(publicPath)) {
-        ref.read(recentFilesProvider.notifier).state = [...currentList, publicPath];
-      }
-
-      if (mounted) {
-        Navigator.pop(context); // dismiss loading
-        Navigator.pop(context, true); // return success
-      }
-    } catch (e) {
-      print("❌ Exception during save: $e");
-      if (mounted) {
-        Navigator.pop(context);
-        ScaffoldMessenger.of(context).showSnackBar(
-          SnackBar(content: Text("❌ Failed to save file: $e")),
-        );
-      }
-    }
-  }
-
-  Future<String?> _saveToPublicDownloads(String filename, Uint8List bytes) async {
     final String finalFilename = filename.endsWith('.pdf') ? filename : '$filename.pdf';
-    return await FileSaver.instance.saveAs(
-      name: finalFilename.replaceAll(".pdf", ""),
-      fileExtension: "pdf",
-      bytes: bytes,
-      mimeType: MimeType.pdf,
-    );
-  }
-
-  Future<String> _saveToAppCache(String filename, Uint8List bytes) async {
-    final cacheDir = await getTemporaryDirectory();
-    final String finalFilename = filename.endsWith('.pdf') ? filename : '$filename.pdf';
-    final File file = File(path.join(cacheDir.path, finalFilename));
-    await file.writeAsBytes(bytes);
-    return file.path;
+    Navigator.pop(context, SavePdfChoice(finalFilename, shareOnly: shareOnly));
   }
 
  @override
@@ -183,7 +123,7 @@ class _SavePdfOverlayState extends ConsumerState<SavePdfOverlay> {
                   children: [
                     Expanded(
                       child: OutlinedButton(
-                        onPressed: () => Navigator.pop(context, false),
+                        onPressed: () => Navigator.pop(context),
                         style: OutlinedButton.styleFrom(
                           foregroundColor: isDark ? kDarkAccent : Color(0xFF1976D2),
                           side: BorderSide(color: isDark ? kDarkAccent : Color(0xFF1976D2)),
@@ -210,7 +150,7 @@ class _SavePdfOverlayState extends ConsumerState<SavePdfOverlay> {
                           ],
                         ),
                         child: ElevatedButton.icon(
-                          onPressed: _saveFile,
+                          onPressed: () => _saveFile(),
                           icon: const Icon(Icons.save, color: Colors.white),
                           label: const Text("Save", style: TextStyle(color: Colors.white)),
                           style: ElevatedButton.styleFrom(
@@ -227,6 +167,14 @@ class _SavePdfOverlayState extends ConsumerState<SavePdfOverlay> {
                     ),
                   ],
                 ),
+                if (widget.canShare) ...[
+                  const SizedBox(height: 8),
+                  TextButton.icon(
+                    onPressed: () => _saveFile(shareOnly: true),
+                    icon: Icon(Icons.share, color: isDark ? kDarkAccent : Color(0xFF1976D2)),
+                    label: Text("Share without saving", style: TextStyle(color: isDark ? kDarkAccent : Color(0xFF1976D2))),
+                  ),
+                ],
               ],
             );
           }, // builder
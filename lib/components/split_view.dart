@@ -1,3 +1,4 @@
+import 'dart:async';
 import 'dart:io';
 import 'package:flutter/material.dart';
 import 'package:blue_pdf/tools/render_page.dart';
@@ -29,6 +30,7 @@ class _SplitPdfDialogState extends State<SplitPdfDialog>
   File? endPreview;
   int totalPages = 1;
   bool isLoading = true;
+  final Map<String, int> _previewRequests = {};
 
   late AnimationController _animationController;
   late Animation<double> _fadeAnimation;
@@ -76,23 +78,59 @@ class _SplitPdfDialogState extends State<SplitPdfDialog>
     final page = int.tryParse(controller.text.trim());
     if (page == null || page < 1 || page > totalPages) return;
 
-    try {
-      final path = await renderSinglePage(widget.pdfPath, page);
-      if (!mounted) return;
+    // A newer page number supersedes any render still in flight.
+    final previous = _previewRequests.remove(which);
+    if (previous != null) cancelRender(previous);
 
+    void show(String path) {
+      final file = File(path);
+      if (!mounted) {
+        _deletePreview(file);
+        return;
+      }
+      final File? replaced = which == 'start' ? startPreview : endPreview;
       setState(() {
-        final file = File(path);
         if (which == 'start') {
           startPreview = file;
         } else {
           endPreview = file;
         }
       });
+      // Gone once the frame showing its successor is drawn.
+      if (replaced != null) {
+        WidgetsBinding.instance.addPostFrameCallback((_) => _deletePreview(replaced));
+      }
+    }
+
+    final done = Completer<void>();
+    late final int requestId;
+    requestId = renderPageProgressive(
+      widget.pdfPath,
+      page,
+      profile: 'draft',
+      onCoarse: (path) {
+        show(path);
+        // The draft is enough to dismiss the loading state.
+        if (!done.isCompleted) done.complete();
+      },
+      onRefined: (path) {
+        if (_previewRequests[which] == requestId) _previewRequests.remove(which);
+        show(path);
+      },
+    );
+    _previewRequests[which] = requestId;
+
+    try {
+      await done.future.timeout(const Duration(seconds: 5));
     } catch (e) {
       debugPrint('Preview load error for $which: $e');
     }
   }
 
+  void _deletePreview(File file) {
+    file.delete().catchError((_) => file);
+  }
+
   void _submit() {
     final start = int.tryParse(startController.text.trim());
     final end = int.tryParse(endController.text.trim());
@@ -299,6 +337,12 @@ class _SplitPdfDialogState extends State<SplitPdfDialog>
 
   @override
   void dispose() {
+    for (final requestId in _previewRequests.values) {
+      cancelRender(requestId);
+    }
+    for (final preview in [startPreview, endPreview]) {
+      if (preview != null) _deletePreview(preview);
+    }
     _animationController.dispose();
     startController.dispose();
     endController.dispose();
@@ -12,13 +12,20 @@ import '../components/dropdown.dart';
 import 'process_success_screen.dart';
 import 'about_page.dart';
 import 'package:flutter/material.dart';
+import 'package:flutter/services.dart';
 import 'package:file_picker/file_picker.dart';
 import '../components/save_pdf.dart';
 import 'package:blue_pdf/tools/image_to_pdf.dart';
 import 'package:blue_pdf/tools/merge_pdf.dart';
 import 'package:blue_pdf/tools/split_pdf.dart';
 import 'package:blue_pdf/tools/reorder_pdf.dart';
+import 'package:blue_pdf/tools/optimize_pdf.dart';
+import 'package:blue_pdf/tools/probe_pdf.dart';
+import 'package:blue_pdf/tools/pick_documents.dart';
+import 'package:blue_pdf/tools/jobs.dart';
+import 'package:blue_pdf/tools/result_buffer.dart';
 import 'package:blue_pdf/state_providers.dart';
+import 'package:share_plus/share_plus.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 import '../components/grid_view_overlay.dart';
 
@@ -32,6 +39,10 @@ const Color kDarkTeal = Color(0xFF00B8D4);       // Teal accent
 const Color kDarkText = Colors.white;
 const Color kDarkSecondaryText = Color(0xFFB0B8C1);
 
+// Largest total input that may be shared without saving; the result is then
+// kept in native memory instead of a file.
+const int kShareInMemoryMaxBytes = 8 * 1024 * 1024;
+
 
 class HomeScreen extends ConsumerStatefulWidget {
   const HomeScreen({super.key});
@@ -51,6 +62,7 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
       'Encrypt PDF': encryptPdfFilesProvider,
       'Split PDF': mergePdfFilesProvider, // Use mergePdfFilesProvider for single PDF selection
       'Reorder PDF': reorderPdfFilesProvider,
+      'Compress PDF': compressPdfFilesProvider,
     };
 
   Future<String?> _promptPassword(BuildContext context, {required String action}) async {
@@ -94,14 +106,17 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
     }
 
     ref.read(isProcessingProvider.notifier).state = true;
+    ref.read(jobProgressProvider.notifier).state = null;
 
     // === Show loading dialog immediately ===
+    // Follows the running job: pages done, then bytes saved.
     showDialog(
       context: context,
       barrierDismissible: false,
-      builder: (_) => Builder(
-        builder: (dialogContext) {
+      builder: (_) => Consumer(
+        builder: (dialogContext, ref, _) {
           final isDarkMode = Theme.of(dialogContext).brightness == Brightness.dark;
+          final job = ref.watch(jobProgressProvider);
           return Dialog(
             backgroundColor: isDarkMode ? kDarkCard : Colors.white,
             child: Padding(
@@ -110,6 +125,7 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
                 mainAxisSize: MainAxisSize.min,
                 children: [
                   CircularProgressIndicator(
+                    value: job?.phase == 'pages' ? job!.fraction : null,
                     valueColor: AlwaysStoppedAnimation<Color>(
                       isDarkMode ? kDarkAccent : Colors.blueAccent,
                     ),
@@ -117,7 +133,7 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
                   const SizedBox(width: 20),
                   Flexible(
                     child: Text(
-                      "Processing PDF...", 
+                      _progressText(job),
                       style: TextStyle(
                         fontSize: 16,
                         color: isDarkMode ? kDarkText : Colors.black87,
@@ -135,22 +151,17 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
     // Let UI fully render before native call
     await Future.delayed(const Duration(milliseconds: 200));
 
-    String? initialCachePath;
-
+    // The chosen document until the tool has written its result to it;
+    // deleted if the run fails before that.
+    String? unfinishedOutput;
     try {
-      Uint8List? resultBytes;
       final filePaths = selectedFiles.map((f) => f.path!).toList();
 
-
-      // --- Native processing ---
-      if (selectedTool == 'Merge PDF') {
-        initialCachePath = await mergePdfNative(filePaths);
-      } else if (selectedTool == 'Image to PDF') {
-        final pageSize = ref.read(pageSizeProvider);
-        final pageMode = pageSize == PageSize.a4 ? "A4" : "FIT";
-        initialCachePath = await imageToPdfNative(filePaths, pageMode);
-      } else if (selectedTool == 'Encrypt PDF') {
-        final password = await _promptPassword(context, action: "Encrypt");
+      // --- Tool options ---
+      String? password;
+      List<int>? pages;
+      if (selectedTool == 'Encrypt PDF') {
+        password = await _promptPassword(context, action: "Encrypt");
         if (password == null || password.isEmpty) {
           if (context.mounted) {
             ScaffoldMessenger.of(context).showSnackBar(
@@ -164,7 +175,6 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
           }
           return; // ✅ this exits the try block and the function
         }
-        initialCachePath = await encryptPdfNative(filePaths.first, password); 
       } else if (selectedTool == 'Split PDF') {
         // Prompt for page range
         final range = await SplitPdfDialog.show(context, filePaths.first);
@@ -175,66 +185,119 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
         }
         final start = range['start']!;
         final end = range['end']!;
-        final pages = [for (int i = start; i <= end; i++) i];
-        final outputPaths = await splitPdfNative(filePaths.first, pages);
-        // For consistency, set initialCachePath to the first output (or handle as needed)
-        initialCachePath = outputPaths;
-      } else if (selectedTool == 'Reorder PDF') {
-        initialCachePath = await mergePdfNative(filePaths);
+        pages = [for (int i = start; i <= end; i++) i];
       }
 
-      if (initialCachePath == null) {
-        throw Exception("Failed to create temporary PDF file.");
-      }
-
-      final tempFile = File(initialCachePath);
-      if (await tempFile.exists()) {
-        resultBytes = await tempFile.readAsBytes();
-      } else {
-        throw Exception("Temporary file not found at $initialCachePath");
-      }
-
-      ref.read(mergedPdfBytesProvider.notifier).state = resultBytes;
-
-      // Dismiss loading dialog before save screen
-      if (context.mounted) Navigator.pop(context);
-
-      final bool? didSave = await showModalBottomSheet<bool>(
+      // --- Destination ---
+      // Chosen up front so the tool writes its result there directly
+      // instead of to the cache and then again through Dart. Small results
+      // that are only shared stay in native memory.
+      final inputBytes = selectedFiles.fold<int>(0, (sum, f) => sum + f.size);
+      final SavePdfChoice? choice = await showModalBottomSheet<SavePdfChoice>(
         context: context,
         isScrollControlled: true,
         backgroundColor: Colors.transparent,
-        builder: (_) => SavePdfOverlay(
-          pdfBytes: resultBytes!,
-        ),
+        builder: (_) => SavePdfOverlay(canShare: inputBytes <= kShareInMemoryMaxBytes),
       );
+      final String? output = choice == null
+          ? null
+          : choice.shareOnly
+              ? memoryOutput
+              : await createDocument(choice.filename);
+      if (output == null) {
+        // Dismiss loading dialog
+        if (context.mounted) Navigator.pop(context);
+        return;
+      }
+      if (output != memoryOutput) unfinishedOutput = output;
 
-      if (didSave != true) {
-        if (await tempFile.exists()) {
-          await tempFile.delete();
-          print("Save cancelled. Temp file deleted: $initialCachePath");
+      // --- Native processing ---
+      void onProgress(PdfJobStatus job) => ref.read(jobProgressProvider.notifier).state = job;
+      // Encrypted inputs are unlocked in memory; ask for their password
+      // when the tool reports one is needed, then run it again.
+      String? inputPassword;
+      String result;
+      while (true) {
+        try {
+          if (selectedTool == 'Merge PDF') {
+            result = await mergePdfNative(filePaths,
+                output: output, password: inputPassword, objectStreams: true, onProgress: onProgress);
+          } else if (selectedTool == 'Image to PDF') {
+            final pageSize = ref.read(pageSizeProvider);
+            final pageMode = pageSize == PageSize.a4 ? "A4" : "FIT";
+            result = await imageToPdfNative(filePaths, pageMode, output: output, onProgress: onProgress);
+          } else if (selectedTool == 'Encrypt PDF') {
+            result = await encryptPdfNative(filePaths.first, password!, output: output, onProgress: onProgress);
+          } else if (selectedTool == 'Split PDF') {
+            // A few pages rarely need whole embedded fonts.
+            result = await splitPdfNative(filePaths.first, pages!,
+                output: output,
+                password: inputPassword,
+                objectStreams: true,
+                subsetFonts: true,
+                onProgress: onProgress);
+          } else if (selectedTool == 'Reorder PDF') {
+            result = await mergePdfNative(filePaths,
+                output: output, password: inputPassword, objectStreams: true, onProgress: onProgress);
+          } else if (selectedTool == 'Compress PDF') {
+            result = (await optimizePdfNative(filePaths.first,
+                    output: output, password: inputPassword, onProgress: onProgress))
+                .path;
+          } else {
+            throw Exception('Unknown tool $selectedTool');
+          }
+          break;
+        } on PlatformException catch (e) {
+          if (e.code != 'PASSWORD_REQUIRED' && e.code != 'WRONG_PASSWORD') rethrow;
+          inputPassword = await _promptPassword(context, action: "Unlock");
+          // The failed runs left the document in place for the retry.
+          if (inputPassword == null || inputPassword.isEmpty) rethrow;
+        }
+      }
+      unfinishedOutput = null;
+
+      if (isResultBuffer(result)) {
+        final Uint8List bytes;
+        try {
+          bytes = takeResultBuffer(result);
+        } finally {
+          await releaseJobResults([result]);
         }
+        // Dismiss loading dialog before the share sheet
+        if (context.mounted) Navigator.pop(context);
+        await SharePlus.instance.share(
+          ShareParams(
+            files: [XFile.fromData(bytes, mimeType: 'application/pdf')],
+            fileNameOverrides: [choice!.filename],
+          ),
+        );
         return;
       }
 
-      final outputPath = ref.read(savePathProvider);
-      if (outputPath == null || outputPath.isEmpty) {
-        throw Exception("Save path is missing after successful save.");
-      }
+      final saved = await describeDocument(output);
+      ref.read(savePathProvider.notifier).state = output;
+      ref.read(cachePathProvider.notifier).state = output;
 
       final recent = ref.read(recentFilesProvider);
-      final updated = [outputPath, ...recent].toSet().toList();
+      final updated = [output, ...recent].toSet().toList();
       ref.read(recentFilesProvider.notifier).state = updated.take(4).toList();
 
+      // Dismiss loading dialog before the success screen
+      if (context.mounted) Navigator.pop(context);
+
       Navigator.push(
         context,
         MaterialPageRoute(
           builder: (_) => ProcessSuccessScreen(
-            resultPath: outputPath,
+            resultPath: output,
+            resultName: saved.name,
+            resultSize: saved.size,
           ),
         ),
       );
     } catch (e) {
       print("Error in _processFiles: ${e.toString()}");
+      if (unfinishedOutput != null) await deleteDocument(unfinishedOutput);
 
       // Make sure to close the spinner in case of error
       if (context.mounted) Navigator.pop(context);
@@ -244,6 +307,23 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
       );
     } finally {
       ref.read(isProcessingProvider.notifier).state = false;
+      ref.read(jobProgressProvider.notifier).state = null;
+    }
+  }
+
+  static String _progressText(PdfJobStatus? job) {
+    if (job == null || job.state == 'queued') return "Processing PDF...";
+    switch (job.phase) {
+      case 'pages':
+        return job.progressMax > 0
+            ? "Processing page ${job.progress} of ${job.progressMax}..."
+            : "Processing PDF...";
+      case 'write':
+        if (job.bytes <= 0) return "Saving PDF...";
+        final mb = job.bytes / (1024 * 1024);
+        return "Saving PDF... ${mb.toStringAsFixed(1)} MB";
+      default:
+        return "Opening PDF...";
     }
   }
 
@@ -262,12 +342,7 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
 
       switch (selectedTool) {
         case 'Merge PDF':
-          result = await FilePicker.platform.pickFiles(
-            type: FileType.custom,
-            allowedExtensions: ['pdf'],
-            allowMultiple: true,
-            withData: false,
-          );
+          result = FilePickerResult(await pickDocuments(allowMultiple: true));
           break;
 
         case 'Image to PDF':
@@ -279,30 +354,19 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
           break;
 
         case 'Encrypt PDF':
-          result = await FilePicker.platform.pickFiles(
-            type: FileType.custom,
-            allowedExtensions: ['pdf'],
-            allowMultiple: false,
-            withData: false,
-          );
+          result = FilePickerResult(await pickDocuments());
           break;
 
         case 'Split PDF':
-          result = await FilePicker.platform.pickFiles(
-            type: FileType.custom,
-            allowedExtensions: ['pdf'],
-            allowMultiple: false,
-            withData: false,
-          );
+          result = FilePickerResult(await pickDocuments());
           break;
           
         case 'Reorder PDF':
-          result = await FilePicker.platform.pickFiles(
-            type: FileType.custom,
-            allowedExtensions: ['pdf'],
-            allowMultiple: false,
-            withData: false,
-          );
+          result = FilePickerResult(await pickDocuments());
+          break;
+
+        case 'Compress PDF':
+          result = FilePickerResult(await pickDocuments());
           break;
       }
 
@@ -349,9 +413,31 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
 
         // ✅ Add files to provider
         switch (selectedTool) {
-          case 'Merge PDF':
-            ref.read(mergePdfFilesProvider.notifier).addFiles(result.files);
+          case 'Merge PDF': {
+            // Validate the whole selection in one native call.
+            final probes = await probePdfs(
+              result.files.map((f) => f.path!).toList(),
+              pageSizes: false,
+            );
+            // Probes keep the selection's order; their paths are the
+            // descriptors content URIs were opened as. Encrypted files are
+            // kept: merging asks for their password.
+            final accepted = [
+              for (var i = 0; i < result.files.length; i++)
+                if (probes[i].isUsable || probes[i].isLocked) result.files[i],
+            ];
+            final skipped = result.files.length - accepted.length;
+            if (skipped > 0 && context.mounted) {
+              ScaffoldMessenger.of(context).showSnackBar(
+                SnackBar(
+                  content: Text("Skipped $skipped unreadable PDF(s)."),
+                  duration: const Duration(seconds: 2),
+                ),
+              );
+            }
+            ref.read(mergePdfFilesProvider.notifier).addFiles(accepted);
             break;
+          }
           case 'Image to PDF':
             ref.read(imageToPdfFilesProvider.notifier).addFiles(result.files);
             break;
@@ -361,11 +447,26 @@ class _HomeScreenState extends ConsumerState<HomeScreen> {
           case 'Split PDF':
             ref.read(mergePdfFilesProvider.notifier).addFiles(result.files);
             break;
+          case 'Compress PDF':
+            ref.read(compressPdfFilesProvider.notifier).addFiles(result.files);
+            break;
           case 'Reorder PDF':
             if (result.files.isNotEmpty) {
               try {
-                // Convert PDF to images and add to provider
-                final imagePaths = await reorderPdfNative(result.files.first.path!);
+                // Convert PDF to images and add to provider. An encrypted
+                // PDF is split with the password the user gives.
+                String? password;
+                late final List<String> imagePaths;
+                while (true) {
+                  try {
+                    imagePaths = await reorderPdfNative(result.files.first.path!, password: password);
+                    break;
+                  } on PlatformException catch (e) {
+                    if (e.code != 'PASSWORD_REQUIRED' && e.code != 'WRONG_PASSWORD') rethrow;
+                    password = await _promptPassword(context, action: "Unlock");
+                    if (password == null || password.isEmpty) rethrow;
+                  }
+                }
                 final imageFiles = imagePaths.map((path) => PlatformFile(
                   name: path.split('/').last,
                   path: path,
@@ -6,6 +6,8 @@ import 'about_page.dart';  // adjust as per your project structure
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 import 'package:open_filex/open_filex.dart';
 import 'package:path_provider/path_provider.dart';
+import 'package:blue_pdf/tools/pick_documents.dart';
+import 'package:blue_pdf/tools/jobs.dart';
 
 // Responsive helper: returns true if device is a tablet (width > 600dp)
 bool isTablet(BuildContext context) {
@@ -15,8 +17,16 @@ bool isTablet(BuildContext context) {
 
 class ProcessSuccessScreen extends ConsumerStatefulWidget {
   final String resultPath;
+  // Shown instead of resultPath when the result is a content URI.
+  final String? resultName;
+  final int? resultSize;
 
-  const ProcessSuccessScreen({super.key, required this.resultPath});
+  const ProcessSuccessScreen({
+    super.key,
+    required this.resultPath,
+    this.resultName,
+    this.resultSize,
+  });
 
   @override
   ConsumerState<ProcessSuccessScreen> createState() => _ProcessSuccessScreenState();
@@ -54,8 +64,8 @@ class _ProcessSuccessScreenState extends ConsumerState<ProcessSuccessScreen> {
 
   String _getFileSize(String path) {
     try {
-      final file = File(path);
-      final sizeInBytes = file.lengthSync();
+      final known = widget.resultSize;
+      final sizeInBytes = known != null && known >= 0 ? known : File(path).lengthSync();
       final sizeInKB = (sizeInBytes / 1024).toStringAsFixed(1);
       return "$sizeInKB KB";
     } catch (_) {
@@ -84,7 +94,10 @@ class _ProcessSuccessScreenState extends ConsumerState<ProcessSuccessScreen> {
       ref.read(imageToPdfFilesProvider.notifier).clear();
       ref.read(encryptPdfFilesProvider.notifier).clear();
       ref.read(splitPdfFilesProvider.notifier).clear();
+      // The split pages reorder merged are native job results.
+      releaseJobResults([for (final f in ref.read(reorderPdfFilesProvider)) f.path!]);
       ref.read(reorderPdfFilesProvider.notifier).clear();
+      ref.read(compressPdfFilesProvider.notifier).clear();
     });
 
     final fileSize = _getFileSize(widget.resultPath);
@@ -233,7 +246,7 @@ class _ProcessSuccessScreenState extends ConsumerState<ProcessSuccessScreen> {
                                 crossAxisAlignment: CrossAxisAlignment.start,
                                 children: [
                                   Text(
-                                    widget.resultPath,
+                                    widget.resultName ?? widget.resultPath,
                                     style: TextStyle(
                                       fontSize: cardFont,
                                       fontWeight: FontWeight.w600,
@@ -286,6 +299,18 @@ class _ProcessSuccessScreenState extends ConsumerState<ProcessSuccessScreen> {
                                 icon: Icon(Icons.picture_as_pdf_rounded, color: Colors.white, size: buttonIcon),
                                 label: Text("Preview", style: TextStyle(fontSize: buttonFont, color: Colors.white, fontWeight: FontWeight.w500)),
                                 onPressed: () async {
+                                  if (cachePath.startsWith('content://')) {
+                                    try {
+                                      await viewDocument(cachePath);
+                                    } catch (e) {
+                                      print('❌ Could not open document: $e');
+                                      ScaffoldMessenger.of(context).showSnackBar(
+                                        const SnackBar(content: Text("Failed to open PDF viewer.")),
+                                      );
+                                    }
+                                    return;
+                                  }
+
                                   final file = File(cachePath);
 
                                   if (await file.exists()) {
@@ -345,6 +370,15 @@ class _ProcessSuccessScreenState extends ConsumerState<ProcessSuccessScreen> {
                                 icon: Icon(Icons.share, color: Colors.white, size: buttonIcon),
                                 label: Text("Share", style: TextStyle(fontSize: buttonFont, color: Colors.white, fontWeight: FontWeight.w500)),
                                 onPressed: () async {
+                                  if (cachePath.startsWith('content://')) {
+                                    try {
+                                      await shareDocument(cachePath);
+                                    } catch (e) {
+                                      print('❌ Share failed: ${e}');
+                                    }
+                                    return;
+                                  }
+
                                   final file = File(cachePath);
                                   if (await file.exists()) {
                                     try {
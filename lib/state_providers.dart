@@ -1,9 +1,8 @@
-import 'dart:io';
-import 'dart:typed_data';
 import 'package:flutter/material.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 import 'package:file_picker/file_picker.dart';
 import 'package:shared_preferences/shared_preferences.dart';
+import 'package:blue_pdf/tools/jobs.dart';
 enum ViewMode { list, grid }
 
 // Page size enum for Image to PDF
@@ -13,8 +12,9 @@ var selectedToolProvider = StateProvider<String?>((ref) => null);
 var recentFilesProvider = StateProvider<List<String>>((ref) => []);
 var isFileLoadingProvider = StateProvider<bool>((ref) => false);
 final isProcessingProvider = StateProvider<bool>((ref) => false);
+// Latest update of the job behind the processing dialog.
+final jobProgressProvider = StateProvider<PdfJobStatus?>((ref) => null);
 final savePathProvider = StateProvider<String?>((ref) => null);
-final mergedPdfBytesProvider = StateProvider<Uint8List?>((ref) => null);
 final cachePathProvider = StateProvider<String?>((ref) => null);
 final viewModeProvider = StateProvider<ViewMode>((ref) => ViewMode.list);
 final pageSizeProvider = StateProvider<PageSize>((ref) => PageSize.a4);
@@ -67,6 +67,10 @@ final reorderPdfFilesProvider =
     StateNotifierProvider<SelectedFilesNotifier, List<PlatformFile>>(
         (ref) => SelectedFilesNotifier());
 
+final compressPdfFilesProvider =
+    StateNotifierProvider<SelectedFilesNotifier, List<PlatformFile>>(
+        (ref) => SelectedFilesNotifier());
+
 class SelectedFilesNotifier extends StateNotifier<List<PlatformFile>> {
   SelectedFilesNotifier() : super([]);
 
@@ -74,33 +78,10 @@ class SelectedFilesNotifier extends StateNotifier<List<PlatformFile>> {
     state = files;
   }
 
-  void addFiles(List<PlatformFile> files) async {
-    // Show file names immediately
+  // Files are passed to native code by path or content URI and never read
+  // into Dart.
+  void addFiles(List<PlatformFile> files) {
     state = [...state, ...files];
-
-    // Start background loading of bytes
-    for (int i = 0; i < files.length; i++) {
-      final file = files[i];
-      if (file.path != null) {
-        final fileData = await File(file.path!).readAsBytes();
-
-        final updatedFile = PlatformFile(
-          name: file.name,
-          path: file.path,
-          bytes: fileData,
-          size: fileData.length,
-        );
-
-        // Update only the one file in state (preserving index order)
-        state = [
-          for (int j = 0; j < state.length; j++)
-            if (j == state.length - files.length + i)
-              updatedFile
-            else
-              state[j],
-        ];
-      }
-    }
   }
 
   void removeFileAt(int index) {
@@ -2,7 +2,11 @@ import 'package:flutter/services.dart';
 
 const _channel = MethodChannel('com.bluepdf.channel/pdf');
 
-Future<int> getPdfPageCount(String path) async {
-  final count = await _channel.invokeMethod<int>('getPdfPageCount', {'pdfPath': path});
+/// [password] lets the page tree of an encrypted file be counted.
+Future<int> getPdfPageCount(String path, {String? password}) async {
+  final count = await _channel.invokeMethod<int>('getPdfPageCount', {
+    'pdfPath': path,
+    if (password != null) 'password': password,
+  });
   return count ?? 1;
 }
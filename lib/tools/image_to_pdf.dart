@@ -1,15 +1,35 @@
 import 'package:flutter/services.dart';
 
+import 'jobs.dart';
+
 const _channel = MethodChannel('com.bluepdf.channel/pdf');
 
-Future<String> imageToPdfNative(List<String> imagePaths, String pageMode) async {
+/// Writes to [output] (a path or content URI) when given, otherwise to
+/// the app cache. Returns where the result was written, or a memory handle
+/// when [output] is `'mem:'` (see result_buffer.dart). [onProgress] gets
+/// the job's updates while it runs. [linearize] writes a linearized
+/// ("Fast Web View") file, whose first page a viewer can show before the
+/// rest has downloaded; writing it takes about twice as long.
+Future<String> imageToPdfNative(
+  List<String> imagePaths,
+  String pageMode, {
+  String? output,
+  bool linearize = false,
+  void Function(PdfJobStatus status)? onProgress,
+}) async {
   try {
-    final String? filePath = await _channel.invokeMethod<String>(
-      'imageToPdf',
-      {
-        'paths': imagePaths,
-        'pageMode': pageMode // either "A4" or "FIT"
-      },
+    final String? filePath = await withJobProgress(
+      onProgress,
+      (tag) => _channel.invokeMethod<String>(
+        'imageToPdf',
+        {
+          'paths': imagePaths,
+          'pageMode': pageMode, // either "A4" or "FIT"
+          'linearize': linearize,
+          if (output != null) 'output': output,
+          if (tag != null) 'tag': tag,
+        },
+      ),
     );
     if (filePath == null || filePath.isEmpty) {
       throw Exception('Failed to generate PDF from images.');
@@ -0,0 +1,123 @@
+import 'dart:convert';
+import 'package:flutter/services.dart';
+
+const _channel = MethodChannel('com.bluepdf.channel/pdf');
+const _progressChannel = EventChannel('com.bluepdf.channel/progress');
+
+/// Snapshot of a background job started with [submitJob].
+class PdfJobStatus {
+  final int id;
+  final String type;
+
+  /// 'queued', 'running', 'done', 'failed' or 'cancelled'.
+  final String state;
+
+  /// What a running job is at: 'open' (reading an input), 'pages' or
+  /// 'write' (saving the output).
+  final String phase;
+
+  /// Pages done out of [progressMax]; a merge only learns the page count of
+  /// each input as it gets there.
+  final int progress;
+  final int progressMax;
+
+  /// Output bytes written so far. Stays 0 for 'mem:' outputs.
+  final int bytes;
+
+  /// The tag of the tool call that started the job, if it had one.
+  final String? tag;
+
+  /// Where the output was written (or a 'mem:' handle) once done.
+  final String? result;
+  final String? error;
+
+  PdfJobStatus.fromJson(Map<String, dynamic> json)
+      : id = json['id'] as int,
+        type = json['type'] as String,
+        state = json['state'] as String,
+        phase = json['phase'] as String? ?? 'open',
+        progress = json['progress'] as int,
+        progressMax = json['progressMax'] as int,
+        bytes = json['bytes'] as int? ?? 0,
+        tag = json['tag'] as String?,
+        result = json['result'] as String?,
+        error = json['error'] as String?;
+
+  bool get isFinished => state == 'done' || state == 'failed' || state == 'cancelled';
+
+  /// Share of pages done, or null while the page count is unknown.
+  double? get fraction => progressMax > 0 ? (progress / progressMax).clamp(0.0, 1.0) : null;
+}
+
+/// State changes of every job as they happen, plus progress while one runs
+/// (at most every 100 ms per job).
+final Stream<PdfJobStatus> jobUpdates = _progressChannel
+    .receiveBroadcastStream()
+    .map((event) => PdfJobStatus.fromJson(jsonDecode(event as String)));
+
+int _nextTag = 0;
+
+/// Runs [call] with a fresh tag for its arguments and hands [onProgress]
+/// the updates of the job started under that tag. Without [onProgress]
+/// [call] gets no tag and nothing is listened to.
+Future<T> withJobProgress<T>(
+  void Function(PdfJobStatus status)? onProgress,
+  Future<T> Function(String? tag) call,
+) async {
+  if (onProgress == null) return call(null);
+
+  final tag = 'job-${_nextTag++}';
+  final subscription = jobUpdates.where((status) => status.tag == tag).listen(onProgress);
+  try {
+    return await call(tag);
+  } finally {
+    await subscription.cancel();
+  }
+}
+
+/// Starts [type] ('imageToPdf', 'merge', 'split', 'encrypt' or
+/// 'renderPage') in the background and returns its id at once. [arguments]
+/// are those of the matching tool call. Without an 'output' the result goes
+/// into the job's own directory, which lasts until [releaseJob].
+Future<int> submitJob(String type, Map<String, Object?> arguments) async {
+  try {
+    final int? id = await _channel.invokeMethod<int>(
+      'submitJob',
+      {...arguments, 'type': type},
+    );
+    if (id == null) {
+      throw Exception('Failed to start $type job.');
+    }
+    return id;
+  } on PlatformException catch (e) {
+    print("submitJob failed: ${e.message}");
+    rethrow;
+  }
+}
+
+/// A queued job is dropped; a running one stops at its next page. Returns
+/// false when the job had already finished.
+Future<bool> cancelJob(int id) async {
+  return await _channel.invokeMethod<bool>('cancelJob', {'jobId': id}) ?? false;
+}
+
+/// Null once the job has been released.
+Future<PdfJobStatus?> getJobStatus(int id) async {
+  final String? status = await _channel.invokeMethod<String>('getJobStatus', {'jobId': id});
+  if (status == null) return null;
+  return PdfJobStatus.fromJson(jsonDecode(status));
+}
+
+/// Forgets a job and deletes its directory, cancelling it first if needed.
+/// Outputs written elsewhere are kept.
+Future<void> releaseJob(int id) async {
+  await _channel.invokeMethod('releaseJob', {'jobId': id});
+}
+
+/// Deletes results that tool calls without an output left in their job
+/// directories (rendered pages, reorder's split pages), given by the
+/// paths the calls returned, once nothing shows or reads them any more.
+Future<void> releaseJobResults(List<String> paths) async {
+  if (paths.isEmpty) return;
+  await _channel.invokeMethod('releaseJobResults', {'paths': paths});
+}
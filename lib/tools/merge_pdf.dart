@@ -1,13 +1,45 @@
 import 'package:flutter/services.dart';
+
+import 'jobs.dart';
+
 const _channel = MethodChannel('com.bluepdf.channel/pdf');
 
-Future<String> mergePdfNative(List<String> pdfPaths) async {
+/// Writes to [output] (a path or content URI) when given, otherwise to
+/// the app cache. Returns where the result was written, or a memory handle
+/// when [output] is `'mem:'` (see result_buffer.dart). [onProgress] gets
+/// the job's updates while it runs. [password] unlocks encrypted inputs
+/// in memory, without writing decrypted copies first. [objectStreams]
+/// packs objects into compressed object streams with an xref stream,
+/// which makes the file smaller and quicker to open. [linearize] writes a
+/// linearized ("Fast Web View") file instead, whose first page a viewer
+/// can show before the rest has downloaded.
+/// [subsetFonts] keeps only the glyphs the written pages use of each
+/// embedded font, so a few pages from a file with large CJK fonts come to
+/// kilobytes instead of megabytes.
+Future<String> mergePdfNative(
+  List<String> pdfPaths, {
+  String? output,
+  String? password,
+  bool objectStreams = false,
+  bool linearize = false,
+  bool subsetFonts = false,
+  void Function(PdfJobStatus status)? onProgress,
+}) async {
   try {
-    final String? filePath = await _channel.invokeMethod<String>(
-      'mergePdf',
-      {
-        'paths': pdfPaths,
-      },
+    final String? filePath = await withJobProgress(
+      onProgress,
+      (tag) => _channel.invokeMethod<String>(
+        'mergePdf',
+        {
+          'paths': pdfPaths,
+          if (output != null) 'output': output,
+          if (password != null) 'password': password,
+          'objectStreams': objectStreams,
+          'linearize': linearize,
+          'subsetFonts': subsetFonts,
+          if (tag != null) 'tag': tag,
+        },
+      ),
     );
     if (filePath == null || filePath.isEmpty) {
       throw Exception('Failed to merge PDFs.');
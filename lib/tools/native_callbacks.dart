@@ -0,0 +1,17 @@
+import 'package:flutter/services.dart';
+
+const _channel = MethodChannel('com.bluepdf.channel/pdf');
+
+final Map<String, void Function(dynamic arguments)> _handlers = {};
+
+/// Routes calls that native code makes on the shared channel to [handler]
+/// by method name. The channel holds a single handler, so every callback
+/// registers here instead of setting its own.
+void onNativeCallback(String method, void Function(dynamic arguments) handler) {
+  if (_handlers.isEmpty) {
+    _channel.setMethodCallHandler((call) async {
+      _handlers[call.method]?.call(call.arguments);
+    });
+  }
+  _handlers[method] = handler;
+}
@@ -0,0 +1,99 @@
+import 'dart:convert';
+
+import 'package:flutter/services.dart';
+
+import 'jobs.dart';
+
+const _channel = MethodChannel('com.bluepdf.channel/pdf');
+
+/// How hard [optimizePdfNative] shrinks images. Images placed above a
+/// preset's threshold resolution are subsampled and recompressed:
+///
+/// * `light`: color and gray above 300 DPI to 200, recompressed as before.
+/// * `balanced`: above 225 DPI to 150, JPEG quality 70, fax for bitonal.
+/// * `strong`: above 150 DPI to 100, JPEG quality 50, fax for bitonal.
+/// * `compact`: like balanced, with JPEG 2000 instead of JPEG.
+const optimizePresets = ['light', 'balanced', 'strong', 'compact'];
+
+/// Stored bytes of one class of images before and after optimizing.
+class ImageSavings {
+  final int count;
+  final int before;
+  final int after;
+
+  const ImageSavings(this.count, this.before, this.after);
+
+  factory ImageSavings.fromJson(Map<String, dynamic>? json) => ImageSavings(
+        json?['count'] as int? ?? 0,
+        json?['before'] as int? ?? 0,
+        json?['after'] as int? ?? 0,
+      );
+}
+
+/// Where an optimized copy was written and what it saved.
+class OptimizeResult {
+  final String path;
+  final String preset;
+  final int outputBytes;
+  final ImageSavings color;
+  final ImageSavings gray;
+  final ImageSavings bitonal;
+
+  const OptimizeResult({
+    required this.path,
+    required this.preset,
+    required this.outputBytes,
+    required this.color,
+    required this.gray,
+    required this.bitonal,
+  });
+
+  factory OptimizeResult.fromJson(Map<String, dynamic> json) => OptimizeResult(
+        path: json['path'] as String,
+        preset: json['preset'] as String? ?? '',
+        outputBytes: json['outputBytes'] as int? ?? -1,
+        color: ImageSavings.fromJson(json['color'] as Map<String, dynamic>?),
+        gray: ImageSavings.fromJson(json['gray'] as Map<String, dynamic>?),
+        bitonal: ImageSavings.fromJson(json['bitonal'] as Map<String, dynamic>?),
+      );
+}
+
+/// Writes a copy of [inputPath] with its images shrunk as [preset] (one
+/// of [optimizePresets]) says to [output] (a path or content URI) when
+/// given, otherwise to the app cache. [onProgress] gets the job's updates
+/// while it runs. [password] unlocks an encrypted input in memory; the
+/// copy keeps its encryption. [linearize] writes a linearized ("Fast Web
+/// View") copy instead of packing objects into object streams. MuPDF
+/// rewrites one file's images on a single thread.
+Future<OptimizeResult> optimizePdfNative(
+  String inputPath, {
+  String preset = 'balanced',
+  String? output,
+  String? password,
+  bool linearize = false,
+  void Function(PdfJobStatus status)? onProgress,
+}) async {
+  try {
+    final String? report = await withJobProgress(
+      onProgress,
+      (tag) => _channel.invokeMethod<String>(
+        'optimizePdf',
+        {
+          'path': inputPath,
+          'preset': preset,
+          'linearize': linearize,
+          if (output != null) 'output': output,
+          if (password != null) 'password': password,
+          if (tag != null) 'tag': tag,
+        },
+      ),
+    );
+    if (report == null || report.isEmpty) {
+      throw Exception('Failed to optimize PDF.');
+    }
+    return OptimizeResult.fromJson(jsonDecode(report) as Map<String, dynamic>);
+  } on PlatformException catch (e) {
+    print("optimizePdfNative failed: ${e.message}");
+    rethrow;
+  }
+}
@@ -1,15 +1,47 @@
 import 'package:flutter/services.dart';
 
+import 'jobs.dart';
+
 const _channel = MethodChannel('com.bluepdf.channel/pdf');
 
-Future<String> encryptPdfNative(String inputPath, String password) async {
+/// Writes to [output] (a path or content URI) when given, otherwise to
+/// the app cache. Returns where the result was written, or a memory handle
+/// when [output] is `'mem:'` (see result_buffer.dart). [onProgress] gets
+/// the job's updates while it runs.
+///
+/// By default objects are copied as they are and only encrypted. [clean]
+/// also drops unused objects and cleans and sanitizes every page's
+/// content, which is much slower on large documents.
+///
+/// An already encrypted input is re-encrypted with [password] once
+/// [currentPassword] unlocks it.
+///
+/// [linearize] writes a linearized ("Fast Web View") file, whose first
+/// page a viewer can show before the rest has downloaded.
+Future<String> encryptPdfNative(
+  String inputPath,
+  String password, {
+  String? output,
+  bool clean = false,
+  bool linearize = false,
+  String? currentPassword,
+  void Function(PdfJobStatus status)? onProgress,
+}) async {
   try {
-    final String? filePath = await _channel.invokeMethod<String>(
-      'encryptPdf',
-      {
-        'path': inputPath,
-        'password': password,
-      },
+    final String? filePath = await withJobProgress(
+      onProgress,
+      (tag) => _channel.invokeMethod<String>(
+        'encryptPdf',
+        {
+          'path': inputPath,
+          'password': password,
+          'clean': clean,
+          'linearize': linearize,
+          if (currentPassword != null) 'currentPassword': currentPassword,
+          if (output != null) 'output': output,
+          if (tag != null) 'tag': tag,
+        },
+      ),
     );
     if (filePath == null || filePath.isEmpty) {
       throw Exception('Failed to encrypt PDF.');
@@ -22,6 +54,8 @@ Future<String> encryptPdfNative(String inputPath, String password) async {
     switch (e.code) {
       case 'ALREADY_ENCRYPTED':
         throw Exception('PDF is already encrypted');
+      case 'WRONG_PASSWORD':
+        throw Exception('Incorrect current password');
       case 'ENCRYPTION_FAILED':
         throw Exception('Failed to encrypt PDF: ${e.message ?? 'Unknown encryption error'}');
       case 'CONTEXT_FAILED':
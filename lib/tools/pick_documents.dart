@@ -0,0 +1,79 @@
+import 'package:file_picker/file_picker.dart';
+import 'package:flutter/services.dart';
+
+const _channel = MethodChannel('com.bluepdf.channel/pdf');
+
+/// Opens the system document picker. Each file's [PlatformFile.path] is its
+/// content URI, which every native tool accepts, so nothing is copied into
+/// the app cache. Read access to the URIs is kept across restarts.
+Future<List<PlatformFile>> pickDocuments({
+  bool allowMultiple = false,
+  String mimeType = 'application/pdf',
+}) async {
+  try {
+    final List<dynamic>? picked = await _channel.invokeMethod<List<dynamic>>(
+      'pickDocuments',
+      {
+        'allowMultiple': allowMultiple,
+        'mimeType': mimeType,
+      },
+    );
+    return (picked ?? const [])
+        .map((entry) => entry as Map<dynamic, dynamic>)
+        .map((entry) => PlatformFile(
+              name: entry['name'] as String? ?? 'document.pdf',
+              path: entry['uri'] as String,
+              size: entry['size'] as int? ?? -1,
+            ))
+        .toList();
+  } on PlatformException catch (e) {
+    print("pickDocuments failed: ${e.message}");
+    rethrow;
+  }
+}
+
+/// Opens the system save dialog suggesting [name]. Returns the content URI
+/// the user chose, or null when the dialog was cancelled. Native tools
+/// write their result straight to this URI.
+Future<String?> createDocument(String name, {String mimeType = 'application/pdf'}) async {
+  try {
+    return await _channel.invokeMethod<String>(
+      'createDocument',
+      {
+        'name': name,
+        'mimeType': mimeType,
+      },
+    );
+  } on PlatformException catch (e) {
+    print("createDocument failed: ${e.message}");
+    rethrow;
+  }
+}
+
+/// Deletes a document from [createDocument] that no result was written to.
+Future<void> deleteDocument(String uri) {
+  return _channel.invokeMethod('deleteDocument', {'uri': uri});
+}
+
+/// Display name and size of the document behind a content URI.
+Future<PlatformFile> describeDocument(String uri) async {
+  final Map<dynamic, dynamic>? info = await _channel.invokeMethod<Map<dynamic, dynamic>>(
+    'describeDocument',
+    {'uri': uri},
+  );
+  return PlatformFile(
+    name: info?['name'] as String? ?? uri.split('/').last,
+    path: uri,
+    size: info?['size'] as int? ?? -1,
+  );
+}
+
+/// Opens a content URI in a viewer app.
+Future<void> viewDocument(String uri, {String mimeType = 'application/pdf'}) {
+  return _channel.invokeMethod('viewDocument', {'uri': uri, 'mimeType': mimeType});
+}
+
+/// Shares a content URI through the system share sheet.
+Future<void> shareDocument(String uri, {String mimeType = 'application/pdf'}) {
+  return _channel.invokeMethod('shareDocument', {'uri': uri, 'mimeType': mimeType});
+}
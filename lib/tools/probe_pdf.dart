@@ -0,0 +1,140 @@
+import 'dart:convert';
+
+import 'package:flutter/services.dart';
+
+const _channel = MethodChannel('com.bluepdf.channel/pdf');
+
+/// Pages in a row sharing one size, in points.
+class PageSizeRun {
+  final double width;
+  final double height;
+  final int count;
+
+  const PageSizeRun(this.width, this.height, this.count);
+}
+
+/// Quick facts about a PDF gathered without rendering any page.
+class PdfProbe {
+  final String path;
+  final String? error;
+  final int fileSize;
+  final bool encrypted;
+  final int pageCount;
+  final List<PageSizeRun> pageSizes;
+  final String version;
+  final bool linearized;
+  final bool repaired;
+
+  const PdfProbe({
+    required this.path,
+    this.error,
+    required this.fileSize,
+    required this.encrypted,
+    required this.pageCount,
+    required this.pageSizes,
+    required this.version,
+    required this.linearized,
+    required this.repaired,
+  });
+
+  /// Readable without a password and with a usable page tree.
+  bool get isUsable => error == null && !encrypted && pageCount > 0;
+
+  /// Encrypted but otherwise readable: tools open it with a password.
+  bool get isLocked => error == null && encrypted;
+
+  factory PdfProbe.fromJson(Map<String, dynamic> json) {
+    final sizes = (json['pageSizes'] as List<dynamic>? ?? const [])
+        .map((run) => run as List<dynamic>)
+        .map((run) => PageSizeRun(
+              (run[0] as num).toDouble(),
+              (run[1] as num).toDouble(),
+              run[2] as int,
+            ))
+        .toList();
+    return PdfProbe(
+      path: json['path'] as String,
+      error: json['error'] as String?,
+      fileSize: json['fileSize'] as int? ?? -1,
+      encrypted: json['encrypted'] as bool? ?? false,
+      pageCount: json['pageCount'] as int? ?? -1,
+      pageSizes: sizes,
+      version: json['version'] as String? ?? '',
+      linearized: json['linearized'] as bool? ?? false,
+      repaired: json['repaired'] as bool? ?? false,
+    );
+  }
+}
+
+/// Probes every file in one native call; results keep the order of [paths].
+/// Without [pageSizes] most files are answered from their trailer alone,
+/// leaving [PdfProbe.pageSizes] empty and [PdfProbe.repaired] false.
+Future<List<PdfProbe>> probePdfs(List<String> paths, {bool pageSizes = true}) async {
+  if (paths.isEmpty) return const [];
+  try {
+    final String? report = await _channel.invokeMethod<String>(
+      'probePdfs',
+      {
+        'paths': paths,
+        'pageSizes': pageSizes,
+      },
+    );
+    final decoded = jsonDecode(report ?? '[]') as List<dynamic>;
+    return decoded
+        .map((entry) => PdfProbe.fromJson(entry as Map<String, dynamic>))
+        .toList();
+  } on PlatformException catch (e) {
+    print("probePdfs failed:  ${e.message}");
+    rethrow;
+  }
+}
+
+/// What [verifyLinearization] found in a file.
+class LinearizationReport {
+  final bool linearized;
+  final bool valid;
+  final int pageCount;
+  final int fileLength;
+  final int firstPageEnd;
+  final List<String> errors;
+  final List<String> warnings;
+
+  const LinearizationReport({
+    required this.linearized,
+    required this.valid,
+    required this.pageCount,
+    required this.fileLength,
+    required this.firstPageEnd,
+    required this.errors,
+    required this.warnings,
+  });
+
+  factory LinearizationReport.fromJson(Map<String, dynamic> json) => LinearizationReport(
+        linearized: json['linearized'] as bool? ?? false,
+        valid: json['valid'] as bool? ?? false,
+        pageCount: json['pages'] as int? ?? 0,
+        fileLength: json['fileLength'] as int? ?? -1,
+        firstPageEnd: json['firstPageEnd'] as int? ?? -1,
+        errors: (json['errors'] as List<dynamic>? ?? const []).cast<String>(),
+        warnings: (json['warnings'] as List<dynamic>? ?? const []).cast<String>(),
+      );
+}
+
+/// Checks the linearization of [path]: that its linearization dictionary
+/// and hint tables match where the objects really are, so a viewer can
+/// show the first page before the whole file has arrived. A file changed
+/// after it was linearized usually fails on its length.
+Future<LinearizationReport> verifyLinearization(String path) async {
+  try {
+    final String? report = await _channel.invokeMethod<String>(
+      'verifyLinearization',
+      {
+        'pdfPath': path,
+      },
+    );
+    return LinearizationReport.fromJson(jsonDecode(report ?? '{}') as Map<String, dynamic>);
+  } on PlatformException catch (e) {
+    print("verifyLinearization failed:  ${e.message}");
+    rethrow;
+  }
+}
@@ -1,14 +1,35 @@
+import 'dart:async';
+import 'dart:io';
+import 'dart:typed_data';
+import 'dart:ui' as ui;
 import 'package:flutter/services.dart';
 
+import 'native_callbacks.dart';
+
 const _channel = MethodChannel('com.bluepdf.channel/pdf');
 
-Future<String> renderSinglePage(String path, int pageIndex) async {
+/// [profile] selects the native render profile: 'draft' for thumbnails and
+/// scroll previews, 'quality' for final views, 'export' for high resolution.
+/// [encoding] selects the cache image format: 'png', 'png-fast', 'raw'
+/// (see [decodeRawPageImage]) or 'jpeg[:quality]'. [password] unlocks an
+/// encrypted document. The image stays until its path is passed to
+/// releaseJobResults (jobs.dart).
+Future<String> renderSinglePage(
+  String path,
+  int pageIndex, {
+  String profile = 'quality',
+  String encoding = 'png',
+  String? password,
+}) async {
   try {
     final String? imagePath = await _channel.invokeMethod<String>(
       'renderPdfPage',
       {
         'pdfPath': path,
         'pageIndex': pageIndex - 1,
+        'profile': profile,
+        'encoding': encoding,
+        if (password != null) 'password': password,
       },
     );
     if (imagePath == null || imagePath.isEmpty) {
@@ -20,3 +41,226 @@ Future<String> renderSinglePage(String path, int pageIndex) async {
     rethrow;
   }
 }
+
+/// Callback for one pass of a progressive render.
+typedef PageRenderCallback = void Function(String imagePath);
+
+class _ProgressiveRender {
+  final PageRenderCallback onCoarse;
+  final PageRenderCallback onRefined;
+
+  _ProgressiveRender(this.onCoarse, this.onRefined);
+}
+
+final Map<int, _ProgressiveRender> _progressiveRenders = {};
+int _nextRequestId = 1;
+bool _nativeHandlerInstalled = false;
+
+void _installNativeHandler() {
+  if (_nativeHandlerInstalled) return;
+  _nativeHandlerInstalled = true;
+  onNativeCallback('onPageRendered', (arguments) {
+    final args = arguments as Map;
+    final path = args['path'] as String;
+    final render = _progressiveRenders[args['requestId'] as int];
+    if (render == null) {
+      // Finished after its request was cancelled; nobody will show it.
+      File(path).delete().catchError((_) => File(path));
+      return;
+    }
+    if (args['pass'] == 0) {
+      render.onCoarse(path);
+    } else {
+      render.onRefined(path);
+    }
+  });
+}
+
+/// Renders a page in two passes: [onCoarse] receives a low resolution draft
+/// within about [budgetMs], then [onRefined] the render with [profile]
+/// ('draft' for thumbnail-sized previews). Returns a request id for
+/// [cancelRender]; cancelled requests skip the fine pass. Every request
+/// writes its own files; delete each one once it is no longer shown.
+int renderPageProgressive(
+  String path,
+  int pageIndex, {
+  required PageRenderCallback onCoarse,
+  required PageRenderCallback onRefined,
+  int budgetMs = 120,
+  String profile = 'quality',
+}) {
+  _installNativeHandler();
+  final requestId = _nextRequestId++;
+  _progressiveRenders[requestId] = _ProgressiveRender(onCoarse, onRefined);
+
+  _channel.invokeMethod<bool>(
+    'renderPdfPageProgressive',
+    {
+      'requestId': requestId,
+      'pdfPath': path,
+      'pageIndex': pageIndex - 1,
+      'budgetMs': budgetMs,
+      'profile': profile,
+    },
+  ).catchError((e) {
+    print("renderPageProgressive failed: $e");
+    return false;
+  }).whenComplete(() => _progressiveRenders.remove(requestId));
+
+  return requestId;
+}
+
+/// Cancels a progressive render; no further callbacks arrive for it.
+Future<void> cancelRender(int requestId) async {
+  _progressiveRenders.remove(requestId);
+  await _channel.invokeMethod('cancelRender', {'requestId': requestId});
+}
+
+/// Exports a page as an image at [dpi] without holding the whole page in
+/// memory. [format] is one of 'png', 'pam', 'pnm' or 'pwg'. Writes to [output] (a
+/// path or content URI) when given, otherwise to the app cache.
+Future<String> exportPageImage(String path, int pageIndex, {int dpi = 300, String format = 'png', String? output}) async {
+  try {
+    final String? imagePath = await _channel.invokeMethod<String>(
+      'exportPageImage',
+      {
+        'pdfPath': path,
+        'pageIndex': pageIndex - 1,
+        'dpi': dpi,
+        'format': format,
+        if (output != null) 'output': output,
+      },
+    );
+    if (imagePath == null || imagePath.isEmpty) {
+      throw Exception('Failed to export page.');
+    }
+    return imagePath;
+  } on PlatformException catch (e) {
+    print("exportPageImage failed: ${e.message}");
+    rethrow;
+  }
+}
+
+/// Extracts the image of a scanned (single-image) page at its native
+/// resolution. Returns null when the page has other content.
+Future<String?> extractPageImage(String path, int pageIndex) async {
+  return _channel.invokeMethod<String>(
+    'extractPageImage',
+    {
+      'pdfPath': path,
+      'pageIndex': pageIndex - 1,
+    },
+  );
+}
+
+/// Decodes a page rendered with the 'raw' encoding: a 16 byte header
+/// ("BPRA", width, height, row bytes; little endian) followed by
+/// premultiplied RGBA rows.
+Future<ui.Image> decodeRawPageImage(String path) async {
+  final bytes = await File(path).readAsBytes();
+  final header = ByteData.sublistView(bytes, 0, 16);
+  if (String.fromCharCodes(bytes.sublist(0, 4)) != 'BPRA') {
+    throw Exception('Not a raw page image: $path');
+  }
+  final width = header.getUint32(4, Endian.little);
+  final height = header.getUint32(8, Endian.little);
+  final rowBytes = header.getUint32(12, Endian.little);
+
+  final completer = Completer<ui.Image>();
+  ui.decodeImageFromPixels(
+    Uint8List.sublistView(bytes, 16),
+    width,
+    height,
+    ui.PixelFormat.rgba8888,
+    completer.complete,
+    rowBytes: rowBytes,
+  );
+  return completer.future;
+}
+
+/// Compares native encode time and size of every page cache encoding.
+/// Returns the JSON report produced by the native benchmark.
+Future<String> benchmarkPageEncoding(String path, int pageIndex) async {
+  final String? report = await _channel.invokeMethod<String>(
+    'benchmarkPageEncoding',
+    {
+      'pdfPath': path,
+      'pageIndex': pageIndex - 1,
+    },
+  );
+  return report ?? '';
+}
+
+/// Compares how the native side reads [path]: MuPDF's stdio stream,
+/// buffered pread and memory-mapped sequential/random access. Each entry
+/// has a full read time and an open-and-run-first-pages time, as JSON.
+Future<String> benchmarkInputStreams(String path) async {
+  final String? report = await _channel.invokeMethod<String>(
+    'benchmarkInputStreams',
+    {
+      'pdfPath': path,
+    },
+  );
+  return report ?? '';
+}
+
+/// Saves the PDF at [path] through the direct and the asynchronous native
+/// output writers (compressed, fsync included) and returns their save
+/// times as JSON.
+Future<String> benchmarkOutputWriters(String path) async {
+  final String? report = await _channel.invokeMethod<String>(
+    'benchmarkOutputWriters',
+    {
+      'pdfPath': path,
+    },
+  );
+  return report ?? '';
+}
+
+/// Opens the PDF at [path] and renders its first page while the file
+/// arrives at [kilobytesPerSecond], as on a slow download, once as it is
+/// and once linearized. Returns the simulated time to the first page of
+/// each, the bytes that had arrived by then, and the check of the
+/// linearized copy, as JSON.
+Future<String> benchmarkFirstPage(String path, {int kilobytesPerSecond = 256}) async {
+  final String? report = await _channel.invokeMethod<String>(
+    'benchmarkFirstPage',
+    {
+      'pdfPath': path,
+      'kilobytesPerSecond': kilobytesPerSecond,
+    },
+  );
+  return report ?? '';
+}
+
+/// Times the native 2x downscale kernel on RGB and RGBA samples for every
+/// SIMD backend on this device against the scalar reference. Defaults to
+/// an A4 page at 300 dpi. Returns the JSON report.
+Future<String> benchmarkImageKernels({int width = 2480, int height = 3508}) async {
+  final String? report = await _channel.invokeMethod<String>(
+    'benchmarkImageKernels',
+    {
+      'width': width,
+      'height': height,
+    },
+  );
+  return report ?? '';
+}
+
+/// Times MuPDF's AES-256-CBC, which encrypting and reading encrypted PDFs
+/// run, over [megabytes] of data. Returns the JSON report in MB/s.
+Future<String> benchmarkAes({int megabytes = 32}) async {
+  final String? report = await _channel.invokeMethod<String>(
+    'benchmarkAes',
+    {
+      'megabytes': megabytes,
+    },
+  );
+  return report ?? '';
+}
+
+/// Native render engine counters, e.g. pixmap pool hits and misses, as JSON.
+Future<String> getRenderStats() async {
+  final String? stats = await _channel.invokeMethod<String>('getRenderStats');
+  return stats ?? '{}';
+}
@@ -2,12 +2,16 @@ import 'package:flutter/services.dart';
 
 const _channel = MethodChannel('com.bluepdf.channel/pdf');
 
-Future<List<String>> reorderPdfNative(String inputPath) async {
+/// [password] unlocks an encrypted input; without it such inputs fail
+/// with PASSWORD_REQUIRED. The page files stay until their paths are
+/// passed to releaseJobResults (jobs.dart).
+Future<List<String>> reorderPdfNative(String inputPath, {String? password}) async {
   try {
     final dynamic result = await _channel.invokeMethod(
       'reorderPdf',
       {
         'path': inputPath,
+        if (password != null) 'password': password,
       },
     );
     
@@ -0,0 +1,51 @@
+import 'dart:ffi';
+import 'dart:typed_data';
+
+/// Output destination that keeps a tool's result in native memory. Pass it
+/// as `output:` to mergePdfNative, imageToPdfNative, encryptPdfNative,
+/// splitPdfNative or optimizePdfNative; they then return a handle for
+/// [takeResultBuffer] instead of a path. Meant for small results that are
+/// shared right away ("Share without saving" on the home screen). Pass the
+/// handle to releaseJobResults (jobs.dart) once taken; that also frees a
+/// result that was never taken.
+const memoryOutput = 'mem:';
+
+final DynamicLibrary _lib = DynamicLibrary.open('libnative-lib.so');
+
+final int Function(int) _resultLength = _lib
+    .lookupFunction<Int64 Function(Int64), int Function(int)>('bluepdf_result_length');
+
+final Pointer<Uint8> Function(int) _takeResult = _lib
+    .lookupFunction<Pointer<Uint8> Function(Int64), Pointer<Uint8> Function(int)>('bluepdf_take_result');
+
+final void Function(int) _releaseResult = _lib
+    .lookupFunction<Void Function(Int64), void Function(int)>('bluepdf_release_result');
+
+final Pointer<NativeFinalizerFunction> _freeResult =
+    _lib.lookup<NativeFinalizerFunction>('bluepdf_free_result');
+
+/// Whether a tool result is a memory handle rather than a path.
+bool isResultBuffer(String result) =>
+    result.startsWith(memoryOutput) && result.length > memoryOutput.length;
+
+/// The bytes behind a memory handle, viewed in place. The native memory is
+/// freed once the returned list is garbage collected. Each handle can be
+/// taken once.
+Uint8List takeResultBuffer(String handle) {
+  final id = int.parse(handle.substring(memoryOutput.length));
+  final length = _resultLength(id);
+  if (length < 0) {
+    throw StateError('No result buffer for $handle');
+  }
+  final data = _takeResult(id);
+  if (length == 0 || data == nullptr) {
+    _freeResult.asFunction<void Function(Pointer<Void>)>()(data.cast());
+    return Uint8List(0);
+  }
+  return data.asTypedList(length, finalizer: _freeResult);
+}
+
+/// Frees a result that will not be taken.
+void releaseResultBuffer(String handle) {
+  _releaseResult(int.parse(handle.substring(memoryOutput.length)));
+}
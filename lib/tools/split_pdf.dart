@@ -1,14 +1,47 @@
 import 'package:flutter/services.dart';
+
+import 'jobs.dart';
+
 const _channel = MethodChannel('com.bluepdf.channel/pdf');
 
-Future<String> splitPdfNative(String inputPath, List<int> pagesToSplit) async {
+/// Writes to [output] (a path or content URI) when given, otherwise to
+/// the app cache. Returns where the result was written, or a memory handle
+/// when [output] is `'mem:'` (see result_buffer.dart). [onProgress] gets
+/// the job's updates while it runs. [password] unlocks an encrypted input
+/// in memory. [objectStreams] packs objects into compressed object
+/// streams with an xref stream, which makes the file smaller and quicker
+/// to open. [linearize] writes a linearized ("Fast Web View") file
+/// instead, whose first page a viewer can show before the rest has
+/// downloaded.
+/// [subsetFonts] keeps only the glyphs the written pages use of each
+/// embedded font, so a few pages from a file with large CJK fonts come to
+/// kilobytes instead of megabytes.
+Future<String> splitPdfNative(
+  String inputPath,
+  List<int> pagesToSplit, {
+  String? output,
+  String? password,
+  bool objectStreams = false,
+  bool linearize = false,
+  bool subsetFonts = false,
+  void Function(PdfJobStatus status)? onProgress,
+}) async {
   try {
-    final String? outputPaths = await _channel.invokeMethod<String>(
-      'splitPdf',
-      {
-        'path': inputPath,
-        'pages': pagesToSplit,
-      },
+    final String? outputPaths = await withJobProgress(
+      onProgress,
+      (tag) => _channel.invokeMethod<String>(
+        'splitPdf',
+        {
+          'path': inputPath,
+          'pages': pagesToSplit,
+          if (output != null) 'output': output,
+          if (password != null) 'password': password,
+          'objectStreams': objectStreams,
+          'linearize': linearize,
+          'subsetFonts': subsetFonts,
+          if (tag != null) 'tag': tag,
+        },
+      ),
     );
     if (outputPaths == null || outputPaths.isEmpty) {
       throw Exception('Failed to split PDF.');